@@ -0,0 +1,24 @@
+#ifndef STORE_BENCH_SYNTHETIC_CATALOG_H
+#define STORE_BENCH_SYNTHETIC_CATALOG_H
+
+#include <string>
+
+#include "../core/StoreCore.h"
+
+/*
+ * Fill the list with size commodities for every category, named "<label> <number>" like the store-bench catalog.
+ * It is used by the server benchmarks which start their own server.
+ */
+inline void fillSyntheticCatalog(CommodityList& list, long long size) {
+    for (int category = 0; category < CategoryRegistry::size(); category++) {
+        for (long long i = 0; i < size; i++) {
+            Commodity* commodity = CategoryRegistry::get(category).create();
+            commodity->setField("name", CategoryRegistry::get(category).label + " " + std::to_string(i));
+            commodity->setField("price", std::to_string(100 + i % 5000));
+            commodity->setField("description", "synthetic commodity number " + std::to_string(i));
+            list.add(commodity, category);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef STORE_BENCHMARK_H
+#define STORE_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * A small micro benchmark harness in the style of Google Benchmark, so the store has no extra dependency.
+ * A benchmark is a function taking a State. The code before the first keepRunning() is the setup and is not timed:
+ *
+ *     void addCommodity(bench::State& state) {
+ *         ... build a catalog of state.size() commodities ...
+ *         while (state.keepRunning()) { ... the measured code ... }
+ *     }
+ *     STORE_BENCHMARK("hw2/CommodityList/add", addCommodity);
+ *
+ * The iterations are increased until a run takes --benchmark_min_time seconds. Every benchmark is run once for each
+ * catalog size given by --sizes. The results are printed as a table, or as the JSON of Google Benchmark with
+ * --benchmark_format=json, and --benchmark_out=<file> also writes the JSON into a file.
+ */
+namespace bench {
+
+    class State {
+    private:
+        long long maxIterations;
+        long long left;
+        long long catalogSize;
+        long long items = 0;
+        bool started = false;
+        std::chrono::steady_clock::time_point realStart;
+        std::clock_t cpuStart = 0;
+        double realSeconds = 0;
+        double cpuSeconds = 0;
+
+    public:
+        State(long long iterations, long long size) : maxIterations(iterations), left(iterations), catalogSize(size) {}
+
+        /*
+         * Return true while the measured code should run once more. The timer starts at the first call.
+         */
+        bool keepRunning() {
+            if (!started) {
+                started = true;
+                resumeTiming();
+            }
+            if (left-- > 0) return true;
+            pauseTiming();
+            return false;
+        }
+
+        /*
+         * Stop the timer around the code which prepare the next iteration, e.g. refilling a cart.
+         */
+        void pauseTiming() {
+            realSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - realStart).count();
+            cpuSeconds += (double) (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        }
+
+        void resumeTiming() {
+            realStart = std::chrono::steady_clock::now();
+            cpuStart = std::clock();
+        }
+
+        /*
+         * The number of items one iteration handles, when it is more than one.
+         */
+        void setItemsPerIteration(long long count) {
+            items = count;
+        }
+
+        long long iterations() const {
+            return maxIterations;
+        }
+
+        long long size() const {
+            return catalogSize;
+        }
+
+        double realTime() const {
+            return realSeconds;
+        }
+
+        double cpuTime() const {
+            return cpuSeconds;
+        }
+
+        long long itemsPerIteration() const {
+            return items;
+        }
+    };
+
+    /*
+     * Keep the compiler from dropping a result which is never used.
+     */
+    template<class T>
+    inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    struct Benchmark {
+        std::string name;
+        std::function<void(State&)> run;
+    };
+
+    inline std::vector<Benchmark>& registry() {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    struct Registrar {
+        Registrar(const std::string& name, std::function<void(State&)> run) {
+            registry().push_back({name, run});
+        }
+    };
+
+    struct Result {
+        std::string name;
+        long long iterations;
+        double realNanoseconds;
+        double cpuNanoseconds;
+        double itemsPerSecond;
+    };
+
+    inline void writeJSON(std::ostream& out, const std::vector<Result>& results) {
+        std::streamsize precision = out.precision(12);
+        char date[64];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+        out << "{\n  \"context\": {\n    \"date\": \"" << date << "\",\n    \"library_build_type\": \""
+#ifdef NDEBUG
+            << "release"
+#else
+            << "debug"
+#endif
+            << "\"\n  },\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& result = results[i];
+            out << (i == 0 ? "\n" : ",\n") << "    {\n      \"name\": \"" << result.name << "\",\n"
+                << "      \"run_type\": \"iteration\",\n"
+                << "      \"iterations\": " << result.iterations << ",\n"
+                << "      \"real_time\": " << result.realNanoseconds << ",\n"
+                << "      \"cpu_time\": " << result.cpuNanoseconds << ",\n"
+                << "      \"time_unit\": \"ns\"";
+            if (result.itemsPerSecond > 0) out << ",\n      \"items_per_second\": " << result.itemsPerSecond;
+            out << "\n    }";
+        }
+        out << "\n  ]\n}\n";
+        out.precision(precision);
+    }
+
+    /*
+     * Run every registered benchmark whose name matches the filter.
+     * INPUT: The command line, and the catalog sizes used when --sizes is not given
+     * OUTPUT: The exit code
+     */
+    inline int runAll(int argc, char** argv, const std::vector<long long>& defaultSizes) {
+        std::vector<long long> sizes = defaultSizes;
+        std::string filter = ".*";
+        std::string outFile;
+        bool json = false;
+        double minTime = 0.2;
+        for (int i = 1; i < argc; i++) {
+            std::string argument = argv[i];
+            std::string value = argument.substr(argument.find('=') + 1);
+            if (argument.compare(0, 8, "--sizes=") == 0) {
+                sizes.clear();
+                std::stringstream list(value);
+                std::string size;
+                while (std::getline(list, size, ',')) sizes.push_back(std::stoll(size));
+            } else if (argument.compare(0, 19, "--benchmark_filter=") == 0) {
+                filter = value;
+            } else if (argument.compare(0, 16, "--benchmark_out=") == 0) {
+                outFile = value;
+            } else if (argument.compare(0, 19, "--benchmark_format=") == 0) {
+                json = (value == "json");
+            } else if (argument.compare(0, 21, "--benchmark_min_time=") == 0) {
+                minTime = std::stod(value);
+            } else {
+                std::cerr << "usage: " << argv[0] << " [--sizes=N,M,...] [--benchmark_filter=<regex>]"
+                          << " [--benchmark_min_time=<seconds>] [--benchmark_format=console|json]"
+                          << " [--benchmark_out=<file>]" << std::endl;
+                return 1;
+            }
+        }
+
+        std::regex pattern(filter);
+        std::vector<Result> results;
+        if (!json) {
+            std::printf("%-44s %14s %14s %12s %14s\n", "Benchmark", "Time(ns)", "CPU(ns)", "Iterations", "Items/s");
+        }
+        for (const Benchmark& benchmark : registry()) {
+            for (long long size : sizes) {
+                std::string name = benchmark.name + "/" + std::to_string(size);
+                if (!std::regex_search(name, pattern)) continue;
+
+                long long iterations = 1;
+                while (true) {
+                    State state(iterations, size);
+                    benchmark.run(state);
+                    bool enough = state.realTime() >= minTime || iterations >= 1000000000LL;
+                    if (enough) {
+                        Result result{name, iterations, state.realTime() * 1e9 / iterations,
+                                      state.cpuTime() * 1e9 / iterations, 0};
+                        if (state.itemsPerIteration() > 0 && state.realTime() > 0) {
+                            result.itemsPerSecond = (double) state.itemsPerIteration() * iterations / state.realTime();
+                        }
+                        results.push_back(result);
+                        if (!json) {
+                            std::string itemsPerSecond = result.itemsPerSecond > 0 ?
+                                    std::to_string((long long) result.itemsPerSecond) : "";
+                            std::printf("%-44s %14.1f %14.1f %12lld %14s\n", name.c_str(), result.realNanoseconds,
+                                        result.cpuNanoseconds, iterations, itemsPerSecond.c_str());
+                            std::fflush(stdout);
+                        }
+                        break;
+                    }
+                    // Aim a bit above the minimum time, but never grow more than 10 times at once
+                    double predicted = state.realTime() > 0 ? minTime * 1.4 * iterations / state.realTime() : 10.0 * iterations;
+                    iterations = std::max(iterations + 1, std::min((long long) predicted, iterations * 10));
+                }
+            }
+        }
+
+        if (json) writeJSON(std::cout, results);
+        if (!outFile.empty()) {
+            std::ofstream out(outFile);
+            writeJSON(out, results);
+        }
+        return 0;
+    }
+}
+
+#define STORE_BENCHMARK_CONCAT(a, b) a##b
+#define STORE_BENCHMARK_NAME(line) STORE_BENCHMARK_CONCAT(storeBenchmark, line)
+#define STORE_BENCHMARK(name, function) static bench::Registrar STORE_BENCHMARK_NAME(__LINE__)(name, function)
+
+#endif
@@ -0,0 +1,309 @@
+/*
+ * store-http-bench drive the HTTP front end with keep-alive connections and report requests/sec and latency.
+ * A StoreService with a synthetic catalog is started on a loopback port inside the process, unless --target gives the
+ * address of a running store-server.
+ * Usage: store-http-bench [--connections=16] [--pipeline=1] [--seconds=5] [--items=1000] [--target=<host>:<port>]
+ * --pipeline is the number of requests every connection keeps in flight, --items the commodities per category.
+ * The mix is 40% list, 20% search, 25% add to cart, 10% cart view and 5% checkout, every connection has its own cart.
+ * The latency of a request is measured from the moment it is queued to the moment its response is complete.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../core/StoreCore.h"
+#include "../server/HttpServer.h"
+#include "../server/StoreService.h"
+#include "SyntheticCatalog.h"
+
+using namespace std;
+
+namespace {
+
+    typedef chrono::steady_clock Clock;
+
+    struct Options {
+        int connections = 16;
+        int pipeline = 1;
+        double seconds = 5;
+        long long items = 1000;
+        string host = "127.0.0.1";
+        int port = 0;
+    };
+
+    struct Random {
+        unsigned long long seed = 88172645463325252ULL;
+
+        long long next(long long bound) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            return (long long) (seed % (unsigned long long) bound);
+        }
+    };
+
+    struct Client {
+        int fd = -1;
+        string cart;
+        string input;
+        string output;
+        size_t written = 0;
+        deque<Clock::time_point> sent;
+        long long cartLines = 0;
+        bool broken = false;
+    };
+
+    struct Result {
+        long long responses = 0;
+        long long failures = 0;
+        LatencyHistogram latency;
+    };
+
+    int connectTo(const string& host, int port) {
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t) port);
+        if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) return -1;
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        return fd;
+    }
+
+    /*
+     * Find a complete response starting at from in the input.
+     * RETURN: The length of the response, or 0 if it is not complete yet. status is set to its status code
+     */
+    size_t responseLength(const string& input, size_t from, int& status) {
+        size_t headerEnd = input.find("\r\n\r\n", from);
+        if (headerEnd == string::npos || headerEnd < from + 12) return 0;
+        status = atoi(input.c_str() + from + 9);
+        size_t contentLength = 0;
+        for (size_t line = input.find("\r\n", from); line < headerEnd; line = input.find("\r\n", line + 2)) {
+            if (strncasecmp(input.c_str() + line + 2, "Content-Length:", 15) == 0) {
+                contentLength = strtoul(input.c_str() + line + 17, nullptr, 10);
+            }
+        }
+        size_t total = headerEnd + 4 + contentLength - from;
+        return input.size() - from >= total ? total : 0;
+    }
+
+    /*
+     * Ask for the size of the catalog with one blocking request, it is needed to pick the commodities to buy.
+     */
+    long long catalogSize(const Options& options) {
+        int fd = connectTo(options.host, options.port);
+        if (fd < 0) return -1;
+        string request = "GET /commodities?limit=0 HTTP/1.1\r\nHost: bench\r\n\r\n";
+        if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t) request.size()) {
+            close(fd);
+            return -1;
+        }
+        string input;
+        char buffer[4096];
+        int status = 0;
+        size_t length = 0;
+        while (length == 0) {
+            ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+            if (received <= 0) break;
+            input.append(buffer, (size_t) received);
+            length = responseLength(input, 0, status);
+        }
+        close(fd);
+        size_t total = input.find("\"total\":");
+        if (length == 0 || status != 200 || total == string::npos) return -1;
+        return atoll(input.c_str() + total + 8);
+    }
+
+    void queueRequest(Client& client, Random& random, long long catalog) {
+        long long roll = random.next(100);
+        string& out = client.output;
+        if (roll < 40) {
+            out += "GET /commodities?offset=" + to_string(random.next(catalog)) + "&limit=20 HTTP/1.1\r\n\r\n";
+        } else if (roll < 60) {
+            out += "GET /search?q=" + to_string(random.next(1000)) + "&limit=20 HTTP/1.1\r\n\r\n";
+        } else if (roll < 85 || (roll >= 95 && client.cartLines == 0)) {
+            string body = "{\"position\":" + to_string(1 + random.next(catalog)) + "}";
+            out += "POST /carts/" + client.cart + "/items HTTP/1.1\r\nContent-Type: application/json\r\n"
+                   "Content-Length: " + to_string(body.size()) + "\r\n\r\n" + body;
+            client.cartLines++;
+        } else if (roll < 95) {
+            out += "GET /carts/" + client.cart + " HTTP/1.1\r\n\r\n";
+        } else {
+            out += "POST /carts/" + client.cart + "/checkout HTTP/1.1\r\nContent-Length: 0\r\n\r\n";
+            client.cartLines = 0;
+        }
+        client.sent.push_back(Clock::now());
+    }
+
+    void flush(Client& client) {
+        while (client.written < client.output.size()) {
+            ssize_t length = send(client.fd, client.output.data() + client.written,
+                                  client.output.size() - client.written, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (length <= 0) {
+                if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+                client.broken = true;
+                return;
+            }
+            client.written += (size_t) length;
+        }
+        client.output.clear();
+        client.written = 0;
+    }
+
+    void drive(const Options& options, long long catalog, Result& result) {
+        int epoll = epoll_create1(0);
+        vector<Client> clients(options.connections);
+        Random random;
+        for (int i = 0; i < options.connections; i++) {
+            Client& client = clients[i];
+            client.fd = connectTo(options.host, options.port);
+            if (client.fd < 0) {
+                cerr << "Can not connect to " << options.host << ":" << options.port << endl;
+                exit(1);
+            }
+            client.cart = "bench-" + to_string(i);
+            epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.u32 = (uint32_t) i;
+            epoll_ctl(epoll, EPOLL_CTL_ADD, client.fd, &event);
+            for (int j = 0; j < options.pipeline; j++) queueRequest(client, random, catalog);
+            flush(client);
+        }
+
+        auto deadline = Clock::now() + chrono::duration_cast<Clock::duration>(chrono::duration<double>(options.seconds));
+        epoll_event events[256];
+        char buffer[64 << 10];
+        while (Clock::now() < deadline) {
+            int waitMs = (int) chrono::duration_cast<chrono::milliseconds>(deadline - Clock::now()).count() + 1;
+            int ready = epoll_wait(epoll, events, 256, waitMs);
+            for (int i = 0; i < ready; i++) {
+                Client& client = clients[events[i].data.u32];
+                ssize_t received = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+                if (received <= 0) {
+                    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+                    cerr << "The server closed a connection" << endl;
+                    exit(1);
+                }
+                client.input.append(buffer, (size_t) received);
+                int status = 0;
+                size_t consumed = 0;
+                auto now = Clock::now();
+                for (size_t length; (length = responseLength(client.input, consumed, status)) != 0;) {
+                    consumed += length;
+                    result.responses++;
+                    if (status < 200 || status >= 300) result.failures++;
+                    result.latency.record((uint64_t) chrono::duration_cast<chrono::nanoseconds>(
+                            now - client.sent.front()).count());
+                    client.sent.pop_front();
+                    if (now < deadline) queueRequest(client, random, catalog);
+                }
+                client.input.erase(0, consumed);
+                flush(client);
+                if (client.broken) {
+                    cerr << "Can not send to the server" << endl;
+                    exit(1);
+                }
+            }
+        }
+        for (Client& client : clients) close(client.fd);
+        close(epoll);
+    }
+
+    void usage(const char* program) {
+        cerr << "usage: " << program << " [--connections=N] [--pipeline=N] [--seconds=S] [--items=N]"
+             << " [--target=<host>:<port>]" << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    bool external = false;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        string key = argument.substr(0, argument.find('='));
+        string value = argument.substr(argument.find('=') + 1);
+        if (key == "--connections") options.connections = stoi(value);
+        else if (key == "--pipeline") options.pipeline = stoi(value);
+        else if (key == "--seconds") options.seconds = stod(value);
+        else if (key == "--items") options.items = stoll(value);
+        else if (key == "--target" && value.rfind(':') != string::npos) {
+            options.host = value.substr(0, value.rfind(':'));
+            options.port = stoi(value.substr(value.rfind(':') + 1));
+            external = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.connections < 1 || options.pipeline < 1 || options.seconds <= 0 || options.items < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    CommodityList list;
+    StoreService service(list);
+    HttpServer server([&service](const HttpRequest& request, HttpResponse& response) {
+        service.handle(request, response);
+    });
+    thread serverThread;
+    if (!external) {
+        fillSyntheticCatalog(list, options.items);
+        string error;
+        if (!server.listenTcp(options.host, 0, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+        options.port = server.port();
+        serverThread = thread([&server]() { server.run(); });
+    }
+
+    long long catalog = catalogSize(options);
+    if (catalog <= 0) {
+        cerr << "Can not read the catalog from " << options.host << ":" << options.port << endl;
+        if (!external) {
+            server.stop();
+            serverThread.join();
+        }
+        return 1;
+    }
+
+    Result result;
+    auto start = Clock::now();
+    drive(options, catalog, result);
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    if (!external) {
+        server.stop();
+        serverThread.join();
+    }
+
+    LatencyHistogram& latency = result.latency;
+    printf("connections %d, pipeline %d, %lld commodities, %.1f seconds\n", options.connections, options.pipeline,
+           catalog, seconds);
+    printf("requests %lld, non 2xx %lld, %.0f requests/sec\n", result.responses, result.failures,
+           result.responses / seconds);
+    printf("latency(us) mean %.1f, p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n", latency.mean() / 1000.0,
+           latency.percentile(0.5) / 1000.0, latency.percentile(0.9) / 1000.0, latency.percentile(0.99) / 1000.0,
+           latency.max() / 1000.0);
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Micro benchmarks of the first homework store, the linked list CommodityList and the vector ShoppingCart.
+ * hw1.cpp is compiled inside its own namespace, because store-core has classes with the same names.
+ */
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+#define STORE_NO_MAIN
+namespace hw1 {
+#include "../hw1.cpp"
+}
+
+using namespace std;
+
+namespace {
+
+    /*
+     * A deterministic pseudo random sequence, so every run touches the same positions.
+     */
+    struct Random {
+        unsigned long long seed = 88172645463325252ULL;
+
+        long long next(long long bound) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            return (long long) (seed % (unsigned long long) bound);
+        }
+    };
+
+    vector<hw1::Commodity*> makeCommodities(long long size) {
+        vector<hw1::Commodity*> commodities;
+        commodities.reserve(size);
+        for (long long i = 0; i < size; i++) {
+            commodities.push_back(new hw1::Commodity((int) (100 + i % 5000), "Commodity " + to_string(i),
+                                                     "synthetic commodity number " + to_string(i)));
+        }
+        return commodities;
+    }
+
+    void destroy(vector<hw1::Commodity*>& commodities) {
+        for (hw1::Commodity* commodity : commodities) delete commodity;
+        commodities.clear();
+    }
+
+    /*
+     * The list order is the reverse of the add order, because add() push the commodity to the front.
+     */
+    void build(hw1::CommodityList& list, vector<hw1::Commodity*>& commodities) {
+        for (hw1::Commodity* commodity : commodities) list.add(commodity);
+    }
+
+    void commodityListAdd(bench::State& state) {
+        vector<hw1::Commodity*> commodities = makeCommodities(state.size());
+        state.setItemsPerIteration(state.size());
+        while (state.keepRunning()) {
+            hw1::CommodityList list;
+            build(list, commodities);
+            bench::doNotOptimize(list);
+        }
+        destroy(commodities);
+    }
+
+    void commodityListGet(bench::State& state) {
+        vector<hw1::Commodity*> commodities = makeCommodities(state.size());
+        hw1::CommodityList list;
+        build(list, commodities);
+        Random random;
+        while (state.keepRunning()) {
+            hw1::Commodity commodity = list.get((int) random.next(state.size()));
+            bench::doNotOptimize(commodity);
+        }
+        destroy(commodities);
+    }
+
+    void commodityListIsExist(bench::State& state) {
+        vector<hw1::Commodity*> commodities = makeCommodities(state.size());
+        hw1::CommodityList list;
+        build(list, commodities);
+        Random random;
+        vector<hw1::Commodity> probes;
+        for (int i = 0; i < 1024; i++) probes.push_back(*commodities[random.next(state.size())]);
+        size_t probe = 0;
+        while (state.keepRunning()) {
+            bool exist = list.isExist(&probes[probe++ & 1023]);
+            bench::doNotOptimize(exist);
+        }
+        destroy(commodities);
+    }
+
+    void commodityListRemove(bench::State& state) {
+        vector<hw1::Commodity*> commodities = makeCommodities(state.size());
+        hw1::CommodityList list;
+        build(list, commodities);
+        // The mirror of the list order, remove() deletes the node so a copy of it is pushed back
+        vector<hw1::Commodity*> order(commodities.rbegin(), commodities.rend());
+        int middle = (int) state.size() / 2;
+        while (state.keepRunning()) {
+            state.pauseTiming();
+            hw1::Commodity* copy = new hw1::Commodity(*order[middle]);
+            state.resumeTiming();
+            list.remove(middle);
+            state.pauseTiming();
+            order.erase(order.begin() + middle);
+            order.insert(order.begin(), copy);
+            list.add(copy);
+            state.resumeTiming();
+        }
+        destroy(order);
+    }
+
+    /*
+     * hw1 ShoppingCart::push prints debug lines, they are discarded while the cart benchmarks run.
+     */
+    struct DiscardOutput {
+        ofstream discard;
+        streambuf* console;
+
+        DiscardOutput() : console(cout.rdbuf(discard.rdbuf())) {}
+
+        ~DiscardOutput() {
+            cout.rdbuf(console);
+        }
+    };
+
+    /*
+     * The store resizes the cart to the catalog size before every push, the benchmarks do the same.
+     * The cart keeps iterators across the insert in push, so it is also resized before the other calls to refresh them.
+     */
+    void shoppingCartPush(bench::State& state) {
+        DiscardOutput quiet;
+        vector<hw1::Commodity*> commodities = makeCommodities(state.size());
+        hw1::ShoppingCart cart;
+        Random random;
+        while (state.keepRunning()) {
+            cart.ShoppingCart_resize((int) state.size());
+            cart.push(*commodities[random.next(state.size())]);
+        }
+        destroy(commodities);
+    }
+
+    void shoppingCartRemove(bench::State& state) {
+        DiscardOutput quiet;
+        vector<hw1::Commodity*> commodities = makeCommodities(state.size());
+        hw1::ShoppingCart cart;
+        Random random;
+        while (state.keepRunning()) {
+            state.pauseTiming();
+            cart.ShoppingCart_resize((int) state.size());
+            cart.push(*commodities[random.next(state.size())]);
+            cart.ShoppingCart_resize((int) state.size());
+            state.resumeTiming();
+            cart.remove(0);
+        }
+        destroy(commodities);
+    }
+
+    void shoppingCartCheckOut(bench::State& state) {
+        DiscardOutput quiet;
+        vector<hw1::Commodity*> commodities = makeCommodities(state.size());
+        hw1::ShoppingCart cart;
+        for (hw1::Commodity* commodity : commodities) {
+            cart.ShoppingCart_resize((int) state.size());
+            cart.push(*commodity);
+        }
+        cart.ShoppingCart_resize((int) state.size());
+        while (state.keepRunning()) {
+            int total = cart.checkOut();
+            bench::doNotOptimize(total);
+        }
+        destroy(commodities);
+    }
+}
+
+STORE_BENCHMARK("hw1/CommodityList/add", commodityListAdd);
+STORE_BENCHMARK("hw1/CommodityList/get", commodityListGet);
+STORE_BENCHMARK("hw1/CommodityList/isExist", commodityListIsExist);
+STORE_BENCHMARK("hw1/CommodityList/remove", commodityListRemove);
+STORE_BENCHMARK("hw1/ShoppingCart/push", shoppingCartPush);
+STORE_BENCHMARK("hw1/ShoppingCart/remove", shoppingCartRemove);
+STORE_BENCHMARK("hw1/ShoppingCart/checkOut", shoppingCartCheckOut);
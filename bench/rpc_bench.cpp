@@ -0,0 +1,188 @@
+/*
+ * store-rpc-bench measure operations/sec of the binary protocol with concurrent clients, each one on its own thread
+ * and its own connection. A RpcServer with a synthetic catalog is started inside the process, unless --target gives
+ * the socket of a running store-server --rpc.
+ * Usage: store-rpc-bench [--clients=4] [--batch=64] [--seconds=5] [--items=1000] [--target=<socket path>]
+ * --batch is the number of operations sent in one frame, --items the commodities per category.
+ * The mix is 50% get, 20% isExist, 25% push and 5% checkOut, every client has its own cart.
+ * The latency is the round trip of a whole batch.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../core/StoreCore.h"
+#include "../server/RpcClient.h"
+#include "../server/RpcServer.h"
+#include "../server/RpcService.h"
+#include "SyntheticCatalog.h"
+
+using namespace std;
+
+namespace {
+
+    typedef chrono::steady_clock Clock;
+
+    struct Options {
+        int clients = 4;
+        int batch = 64;
+        double seconds = 5;
+        long long items = 1000;
+        string path;
+    };
+
+    struct Result {
+        atomic<long long> operations{0};
+        atomic<long long> failures{0};
+        atomic<bool> broken{false};
+        LatencyHistogram latency;
+    };
+
+    struct Random {
+        unsigned long long seed;
+
+        long long next(long long bound) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            return (long long) (seed % (unsigned long long) bound);
+        }
+    };
+
+    void runClient(const Options& options, int id, int catalog, Clock::time_point deadline, Result& result) {
+        RpcClient client;
+        string error;
+        if (!client.connect(options.path, error)) {
+            cerr << error << endl;
+            result.broken = true;
+            return;
+        }
+        Random random{0x9E3779B97F4A7C15ULL * (unsigned long long) (id + 1)};
+        string cart = "rpc-bench-" + to_string(id);
+        int labels = CategoryRegistry::size();
+        RpcBatch batch;
+        vector<RpcResult> results;
+        long long operations = 0;
+        long long failures = 0;
+        while (Clock::now() < deadline) {
+            batch.clear();
+            for (int i = 0; i < options.batch; i++) {
+                long long roll = random.next(100);
+                if (roll < 50) {
+                    batch.get((int) random.next(catalog));
+                } else if (roll < 70) {
+                    batch.isExist(CategoryRegistry::get((int) random.next(labels)).label + " " +
+                                  to_string(random.next(options.items * 2)));
+                } else if (roll < 95) {
+                    batch.push(cart, (int) random.next(catalog));
+                } else {
+                    batch.checkOut(cart);
+                }
+            }
+            auto start = Clock::now();
+            if (!client.call(batch, results)) {
+                cerr << "The connection of client " << id << " is broken" << endl;
+                result.broken = true;
+                break;
+            }
+            result.latency.record((uint64_t) chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count());
+            operations += batch.size();
+            for (const RpcResult& item : results) {
+                if (item.status != Rpc::OK) failures++;
+            }
+        }
+        result.operations += operations;
+        result.failures += failures;
+    }
+
+    void usage(const char* program) {
+        cerr << "usage: " << program << " [--clients=N] [--batch=N] [--seconds=S] [--items=N] [--target=<socket path>]"
+             << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        string key = argument.substr(0, argument.find('='));
+        string value = argument.substr(argument.find('=') + 1);
+        if (key == "--clients") options.clients = stoi(value);
+        else if (key == "--batch") options.batch = stoi(value);
+        else if (key == "--seconds") options.seconds = stod(value);
+        else if (key == "--items") options.items = stoll(value);
+        else if (key == "--target" && !value.empty() && value != argument) options.path = value;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.clients < 1 || options.batch < 1 || options.seconds <= 0 || options.items < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bool external = !options.path.empty();
+    CommodityList list;
+    CartTable carts(list);
+    RpcService service(list, carts);
+    RpcServer server([&service](const char* payload, size_t length, string& out) {
+        return service.handle(payload, length, out);
+    });
+    thread serverThread;
+    if (!external) {
+        fillSyntheticCatalog(list, options.items);
+        options.path = "/tmp/store-rpc-bench-" + to_string(getpid()) + ".sock";
+        string error;
+        if (!server.listenUnix(options.path, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+        serverThread = thread([&server]() { server.run(); });
+    }
+
+    RpcClient probe;
+    RpcBatch batch;
+    vector<RpcResult> results;
+    string error;
+    batch.catalogSize();
+    bool sized = probe.connect(options.path, error) && probe.call(batch, results) && results[0].value > 0;
+    probe.close();
+    int catalog = sized ? results[0].value : 0;
+
+    Result result;
+    auto start = Clock::now();
+    if (sized) {
+        auto deadline = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(options.seconds));
+        vector<thread> clients;
+        for (int i = 0; i < options.clients; i++) {
+            clients.emplace_back(runClient, cref(options), i, catalog, deadline, ref(result));
+        }
+        for (thread& client : clients) client.join();
+    }
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    if (!external) {
+        server.stop();
+        serverThread.join();
+    }
+    if (!sized) {
+        cerr << "Can not read the catalog from " << options.path << (error.empty() ? "" : ", " + error) << endl;
+        return 1;
+    }
+    if (result.broken) return 1;
+
+    LatencyHistogram& latency = result.latency;
+    printf("clients %d, batch %d, %d commodities, %.1f seconds\n", options.clients, options.batch, catalog, seconds);
+    printf("operations %lld, not OK %lld, %.0f operations/sec, %.0f batches/sec\n", result.operations.load(),
+           result.failures.load(), result.operations / seconds, latency.count() / seconds);
+    printf("batch latency(us) mean %.1f, p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n", latency.mean() / 1000.0,
+           latency.percentile(0.5) / 1000.0, latency.percentile(0.9) / 1000.0, latency.percentile(0.99) / 1000.0,
+           latency.max() / 1000.0);
+    return 0;
+}
@@ -0,0 +1,488 @@
+/*
+ * Micro benchmarks of the store data structures, see benchmark.h for the command line.
+ * This file holds the store-core benchmarks and main, hw1_bench.cpp holds the first homework ones.
+ */
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../core/StoreCore.h"
+#include "benchmark.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#define chdir _chdir
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+    struct Random {
+        unsigned long long seed = 88172645463325252ULL;
+
+        long long next(long long bound) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            return (long long) (seed % (unsigned long long) bound);
+        }
+    };
+
+    /*
+     * Create size commodities spread over every registered category, category i gets every i-th commodity.
+     */
+    vector<pair<Commodity*, int>> makeCommodities(long long size) {
+        vector<pair<Commodity*, int>> commodities;
+        commodities.reserve(size);
+        for (long long i = 0; i < size; i++) {
+            int category = (int) (i % CategoryRegistry::size());
+            Commodity* commodity = CategoryRegistry::get(category).create();
+            commodity->setField("name", CategoryRegistry::get(category).label + " " + to_string(i));
+            commodity->setField("price", to_string(100 + i % 5000));
+            commodity->setField("description", "synthetic commodity number " + to_string(i));
+            commodities.emplace_back(commodity, category);
+        }
+        return commodities;
+    }
+
+    void destroy(vector<pair<Commodity*, int>>& commodities) {
+        for (pair<Commodity*, int>& commodity : commodities) delete commodity.first;
+        commodities.clear();
+    }
+
+    void build(CommodityList& list, vector<pair<Commodity*, int>>& commodities) {
+        for (pair<Commodity*, int>& commodity : commodities) list.add(commodity.first, commodity.second);
+    }
+
+    void commodityListAdd(bench::State& state) {
+        vector<pair<Commodity*, int>> commodities = makeCommodities(state.size());
+        state.setItemsPerIteration(state.size());
+        while (state.keepRunning()) {
+            CommodityList list;
+            build(list, commodities);
+            bench::doNotOptimize(list);
+        }
+        destroy(commodities);
+    }
+
+    void commodityListAddBatch(bench::State& state) {
+        vector<pair<Commodity*, int>> commodities = makeCommodities(state.size());
+        state.setItemsPerIteration(state.size());
+        while (state.keepRunning()) {
+            CommodityList list;
+            vector<pair<Commodity*, int>> batch = commodities;
+            list.addBatch(batch);
+            bench::doNotOptimize(list);
+        }
+        destroy(commodities);
+    }
+
+    void commodityListGet(bench::State& state) {
+        vector<pair<Commodity*, int>> commodities = makeCommodities(state.size());
+        CommodityList list;
+        build(list, commodities);
+        Random random;
+        while (state.keepRunning()) {
+            Commodity* commodity = list.get((int) random.next(state.size()));
+            bench::doNotOptimize(commodity);
+        }
+        destroy(commodities);
+    }
+
+    void commodityListGetIndex(bench::State& state) {
+        vector<pair<Commodity*, int>> commodities = makeCommodities(state.size());
+        CommodityList list;
+        build(list, commodities);
+        Random random;
+        while (state.keepRunning()) {
+            int category = list.getIndex((int) random.next(state.size()));
+            bench::doNotOptimize(category);
+        }
+        destroy(commodities);
+    }
+
+    void commodityListIsExist(bench::State& state) {
+        vector<pair<Commodity*, int>> commodities = makeCommodities(state.size());
+        CommodityList list;
+        build(list, commodities);
+        Random random;
+        vector<Commodity*> probes;
+        for (int i = 0; i < 1024; i++) probes.push_back(commodities[random.next(state.size())].first);
+        size_t probe = 0;
+        while (state.keepRunning()) {
+            bool exist = list.isExist(probes[probe++ & 1023]);
+            bench::doNotOptimize(exist);
+        }
+        destroy(commodities);
+    }
+
+    void commodityListRemove(bench::State& state) {
+        vector<pair<Commodity*, int>> commodities = makeCommodities(state.size());
+        CommodityList list;
+        build(list, commodities);
+        int middle = (int) state.size() / 2;
+        while (state.keepRunning()) {
+            state.pauseTiming();
+            // The list owns what it removes, so a new commodity with the same name is pushed back
+            int category = list.getIndex(middle);
+            Commodity* copy = CategoryRegistry::get(category).create();
+            copy->setField("name", list.get(middle)->getName());
+            state.resumeTiming();
+            list.remove(middle);
+            state.pauseTiming();
+            list.add(copy, category);
+            state.resumeTiming();
+        }
+        for (int i = 0; i < list.size(); i++) delete list.get(i);
+    }
+
+    void shoppingCartPush(bench::State& state) {
+        vector<pair<Commodity*, int>> commodities = makeCommodities(state.size());
+        ShoppingCart cart;
+        Random random;
+        while (state.keepRunning()) {
+            pair<Commodity*, int>& commodity = commodities[random.next(state.size())];
+            cart.push(commodity.first, commodity.second);
+        }
+        destroy(commodities);
+    }
+
+    void shoppingCartRemove(bench::State& state) {
+        vector<pair<Commodity*, int>> commodities = makeCommodities(state.size());
+        ShoppingCart cart;
+        for (pair<Commodity*, int>& commodity : commodities) cart.push(commodity.first, commodity.second);
+        Random random;
+        while (state.keepRunning()) {
+            cart.remove(0);
+            state.pauseTiming();
+            pair<Commodity*, int>& commodity = commodities[random.next(state.size())];
+            cart.push(commodity.first, commodity.second);
+            state.resumeTiming();
+        }
+        destroy(commodities);
+    }
+
+    /*
+     * checkOut empties the cart, so it is refilled with 100 lines before every iteration.
+     */
+    void shoppingCartCheckOut(bench::State& state) {
+        vector<pair<Commodity*, int>> commodities = makeCommodities(state.size());
+        ShoppingCart cart;
+        long long lines = min(state.size(), 100LL);
+        state.setItemsPerIteration(lines);
+        while (state.keepRunning()) {
+            state.pauseTiming();
+            for (long long i = 0; i < lines; i++) cart.push(commodities[i].first, commodities[i].second);
+            state.resumeTiming();
+            int total = cart.checkOut();
+            bench::doNotOptimize(total);
+        }
+        destroy(commodities);
+    }
+
+    /*
+     * Many shoppers buy the same commodity at once. Every thread has its own cart and checks out one item at a time,
+     * the stock is half of the attempts, so the benchmark also checks that exactly the stock is sold.
+     */
+    void shoppingCartHotItem(bench::State& state) {
+        const int threads = 8;
+        const int attempts = 4096;
+        vector<pair<Commodity*, int>> commodities = makeCommodities(1);
+        Commodity* hot = commodities[0].first;
+        state.setItemsPerIteration((long long) threads * attempts);
+        while (state.keepRunning()) {
+            state.pauseTiming();
+            hot->setField("stock", to_string(threads * attempts / 2));
+            atomic<int> sold(0);
+            vector<thread> shoppers;
+            state.resumeTiming();
+            for (int i = 0; i < threads; i++) {
+                shoppers.emplace_back([hot, &sold]() {
+                    ShoppingCart cart;
+                    int bought = 0;
+                    for (int j = 0; j < attempts; j++) {
+                        if (cart.push(hot, 0)) bought += cart.checkOut() > 0 ? 1 : 0;
+                    }
+                    sold.fetch_add(bought);
+                });
+            }
+            for (thread& shopper : shoppers) shopper.join();
+            state.pauseTiming();
+            if (sold.load() != threads * attempts / 2 || hot->getStock() != 0) {
+                cerr << "hot item: " << sold.load() << " sold, " << hot->getStock() << " left" << endl;
+            }
+            state.resumeTiming();
+        }
+        destroy(commodities);
+    }
+
+    /*
+     * save() writes the files of the registry into the working directory, so main moves into a scratch directory.
+     */
+    void commodityListSave(bench::State& state) {
+        vector<pair<Commodity*, int>> commodities = makeCommodities(state.size());
+        CommodityList list;
+        build(list, commodities);
+        state.setItemsPerIteration(state.size());
+        while (state.keepRunning()) {
+            list.save();
+        }
+        destroy(commodities);
+    }
+
+    /*
+     * The same work as Store::load, every category file is read by RecordLoader.
+     */
+    void storeLoad(bench::State& state) {
+        vector<pair<Commodity*, int>> commodities = makeCommodities(state.size());
+        {
+            CommodityList list;
+            build(list, commodities);
+            list.save();
+        }
+        destroy(commodities);
+        state.setItemsPerIteration(state.size());
+        while (state.keepRunning()) {
+            CommodityList list;
+            for (int i = 0; i < CategoryRegistry::size(); i++) {
+                RecordLoader::Report report;
+                RecordLoader::load(CategoryRegistry::get(i).fileName, i, list, report);
+            }
+            state.pauseTiming();
+            for (int i = 0; i < list.categoryCount(); i++) {
+                for (Commodity* commodity : list.getCategory(i)) delete commodity;
+            }
+            state.resumeTiming();
+        }
+    }
+
+    /*
+     * A history of state.size() price changes of one commodity, one minute apart.
+     */
+    void buildHistory(PriceHistory& history, long long size) {
+        for (long long i = 0; i < size; i++) history.record(1, i * 60, (int) (1000 + i % 97));
+    }
+
+    void priceHistoryPriceAt(bench::State& state) {
+        PriceHistory history;
+        buildHistory(history, state.size());
+        Random random;
+        while (state.keepRunning()) {
+            int price;
+            bench::doNotOptimize(history.priceAt(1, random.next(state.size()) * 60 + 30, price));
+        }
+    }
+
+    // A period of a tenth of the history
+    void priceHistoryRange(bench::State& state) {
+        PriceHistory history;
+        buildHistory(history, state.size());
+        Random random;
+        while (state.keepRunning()) {
+            long long from = random.next(state.size()) * 60;
+            int lowest;
+            int highest;
+            bench::doNotOptimize(history.range(1, from, from + state.size() * 6, lowest, highest));
+        }
+    }
+
+    // A month of state.size() checkouts of three lines over a thousand commodities, the log is never opened
+    void salesLogSummarize(bench::State& state) {
+        SalesLog log("");
+        Random random;
+        vector<ShoppingCart::SoldLine> lines(3);
+        long long month = 30LL * 24 * 60 * 60;
+        for (long long i = 0; i < state.size(); i++) {
+            for (ShoppingCart::SoldLine& line : lines) {
+                line.id = random.next(1000) + 1;
+                line.category = (int) (line.id % 3);
+                line.quantity = (int) random.next(4) + 1;
+                line.price = (int) random.next(500) + 1;
+            }
+            log.append(i * month / state.size(), lines);
+        }
+        state.setItemsPerIteration(state.size());
+        SalesLog::Report report;
+        while (state.keepRunning()) {
+            log.summarize(0, month, report, 10);
+            bench::doNotOptimize(report.revenue);
+        }
+    }
+
+    /*
+     * A checkout of four random commodities out of state.size().
+     */
+    void randomBasket(Random& random, long long size, vector<uint64_t>& ids) {
+        ids.clear();
+        for (int i = 0; i < 4; i++) ids.push_back(random.next(size) + 1);
+    }
+
+    // The update of one checkout, the index already holds state.size() checkouts
+    void boughtTogetherAdd(bench::State& state) {
+        BoughtTogether index;
+        Random random;
+        vector<uint64_t> ids;
+        for (long long i = 0; i < state.size(); i++) {
+            randomBasket(random, state.size(), ids);
+            index.add(ids);
+        }
+        while (state.keepRunning()) {
+            state.pauseTiming();
+            randomBasket(random, state.size(), ids);
+            state.resumeTiming();
+            index.add(ids);
+        }
+    }
+
+    /*
+     * A checkout of ten lines against state.size() promotions over ten thousand commodities: a tier or a bundle of
+     * two commodities for most of them, and a deal on a category for every hundredth.
+     */
+    void promotionsApply(bench::State& state) {
+        const long long catalog = 10000;
+        vector<pair<Commodity*, int>> commodities = makeCommodities(catalog);
+        CommodityList list;
+        build(list, commodities);
+        Promotions promotions;
+        Random random;
+        for (long long i = 0; i < state.size(); i++) {
+            const pair<Commodity*, int>& first = commodities[random.next(catalog)];
+            const pair<Commodity*, int>& second = commodities[random.next(catalog)];
+            string percent = to_string(1 + random.next(30));
+            if (i % 100 == 0) {
+                promotions.add({{"category", CategoryRegistry::get(first.second).label}, {"percent", percent}});
+            } else if (i % 2 == 0) {
+                promotions.add({{"commodity", first.first->getName()}, {"quantity", "2"}, {"percent", percent}});
+            } else {
+                promotions.add({{"bundle", first.first->getName() + "+" + second.first->getName()},
+                                {"percent", percent}});
+            }
+        }
+        promotions.compile(list);
+
+        vector<ShoppingCart::SoldLine> lines(10);
+        for (ShoppingCart::SoldLine& line : lines) {
+            const pair<Commodity*, int>& chosen = commodities[random.next(catalog)];
+            line = {chosen.first->getId(), chosen.second, (int) random.next(3) + 1, chosen.first->getPrice(), 0};
+        }
+        while (state.keepRunning()) {
+            bench::doNotOptimize(promotions.apply(lines));
+        }
+        destroy(commodities);
+    }
+
+    // A batch of state.size() checkouts of four lines, spread over four regions
+    void checkoutPricingBatch(bench::State& state) {
+        CheckoutPricing pricing;
+        pricing.add({{"region", "EU"}, {"currency", "EUR"}, {"rate", "0.92"}, {"tax", "20"}, {"tax.Laptop", "19.5"}});
+        pricing.add({{"region", "JP"}, {"currency", "JPY"}, {"decimals", "0"}, {"rate", "151.37"}, {"tax", "10"}});
+        pricing.add({{"region", "UK"}, {"currency", "GBP"}, {"rate", "0.79"}, {"tax", "20"}});
+        Random random;
+        vector<int> regions;
+        vector<ShoppingCart::SoldLine> lines;
+        vector<uint32_t> firstLine(1, 0);
+        for (long long i = 0; i < state.size(); i++) {
+            regions.push_back((int) random.next(pricing.size()));
+            for (int j = 0; j < 4; j++) {
+                int price = (int) random.next(50000) + 100;
+                lines.push_back({0, (int) random.next(CategoryRegistry::size()), (int) random.next(3) + 1, price,
+                                 (int) random.next(price / 10)});
+            }
+            firstLine.push_back((uint32_t) lines.size());
+        }
+        vector<CheckoutPricing::Totals> totals;
+        state.setItemsPerIteration(state.size());
+        while (state.keepRunning()) {
+            pricing.priceBatch(regions, lines, firstLine, totals);
+            bench::doNotOptimize(totals);
+        }
+    }
+
+    // The counts of every laptop attribute with a pick on two of them, over state.size() laptops
+    void facetIndexCount(bench::State& state) {
+        int laptop = 0;
+        while (laptop < CategoryRegistry::size() - 1 && CategoryRegistry::get(laptop).label != "Laptop") laptop++;
+        const char* systems[] = {"Windows 10", "Windows 11", "macOS", "Ubuntu 22.04", "Chrome OS"};
+        Random random;
+        CommodityList list;
+        for (long long i = 0; i < state.size(); i++) {
+            Commodity* commodity = CategoryRegistry::get(laptop).create();
+            commodity->setField("name", "Laptop " + to_string(i));
+            commodity->setField("memory_size", to_string(8 << random.next(4)));
+            commodity->setField("disk_size", to_string(256 << random.next(4)));
+            commodity->setField("os", systems[random.next(5)]);
+            commodity->setField("rgb", to_string(1 + random.next(2)));
+            list.add(commodity, laptop);
+        }
+        FacetIndex index(laptop);
+        index.update(list);
+        vector<vector<int>> picks(index.facetCount());
+        picks[0] = {1, 2};
+        picks[2] = {0};
+        vector<vector<long long>> counts;
+        RoaringBitmap matches;
+        while (state.keepRunning()) {
+            index.count(picks, counts, &matches);
+            bench::doNotOptimize(counts);
+        }
+        for (Commodity* commodity : list.getCategory(laptop)) delete commodity;
+    }
+
+    void boughtTogetherSuggest(bench::State& state) {
+        BoughtTogether index;
+        Random random;
+        vector<uint64_t> ids;
+        for (long long i = 0; i < state.size(); i++) {
+            randomBasket(random, state.size(), ids);
+            index.add(ids);
+        }
+        uint64_t suggested[BoughtTogether::NEIGHBOURS];
+        while (state.keepRunning()) {
+            bench::doNotOptimize(index.suggest(random.next(state.size()) + 1, suggested, 3));
+        }
+    }
+}
+
+STORE_BENCHMARK("hw2/CommodityList/add", commodityListAdd);
+STORE_BENCHMARK("hw2/CommodityList/addBatch", commodityListAddBatch);
+STORE_BENCHMARK("hw2/CommodityList/get", commodityListGet);
+STORE_BENCHMARK("hw2/CommodityList/getIndex", commodityListGetIndex);
+STORE_BENCHMARK("hw2/CommodityList/isExist", commodityListIsExist);
+STORE_BENCHMARK("hw2/CommodityList/remove", commodityListRemove);
+STORE_BENCHMARK("hw2/ShoppingCart/push", shoppingCartPush);
+STORE_BENCHMARK("hw2/ShoppingCart/remove", shoppingCartRemove);
+STORE_BENCHMARK("hw2/ShoppingCart/checkOut", shoppingCartCheckOut);
+STORE_BENCHMARK("hw2/ShoppingCart/hotItem", shoppingCartHotItem);
+STORE_BENCHMARK("hw2/CommodityList/save", commodityListSave);
+STORE_BENCHMARK("hw2/Store/load", storeLoad);
+STORE_BENCHMARK("hw2/PriceHistory/priceAt", priceHistoryPriceAt);
+STORE_BENCHMARK("hw2/PriceHistory/range", priceHistoryRange);
+STORE_BENCHMARK("hw2/SalesLog/summarize", salesLogSummarize);
+STORE_BENCHMARK("hw2/BoughtTogether/add", boughtTogetherAdd);
+STORE_BENCHMARK("hw2/BoughtTogether/suggest", boughtTogetherSuggest);
+STORE_BENCHMARK("hw2/Promotions/apply", promotionsApply);
+STORE_BENCHMARK("hw2/CheckoutPricing/priceBatch", checkoutPricingBatch);
+STORE_BENCHMARK("hw2/FacetIndex/count", facetIndexCount);
+
+int main(int argc, char** argv) {
+    // The catalog files are written and read in a scratch directory, not beside the real catalog
+    string directory = "store-bench-data";
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+    if (chdir(directory.c_str()) != 0) {
+        cerr << "Can not enter " << directory << endl;
+        return 1;
+    }
+    return bench::runAll(argc, argv, {1000, 10000});
+}
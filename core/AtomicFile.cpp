@@ -0,0 +1,176 @@
+#include "AtomicFile.h"
+
+#include <cstring>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define STORE_CRC32C_X86
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define STORE_CRC32C_ARM
+#endif
+
+using namespace std;
+
+namespace {
+
+    /*
+     * Make a rename inside the directory of the file durable, the directory entry is flushed as well.
+     */
+    void syncDirectory(const string& fileName) {
+#ifndef _WIN32
+        size_t slash = fileName.find_last_of('/');
+        string directory = slash == string::npos ? "." : fileName.substr(0, slash + 1);
+        int descriptor = open(directory.c_str(), O_RDONLY);
+        if (descriptor >= 0) {
+            fsync(descriptor);
+            close(descriptor);
+        }
+#endif
+    }
+
+    uint32_t updateByTable(uint32_t crc, const char* data, size_t length) {
+        static const vector<uint32_t> table = []() {
+            vector<uint32_t> entries(256);
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t value = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    value = (value & 1) ? (value >> 1) ^ 0x82F63B78u : value >> 1;
+                }
+                entries[i] = value;
+            }
+            return entries;
+        }();
+        for (size_t i = 0; i < length; i++) {
+            crc = table[(crc ^ (unsigned char) data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+#if defined(STORE_CRC32C_X86)
+    bool hardware() {
+        static const bool supported = __builtin_cpu_supports("sse4.2");
+        return supported;
+    }
+
+    __attribute__((target("sse4.2")))
+    uint32_t updateSSE42(uint32_t crc, const char* data, size_t length) {
+        uint64_t value = crc;
+        for (; length >= 8; data += 8, length -= 8) {
+            uint64_t chunk;
+            memcpy(&chunk, data, 8);
+            value = _mm_crc32_u64(value, chunk);
+        }
+        crc = (uint32_t) value;
+        for (; length > 0; data++, length--) {
+            crc = _mm_crc32_u8(crc, (unsigned char) *data);
+        }
+        return crc;
+    }
+#elif defined(STORE_CRC32C_ARM)
+    uint32_t updateARM(uint32_t crc, const char* data, size_t length) {
+        for (; length >= 8; data += 8, length -= 8) {
+            uint64_t chunk;
+            memcpy(&chunk, data, 8);
+            crc = __crc32cd(crc, chunk);
+        }
+        for (; length > 0; data++, length--) {
+            crc = __crc32cb(crc, (unsigned char) *data);
+        }
+        return crc;
+    }
+#endif
+}
+
+uint32_t Crc32c::update(uint32_t crc, const char* data, size_t length) {
+    crc = ~crc;
+#if defined(STORE_CRC32C_X86)
+    if (hardware()) return ~updateSSE42(crc, data, length);
+#elif defined(STORE_CRC32C_ARM)
+    return ~updateARM(crc, data, length);
+#endif
+    return ~updateByTable(crc, data, length);
+}
+
+uint32_t Crc32c::updateTable(uint32_t crc, const char* data, size_t length) {
+    return ~updateByTable(~crc, data, length);
+}
+
+bool AtomicFileWriter::flushBuffer() {
+    size_t length = pptr() - pbase();
+    if (length == 0) return !error;
+    crc = Crc32c::update(crc, pbase(), length);
+    if (fwrite(pbase(), 1, length, file) != length) error = true;
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return !error;
+}
+
+AtomicFileWriter::int_type AtomicFileWriter::overflow(int_type c) {
+    if (!flushBuffer()) return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int AtomicFileWriter::sync() {
+    return flushBuffer() ? 0 : -1;
+}
+
+AtomicFileWriter::AtomicFileWriter(const string& fileName)
+        : fileName(fileName), tempName(fileName + ".tmp"), buffer(1 << 16) {
+    file = fopen(tempName.c_str(), "wb");
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+AtomicFileWriter::~AtomicFileWriter() {
+    if (file != nullptr) {
+        fclose(file);
+        remove(tempName.c_str());
+    }
+}
+
+bool AtomicFileWriter::commit() {
+    if (file == nullptr || !flushBuffer()) return false;
+    string line = trailer(crc);
+    bool written = fwrite(line.data(), 1, line.size(), file) == line.size() && fflush(file) == 0;
+#ifdef _WIN32
+    written = written && _commit(_fileno(file)) == 0;
+#else
+    written = written && fsync(fileno(file)) == 0;
+#endif
+    written = (fclose(file) == 0) && written;
+    file = nullptr;
+    if (!written) {
+        remove(tempName.c_str());
+        return false;
+    }
+    return replace(tempName, fileName);
+}
+
+string AtomicFileWriter::trailer(uint32_t crc) {
+    char line[32];
+    int length = snprintf(line, sizeof(line), "#crc32c %08x\n", crc);
+    return string(line, (size_t) length);
+}
+
+bool AtomicFileWriter::replace(const string& tempName, const string& fileName) {
+#ifdef _WIN32
+    if (!MoveFileExA(tempName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+#else
+    if (rename(tempName.c_str(), fileName.c_str()) != 0) {
+#endif
+        remove(tempName.c_str());
+        return false;
+    }
+    syncDirectory(fileName);
+    return true;
+}
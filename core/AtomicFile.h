@@ -0,0 +1,77 @@
+#ifndef STORE_CORE_ATOMIC_FILE_H
+#define STORE_CORE_ATOMIC_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+/*
+ * Crc32c compute the CRC32C (Castagnoli) checksum used by the catalog files.
+ * The SSE4.2 or ARMv8 CRC instruction is used when the CPU has it, otherwise a lookup table.
+ * Chain the calls to checksum data in several pieces: crc = Crc32c::update(crc, data, length), starting from 0.
+ */
+class Crc32c {
+public:
+    static uint32_t update(uint32_t crc, const char* data, size_t length);
+
+    /*
+     * The same checksum through the lookup table only, whatever the CPU has, so the two paths can be compared.
+     */
+    static uint32_t updateTable(uint32_t crc, const char* data, size_t length);
+};
+
+/*
+ * AtomicFileWriter replace a file without ever leaving it half written.
+ * The data goes to "<fileName>.tmp" through this stream buffer, and the CRC32C of everything written is kept.
+ * commit() append the trailer line "#crc32c <8 hex digits>", flush the file to the disk, then rename it over the
+ * original file. If commit() is not called, the temporary file is removed and the original file is untouched.
+ * Use it with an ostream: AtomicFileWriter writer(name); ostream out(&writer); ... writer.commit();
+ */
+class AtomicFileWriter : public std::streambuf {
+private:
+    std::string fileName;
+    std::string tempName;
+    FILE* file;
+    std::vector<char> buffer;
+    uint32_t crc = 0;
+    bool error = false;
+
+    bool flushBuffer();
+
+protected:
+    int_type overflow(int_type c) override;
+
+    int sync() override;
+
+public:
+    explicit AtomicFileWriter(const std::string& fileName);
+
+    ~AtomicFileWriter() override;
+
+    bool isOpen() {
+        return file != nullptr;
+    }
+
+    /*
+     * Finish the file and move it to its final name.
+     * OUTPUT: Bool. False if anything fails, the original file is then left as it was
+     */
+    bool commit();
+
+    /*
+     * The trailer line commit() append, for a writer which builds the whole file itself.
+     * INPUT: The CRC32C of everything before the trailer
+     */
+    static std::string trailer(uint32_t crc);
+
+    /*
+     * Move a complete and flushed temporary file over the final name, and flush the directory entry so the rename
+     * itself is durable. The temporary file is removed if the rename fails.
+     * OUTPUT: Bool. False if the rename fails
+     */
+    static bool replace(const std::string& tempName, const std::string& fileName);
+};
+
+#endif
@@ -0,0 +1,49 @@
+#include "BoughtTogether.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+void BoughtTogether::bump(Row& row, uint64_t neighbour) {
+    int slot = 0;
+    while (slot < row.used && row.ids[slot] != neighbour) slot++;
+    if (slot == row.used) {
+        if (row.used < NEIGHBOURS) {
+            row.ids[slot] = neighbour;
+            row.counts[slot] = 0;
+            row.used++;
+        } else {
+            // The row is full, the lightest neighbour gives its slot away
+            slot = NEIGHBOURS - 1;
+            row.ids[slot] = neighbour;
+        }
+    }
+    row.counts[slot]++;
+    // Keep the largest count first, the slot moves up past the neighbours it has overtaken
+    while (slot > 0 && row.counts[slot - 1] < row.counts[slot]) {
+        swap(row.ids[slot - 1], row.ids[slot]);
+        swap(row.counts[slot - 1], row.counts[slot]);
+        slot--;
+    }
+}
+
+void BoughtTogether::add(const vector<uint64_t>& ids) {
+    basket.assign(ids.begin(), ids.begin() + min(ids.size(), (size_t) MAX_BASKET));
+    sort(basket.begin(), basket.end());
+    basket.erase(unique(basket.begin(), basket.end()), basket.end());
+    for (uint64_t id : basket) {
+        Row& row = rows[id];
+        for (uint64_t other : basket) {
+            if (other != id) bump(row, other);
+        }
+    }
+}
+
+int BoughtTogether::suggest(uint64_t id, uint64_t* out, int count) const {
+    auto found = rows.find(id);
+    if (found == rows.end()) return 0;
+    int written = min(count, found->second.used);
+    copy(found->second.ids, found->second.ids + written, out);
+    return written;
+}
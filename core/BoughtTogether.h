@@ -0,0 +1,71 @@
+#ifndef STORE_CORE_BOUGHT_TOGETHER_H
+#define STORE_CORE_BOUGHT_TOGETHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * BoughtTogether count which commodities are bought in the same checkout, so the shop can tell "customers also
+ * bought" for a commodity.
+ * Every commodity ever sold has one row of NEIGHBOURS slots, by commodity id. A slot holds the id of another
+ * commodity and the number of checkouts which had both, and the slots are kept with the largest count first. When a
+ * new commodity does not fit a full row, it takes the last slot and the count of that slot plus one (the space saving
+ * way to keep the heaviest pairs), so the memory is bounded by the number of commodities and a count is never below
+ * the true one. A lookup is one hash lookup and the copy of a row.
+ * The object is used by the thread which owns the list.
+ */
+class BoughtTogether {
+public:
+    // The commodities kept for every commodity
+    static const int NEIGHBOURS = 8;
+    // Only the first commodities of a larger checkout are counted, the update of a checkout grows with its square
+    static const int MAX_BASKET = 32;
+
+    /*
+     * Count a completed checkout.
+     * INPUT: The ids of the commodities bought, a repeated id is counted once
+     * OUTPUT: None
+     */
+    void add(const std::vector<uint64_t>& ids);
+
+    /*
+     * Find the commodities bought most often with a commodity.
+     * INPUT: The commodity id, the array to receive the ids, the most bought first, and its length
+     * OUTPUT: Integer. The number of ids written
+     */
+    int suggest(uint64_t id, uint64_t* out, int count) const;
+
+    /*
+     * Drop the row of a removed commodity. It is still named in the rows of others until it is pushed out.
+     */
+    void erase(uint64_t id) {
+        rows.erase(id);
+    }
+
+    /*
+     * Return the number of commodities with a row
+     */
+    size_t size() const {
+        return rows.size();
+    }
+
+private:
+    struct Row {
+        uint64_t ids[NEIGHBOURS];
+        uint32_t counts[NEIGHBOURS];
+        int used = 0;
+    };
+
+    std::unordered_map<uint64_t, Row> rows;
+    // The distinct ids of the checkout being added, reused by every add()
+    std::vector<uint64_t> basket;
+
+    /*
+     * Count one more checkout with both the owner of the row and neighbour.
+     */
+    static void bump(Row& row, uint64_t neighbour);
+};
+
+#endif
@@ -0,0 +1,229 @@
+#include "CartStore.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "AtomicFile.h"
+#include "Varint.h"
+
+using namespace std;
+
+namespace {
+
+    const size_t HEADER_SIZE = 12;
+    const uint32_t MAX_PART = 1 << 24;
+    // A log smaller than this is never compacted
+    const long long MIN_COMPACT_BYTES = 1 << 20;
+
+    /*
+     * Build the record of a key, see CartStore.
+     */
+    string makeRecord(const string& key, const string& value) {
+        string record(HEADER_SIZE, '\0');
+        Varint::putFixed32(&record[4], (uint32_t) key.size());
+        Varint::putFixed32(&record[8], (uint32_t) value.size());
+        record += key;
+        record += value;
+        Varint::putFixed32(&record[0], Crc32c::update(0, record.data() + 4, record.size() - 4));
+        return record;
+    }
+
+    bool syncFile(FILE* file) {
+        if (fflush(file) != 0) return false;
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+}
+
+const char* const CartStore::DEFAULT_FILE = "ShoppingCarts.db";
+
+CartStore::CartStore(string fileName, size_t capacity) : fileName(move(fileName)), capacity(capacity) {}
+
+CartStore::~CartStore() {
+    if (file != nullptr) fclose(file);
+}
+
+bool CartStore::open() {
+    file = fopen(fileName.c_str(), "a+b");
+    if (file == nullptr) return false;
+    fseek(file, 0, SEEK_SET);
+
+    long long offset = 0;
+    bool torn = false;
+    char header[HEADER_SIZE];
+    string body;
+    while (true) {
+        size_t got = fread(header, 1, HEADER_SIZE, file);
+        if (got == 0) break;
+        uint32_t keySize = got == HEADER_SIZE ? Varint::getFixed32(header + 4) : 0;
+        uint32_t valueSize = got == HEADER_SIZE ? Varint::getFixed32(header + 8) : 0;
+        if (got < HEADER_SIZE || keySize == 0 || keySize > MAX_PART || valueSize > MAX_PART) {
+            torn = true;
+            break;
+        }
+        body.resize(keySize + valueSize);
+        if (fread(&body[0], 1, body.size(), file) != body.size() ||
+            Crc32c::update(Crc32c::update(0, header + 4, HEADER_SIZE - 4), body.data(), body.size()) !=
+            Varint::getFixed32(header)) {
+            torn = true;
+            break;
+        }
+
+        string key = body.substr(0, keySize);
+        uint32_t size = (uint32_t) (HEADER_SIZE + body.size());
+        auto found = index.find(key);
+        if (found != index.end()) {
+            liveBytes -= found->second.size;
+            index.erase(found);
+        }
+        if (valueSize != 0) {
+            index[key] = {offset, size};
+            liveBytes += size;
+        }
+        offset += size;
+    }
+    fileBytes = offset;
+    // The records after a torn one can not be trusted, the file is rewritten without them
+    return !torn || compact();
+}
+
+bool CartStore::read(const Record& record, string& bytes) {
+    bytes.resize(record.size);
+    if (fseek(file, (long) record.offset, SEEK_SET) != 0) return false;
+    return fread(&bytes[0], 1, bytes.size(), file) == bytes.size();
+}
+
+bool CartStore::append(const string& key, const string& value) {
+    if (file == nullptr) return false;
+    string record = makeRecord(key, value);
+    fseek(file, 0, SEEK_END);
+    if (fwrite(record.data(), 1, record.size(), file) != record.size() || fflush(file) != 0) return false;
+
+    auto found = index.find(key);
+    if (found != index.end()) {
+        liveBytes -= found->second.size;
+        index.erase(found);
+    }
+    if (!value.empty()) {
+        index[key] = {fileBytes, (uint32_t) record.size()};
+        liveBytes += (long long) record.size();
+    }
+    fileBytes += (long long) record.size();
+    if (fileBytes >= MIN_COMPACT_BYTES && fileBytes > 2 * liveBytes) compact();
+    return true;
+}
+
+bool CartStore::compact() {
+    string tempName = fileName + ".tmp";
+    FILE* out = fopen(tempName.c_str(), "wb");
+    if (out == nullptr) return false;
+
+    unordered_map<string, Record> moved;
+    long long offset = 0;
+    bool written = true;
+    string bytes;
+    for (const pair<const string, Record>& entry : index) {
+        if (!read(entry.second, bytes) || fwrite(bytes.data(), 1, bytes.size(), out) != bytes.size()) {
+            written = false;
+            break;
+        }
+        moved[entry.first] = {offset, entry.second.size};
+        offset += entry.second.size;
+    }
+    written = syncFile(out) && written;
+    written = fclose(out) == 0 && written;
+    if (!written) {
+        remove(tempName.c_str());
+        return false;
+    }
+
+    fclose(file);
+    bool replaced = AtomicFileWriter::replace(tempName, fileName);
+    file = fopen(fileName.c_str(), "a+b");
+    if (!replaced || file == nullptr) return false;
+    index.swap(moved);
+    fileBytes = liveBytes = offset;
+    return true;
+}
+
+void CartStore::remember(const string& key, const string& value) {
+    auto found = recentIndex.find(key);
+    if (found != recentIndex.end()) {
+        found->second->second = value;
+        recent.splice(recent.begin(), recent, found->second);
+        return;
+    }
+    recent.emplace_front(key, value);
+    recentIndex[key] = recent.begin();
+    if (recent.size() > capacity) {
+        recentIndex.erase(recent.back().first);
+        recent.pop_back();
+    }
+}
+
+void CartStore::forget(const string& key) {
+    auto found = recentIndex.find(key);
+    if (found == recentIndex.end()) return;
+    recent.erase(found->second);
+    recentIndex.erase(found);
+}
+
+bool CartStore::save(const string& name, ShoppingCart& cart) {
+    if (cart.empty()) return erase(name);
+    string value;
+    Varint::put(value, (uint64_t) cart.size());
+    for (int i = 0; i < cart.categoryCount(); i++) {
+        for (const ShoppingCart::CartEntry& entry : cart.getCategory(i)) {
+            Varint::put(value, entry.id);
+            Varint::put(value, (uint64_t) entry.quantity);
+        }
+    }
+    // A session which did not change its cart writes nothing
+    auto found = recentIndex.find(name);
+    if (found != recentIndex.end() && found->second->second == value) return true;
+    if (!append(name, value)) return false;
+    remember(name, value);
+    return true;
+}
+
+bool CartStore::resume(const string& name, CommodityList& list, ShoppingCart& cart, int* missing) {
+    string value;
+    auto cached = recentIndex.find(name);
+    if (cached != recentIndex.end()) {
+        value = cached->second->second;
+        recent.splice(recent.begin(), recent, cached->second);
+    } else {
+        auto found = index.find(name);
+        if (found == index.end() || !read(found->second, value)) return false;
+        value.erase(0, HEADER_SIZE + name.size());
+        remember(name, value);
+    }
+
+    const char* in = value.data();
+    const char* end = in + value.size();
+    uint64_t lines;
+    if (!Varint::get(in, end, lines)) return false;
+    for (uint64_t i = 0; i < lines; i++) {
+        uint64_t id;
+        uint64_t quantity;
+        if (!Varint::get(in, end, id) || !Varint::get(in, end, quantity)) return false;
+        int category;
+        Commodity* commodity = list.find(id, category);
+        if (commodity == nullptr || !cart.append(commodity, category, (int) quantity)) {
+            if (missing != nullptr) (*missing)++;
+        }
+    }
+    return true;
+}
+
+bool CartStore::erase(const string& name) {
+    forget(name);
+    if (index.count(name) == 0) return true;
+    return append(name, "");
+}
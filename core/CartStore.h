@@ -0,0 +1,112 @@
+#ifndef STORE_CORE_CART_STORE_H
+#define STORE_CORE_CART_STORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CommodityList.h"
+#include "ShoppingCart.h"
+
+/*
+ * CartStore keep the carts by name in a local key-value file, so a cart outlives the session which filled it and
+ * every front end working on the same directory sees the same carts.
+ * The file is a log of records: u32 CRC32C of the rest of the record, u32 key length, u32 value length, the key and
+ * the value. The last record of a key wins, and an empty value erases the key. open() reads the log once and keeps
+ * the offset of the live record of every key, a torn record at the end of the file is dropped by rewriting the file.
+ * When more than half of a large file is old records, the live ones are rewritten into a new file which replaces the
+ * old one, like AtomicFileWriter does.
+ * A value is the lines of a cart: a varint line count, then for each line the varint id of the commodity and a
+ * varint quantity, so a line is resumed by one lookup in the id table of the list. The values of the carts used last
+ * are kept in memory, so a returning session resumes its cart without reading the file.
+ * A cart is saved when its session ends, the records are flushed to the system but not to the disk one by one.
+ * The object is used by one thread at a time, and only one process opens a file.
+ */
+class CartStore {
+private:
+    struct Record {
+        long long offset;
+        uint32_t size;
+    };
+
+    std::string fileName;
+    FILE* file = nullptr;
+    long long fileBytes = 0;
+    long long liveBytes = 0;
+    std::unordered_map<std::string, Record> index;
+
+    // The values of the carts used last, the front of the list is the newest
+    size_t capacity;
+    std::list<std::pair<std::string, std::string>> recent;
+    std::unordered_map<std::string, std::list<std::pair<std::string, std::string>>::iterator> recentIndex;
+
+    bool append(const std::string& key, const std::string& value);
+
+    /*
+     * Read the whole record, header included.
+     */
+    bool read(const Record& record, std::string& bytes);
+
+    void remember(const std::string& key, const std::string& value);
+
+    void forget(const std::string& key);
+
+    /*
+     * Write the live records into a new file and move it over the log.
+     * OUTPUT: Bool. False if the new file can not be written, the old log is kept then
+     */
+    bool compact();
+
+public:
+    // The file the front ends keep their carts in, beside the catalog files
+    static const char* const DEFAULT_FILE;
+
+    /*
+     * INPUT: The file name, and the number of carts kept in memory (option)
+     */
+    explicit CartStore(std::string fileName, size_t capacity = 1024);
+
+    ~CartStore();
+
+    CartStore(const CartStore&) = delete;
+    CartStore& operator=(const CartStore&) = delete;
+
+    /*
+     * Read the log, the file is created when it does not exist.
+     * OUTPUT: Bool. False if the file can not be opened
+     */
+    bool open();
+
+    /*
+     * Save the lines of a cart under its name, an empty cart erases the name.
+     * OUTPUT: Bool. False if the record can not be written
+     */
+    bool save(const std::string& name, ShoppingCart& cart);
+
+    /*
+     * Fill an empty cart with the saved lines of name. A line whose commodity is no longer in the list, or whose
+     * stock can not be reserved again, is not restored and is counted in missing.
+     * INPUT: The cart name, the list to find the commodities in, the cart, and the number of missing lines (option)
+     * OUTPUT: Bool. False if nothing is saved under name
+     */
+    bool resume(const std::string& name, CommodityList& list, ShoppingCart& cart, int* missing = nullptr);
+
+    /*
+     * Erase the cart saved under name.
+     * OUTPUT: Bool. False if the record can not be written
+     */
+    bool erase(const std::string& name);
+
+    /*
+     * Return the number of saved carts
+     */
+    size_t size() {
+        return index.size();
+    }
+};
+
+#endif
@@ -0,0 +1,325 @@
+#include "CatalogExporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "AtomicFile.h"
+#include "Json.h"
+
+using namespace std;
+
+namespace {
+
+    enum Format {CSV, JSONL, BINARY};
+
+    /*
+     * A fixed size buffer in front of the file. It is only written when it is full or flushed.
+     */
+    class OutputBuffer {
+    private:
+        FILE* file;
+        vector<char> data;
+        size_t used = 0;
+        long long total = 0;
+        bool error = false;
+
+    public:
+        OutputBuffer(FILE* file, size_t size) : file(file), data(size) {}
+
+        void flush() {
+            if (used == 0) return;
+            if (fwrite(data.data(), 1, used, file) != used) error = true;
+            total += (long long) used;
+            used = 0;
+        }
+
+        void append(const char* text, size_t length) {
+            if (used + length > data.size()) {
+                flush();
+                if (length > data.size()) data.resize(length);
+            }
+            memcpy(&data[used], text, length);
+            used += length;
+        }
+
+        void append(const string& text) {
+            append(text.data(), text.size());
+        }
+
+        void put(char c) {
+            if (used == data.size()) flush();
+            data[used++] = c;
+        }
+
+        void appendInt(long long value) {
+            char digits[24];
+            char* end = digits + sizeof(digits);
+            char* p = end;
+            unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long) value : (unsigned long long) value;
+            do {
+                *--p = (char) ('0' + magnitude % 10);
+                magnitude /= 10;
+            } while (magnitude != 0);
+            if (value < 0) *--p = '-';
+            append(p, end - p);
+        }
+
+        bool failed() {
+            return error;
+        }
+
+        long long written() {
+            return total;
+        }
+    };
+
+    /*
+     * Collect the attribute names of a commodity type.
+     */
+    class KeyCollector : public FieldVisitor {
+    public:
+        vector<string> keys;
+
+        void field(const char* key, const string&) override {
+            keys.push_back(key);
+        }
+
+        void field(const char* key, int) override {
+            keys.push_back(key);
+        }
+    };
+
+    class CSVWriter : public FieldVisitor {
+    private:
+        OutputBuffer& output;
+        vector<string> columns;
+        vector<vector<int>> columnOf;
+        vector<const string*> textCells;
+        vector<int> numberCells;
+        vector<char> kinds;
+        const vector<int>* order = nullptr;
+        size_t visited = 0;
+
+        void appendCell(const string& text) {
+            if (text.find_first_of(",\"\r\n") == string::npos) {
+                output.append(text);
+                return;
+            }
+            output.put('"');
+            for (char c : text) {
+                if (c == '"') output.put('"');
+                output.put(c);
+            }
+            output.put('"');
+        }
+
+    public:
+        /*
+         * The columns are decided once from an empty object of every exported category. columnOf keeps, for each
+         * category, the column of every attribute in visitFields order, so a row is written without any lookup.
+         */
+        CSVWriter(OutputBuffer& output, const vector<int>& categories) : output(output) {
+            columns.push_back("category");
+            columnOf.resize(CategoryRegistry::size());
+            for (int i : categories) {
+                KeyCollector collector;
+                Commodity* prototype = CategoryRegistry::get(i).create();
+                prototype->visitFields(collector);
+                delete prototype;
+                for (const string& key : collector.keys) {
+                    size_t column = find(columns.begin(), columns.end(), key) - columns.begin();
+                    if (column == columns.size()) columns.push_back(key);
+                    columnOf[i].push_back((int) column);
+                }
+            }
+            textCells.resize(columns.size());
+            numberCells.resize(columns.size());
+            kinds.resize(columns.size());
+        }
+
+        void header() {
+            for (size_t i = 0; i < columns.size(); i++) {
+                if (i != 0) output.put(',');
+                output.append(columns[i]);
+            }
+            output.put('\n');
+        }
+
+        void write(Commodity* commodity, int category) {
+            fill(kinds.begin(), kinds.end(), 0);
+            order = &columnOf[category];
+            visited = 0;
+            commodity->visitFields(*this);
+
+            appendCell(CategoryRegistry::get(category).label);
+            for (size_t i = 1; i < columns.size(); i++) {
+                output.put(',');
+                if (kinds[i] == 1) appendCell(*textCells[i]);
+                else if (kinds[i] == 2) output.appendInt(numberCells[i]);
+            }
+            output.put('\n');
+        }
+
+        void field(const char*, const string& value) override {
+            int column = (*order)[visited++];
+            kinds[column] = 1;
+            textCells[column] = &value;
+        }
+
+        void field(const char*, int value) override {
+            int column = (*order)[visited++];
+            kinds[column] = 2;
+            numberCells[column] = value;
+        }
+    };
+
+    class JSONWriter : public FieldVisitor {
+    private:
+        OutputBuffer& output;
+        // The escaped string being written, reused by every value
+        string escaped;
+
+        void appendString(const string& text) {
+            escaped.clear();
+            Json::appendString(escaped, text);
+            output.append(escaped);
+        }
+
+        void key(const char* name) {
+            output.append(",\"", 2);
+            output.append(name, strlen(name));
+            output.append("\":", 2);
+        }
+
+    public:
+        explicit JSONWriter(OutputBuffer& output) : output(output) {}
+
+        void write(Commodity* commodity, int category) {
+            output.append("{\"category\":", 12);
+            appendString(CategoryRegistry::get(category).label);
+            commodity->visitFields(*this);
+            output.append("}\n", 2);
+        }
+
+        void field(const char* name, const string& value) override {
+            key(name);
+            appendString(value);
+        }
+
+        void field(const char* name, int value) override {
+            key(name);
+            output.appendInt(value);
+        }
+    };
+
+    class BinaryWriter : public FieldVisitor {
+    private:
+        OutputBuffer& output;
+        string record;
+
+        void putInt(string& out, unsigned value, int bytes) {
+            for (int i = 0; i < bytes; i++) {
+                out.push_back((char) ((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+    public:
+        explicit BinaryWriter(OutputBuffer& output) : output(output) {}
+
+        void header() {
+            string head = "SCAT";
+            putInt(head, 1, 4);
+            putInt(head, (unsigned) CategoryRegistry::size(), 4);
+            for (int i = 0; i < CategoryRegistry::size(); i++) {
+                const string& label = CategoryRegistry::get(i).label;
+                putInt(head, (unsigned) label.size(), 2);
+                head += label;
+            }
+            output.append(head);
+        }
+
+        void write(Commodity* commodity, int category) {
+            // The record is built first, because its length comes before it
+            record.clear();
+            putInt(record, (unsigned) category, 2);
+            commodity->visitFields(*this);
+            string length;
+            putInt(length, (unsigned) record.size(), 4);
+            output.append(length);
+            output.append(record);
+        }
+
+        void field(const char*, const string& value) override {
+            record.push_back('s');
+            putInt(record, (unsigned) value.size(), 4);
+            record += value;
+        }
+
+        void field(const char*, int value) override {
+            record.push_back('i');
+            putInt(record, (unsigned) value, 4);
+        }
+    };
+}
+
+bool CatalogExporter::exportTo(const string& fileName, CommodityList& list, const Filter& filter, Report& report,
+                               size_t bufferSize) {
+    string extension = fileName.substr(fileName.find_last_of('.') + 1);
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    Format format;
+    if (extension == "csv") format = CSV;
+    else if (extension == "jsonl" || extension == "json") format = JSONL;
+    else if (extension == "bin") format = BINARY;
+    else {
+        report.error = fileName + " is not a .csv, .jsonl or .bin file";
+        return false;
+    }
+
+    // The file is written aside and renamed at the end, so a failed export leaves the previous file as it was
+    string tempName = fileName + ".tmp";
+    FILE* file = fopen(tempName.c_str(), "wb");
+    if (file == nullptr) {
+        report.error = "Can not open " + fileName;
+        return false;
+    }
+    // The buffer below is the only one, every fwrite becomes one large write
+    setvbuf(file, nullptr, _IONBF, 0);
+
+    auto start = chrono::steady_clock::now();
+    OutputBuffer output(file, bufferSize);
+    vector<int> categories;
+    for (int i = 0; i < list.categoryCount(); i++) {
+        if (filter.category == -1 || filter.category == i) categories.push_back(i);
+    }
+
+    CSVWriter csv(output, categories);
+    JSONWriter json(output);
+    BinaryWriter binary(output);
+    if (format == CSV) csv.header();
+    if (format == BINARY) binary.header();
+
+    for (int i : categories) {
+        for (Commodity* commodity : list.getCategory(i)) {
+            int price = commodity->getPrice();
+            if (price < filter.minPrice || price > filter.maxPrice) continue;
+            if (format == CSV) csv.write(commodity, i);
+            else if (format == JSONL) json.write(commodity, i);
+            else binary.write(commodity, i);
+            report.items++;
+        }
+    }
+    output.flush();
+    bool closed = fclose(file) == 0;
+    bool failed = output.failed() || !closed;
+    if (failed) remove(tempName.c_str());
+    else failed = !AtomicFileWriter::replace(tempName, fileName);
+    report.bytes = output.written();
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (failed) {
+        report.error = "Fail to write " + fileName;
+        return false;
+    }
+    return true;
+}
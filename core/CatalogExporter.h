@@ -0,0 +1,58 @@
+#ifndef STORE_CORE_CATALOG_EXPORTER_H
+#define STORE_CORE_CATALOG_EXPORTER_H
+
+#include <climits>
+#include <cstddef>
+#include <string>
+
+#include "CommodityList.h"
+
+/*
+ * CatalogExporter write the commodities of a CommodityList into a file on demand.
+ * Three formats are supported and chosen by the file extension:
+ *  .csv: A header line, then one commodity per line. The columns are "category" and the attributes of every exported
+ *        category, a cell is empty when the commodity does not have that attribute. The importer can read it back.
+ *  .jsonl: One flat JSON object per line, with the same keys as the importer.
+ *  .bin: A compact binary file, every integer is little endian.
+ *        header: "SCAT", u32 version(1), u32 category count, then every label as u16 length + bytes.
+ *        record: u32 length of the rest of the record, u16 category index, then the attributes in visitFields order,
+ *                each one is 'i' + i32, or 's' + u32 length + bytes.
+ * The records are formatted into one reusable buffer, which is written to the file in one block whenever it is full.
+ * The output is never kept in memory as a whole. It goes to "<fileName>.tmp", which is renamed over the file once
+ * everything is written, or removed when a write fails.
+ */
+class CatalogExporter {
+public:
+    /*
+     * Select the commodities to export.
+     * ATTRIBUTE:
+     *  category: The category index, or -1 to export every category.
+     *  minPrice, maxPrice: Only the commodities whose price is inside [minPrice, maxPrice] are exported.
+     */
+    struct Filter {
+        int category = -1;
+        int minPrice = INT_MIN;
+        int maxPrice = INT_MAX;
+    };
+
+    /*
+     * The result of one export, the number of commodities and bytes written and the time it took.
+     * error tells why the export failed.
+     */
+    struct Report {
+        long long items = 0;
+        long long bytes = 0;
+        double seconds = 0;
+        std::string error;
+    };
+
+    /*
+     * Export the list into a file.
+     * INPUT: The file name, the list, the filter, and the size of the write buffer
+     * OUTPUT: Bool. False if the format is unknown or the file can not be written, the reason is in report.error
+     */
+    static bool exportTo(const std::string& fileName, CommodityList& list, const Filter& filter, Report& report,
+                         size_t bufferSize = 1 << 20);
+};
+
+#endif
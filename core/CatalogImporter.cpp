@@ -0,0 +1,297 @@
+#include "CatalogImporter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <future>
+
+#include "Json.h"
+#include "Metrics.h"
+
+using namespace std;
+
+namespace {
+
+    const size_t CHUNK_SIZE = 4 << 20;
+    const size_t MAX_BAD_LINES = 10;
+
+    struct ParsedRow {
+        int category;
+        Commodity* commodity;
+    };
+
+    /*
+     * A chunk of the file and the result of parsing it. The line numbers are counted from the start of the chunk.
+     */
+    struct Batch {
+        string text;
+        vector<ParsedRow> rows;
+        vector<long long> badLines;
+        long long lines = 0;
+    };
+
+    /*
+     * Split one CSV line into cells. A quoted cell may contain ',' and a doubled '"'.
+     */
+    void splitCSV(const char* begin, const char* end, vector<string>& cells) {
+        cells.clear();
+        if (end > begin && end[-1] == '\r') end--;
+        string cell;
+        bool quoted = false;
+        for (const char* p = begin; p < end; p++) {
+            if (quoted) {
+                if (*p == '"' && p + 1 < end && p[1] == '"') {
+                    cell.push_back('"');
+                    p++;
+                } else if (*p == '"') {
+                    quoted = false;
+                } else {
+                    cell.push_back(*p);
+                }
+            } else if (*p == '"') {
+                quoted = true;
+            } else if (*p == ',') {
+                cells.push_back(cell);
+                cell.clear();
+            } else {
+                cell.push_back(*p);
+            }
+        }
+        cells.push_back(cell);
+    }
+
+    /*
+     * Build a commodity from the key and value pairs of one record.
+     * RETURN: Bool. False if the record is malformed
+     */
+    bool buildRow(const vector<pair<string, string>>& fields, ParsedRow& row) {
+        row.category = -1;
+        for (const pair<string, string>& field : fields) {
+            if (field.first == "category") row.category = CategoryRegistry::find(field.second);
+        }
+        if (row.category == -1) return false;
+
+        row.commodity = CategoryRegistry::get(row.category).create();
+        bool valid = true;
+        bool named = false;
+        for (const pair<string, string>& field : fields) {
+            // An empty cell means the attribute is not given, e.g. a Laptop column on a Sound row
+            if (field.first == "category" || field.second.empty()) continue;
+            if (field.first == "name") named = true;
+            if (field.second.find_first_of("\r\n") != string::npos) {
+                // The catalog files keep one attribute in each line
+                string value = field.second;
+                replace(value.begin(), value.end(), '\r', ' ');
+                replace(value.begin(), value.end(), '\n', ' ');
+                if (!row.commodity->setField(field.first, value)) valid = false;
+            } else if (!row.commodity->setField(field.first, field.second)) {
+                valid = false;
+            }
+        }
+        if (!valid || !named) {
+            delete row.commodity;
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     * Parse every line inside a batch, it runs on a worker thread and only touches the batch.
+     */
+    void parseBatch(Batch& batch, bool isCSV, const vector<string>& header) {
+        batch.rows.clear();
+        batch.badLines.clear();
+        batch.lines = 0;
+        vector<string> cells;
+        vector<pair<string, string>> fields;
+        const char* p = batch.text.data();
+        const char* end = p + batch.text.size();
+        while (p < end) {
+            const char* lineEnd = (const char*) memchr(p, '\n', end - p);
+            if (lineEnd == nullptr) lineEnd = end;
+            long long line = batch.lines++;
+
+            const char* contentEnd = lineEnd;
+            if (contentEnd > p && contentEnd[-1] == '\r') contentEnd--;
+            if (contentEnd > p) {
+                bool parsed;
+                if (isCSV) {
+                    splitCSV(p, contentEnd, cells);
+                    fields.clear();
+                    for (size_t i = 0; i < cells.size() && i < header.size(); i++) {
+                        fields.emplace_back(header[i], cells[i]);
+                    }
+                    parsed = cells.size() == header.size();
+                } else {
+                    parsed = Json::parseObject(p, contentEnd, fields);
+                }
+                ParsedRow row;
+                if (parsed && buildRow(fields, row)) {
+                    batch.rows.push_back(row);
+                } else {
+                    batch.badLines.push_back(line);
+                }
+            }
+            p = lineEnd + 1;
+        }
+        batch.text.clear();
+    }
+}
+
+/*
+ * The state of an import between two rounds. The round task is the only one to touch it while it runs, apply() only
+ * after it finished.
+ */
+struct CatalogImporter::Parsed::Reader {
+    TaskPool& pool;
+    FILE* file;
+    bool isCSV;
+    vector<string> header;
+    // One chunk for each worker and one for the calling thread
+    vector<Batch> batches;
+    int filled = 0;
+    string carry;
+    bool endOfFile = false;
+    // The line number of the first line of the round
+    long long firstLine = 1;
+    double seconds = 0;
+    future<void> round;
+
+    Reader(TaskPool& pool, FILE* file, bool isCSV)
+            : pool(pool), file(file), isCSV(isCSV), batches(pool.size() + 1) {}
+
+    ~Reader() {
+        if (round.valid()) pool.wait(round);
+        for (int i = 0; i < filled; i++) {
+            for (ParsedRow& row : batches[i].rows) delete row.commodity;
+        }
+        fclose(file);
+    }
+
+    /*
+     * Read the next round of chunks and parse them, it runs as a task of the pool.
+     */
+    void parseRound() {
+        auto start = chrono::steady_clock::now();
+        // Fill one chunk for each worker, a chunk always ends at a line boundary
+        filled = 0;
+        for (; filled < (int) batches.size() && !endOfFile; filled++) {
+            Batch& batch = batches[filled];
+            batch.text.swap(carry);
+            carry.clear();
+            size_t used = batch.text.size();
+            batch.text.resize(used + CHUNK_SIZE);
+            size_t read = fread(&batch.text[used], 1, CHUNK_SIZE, file);
+            batch.text.resize(used + read);
+            if (read < CHUNK_SIZE) {
+                endOfFile = true;
+            } else {
+                size_t lastLine = batch.text.find_last_of('\n');
+                if (lastLine == string::npos) {
+                    // A record longer than a chunk, keep reading until its end
+                    carry.swap(batch.text);
+                    filled--;
+                    continue;
+                }
+                carry.assign(batch.text, lastLine + 1, string::npos);
+                batch.text.resize(lastLine + 1);
+            }
+        }
+
+        vector<future<void>> parsing;
+        for (int i = 1; i < filled; i++) {
+            Batch& batch = batches[i];
+            parsing.push_back(pool.submit([&batch, this]() { parseBatch(batch, isCSV, header); }));
+        }
+        if (filled > 0) parseBatch(batches[0], isCSV, header);
+        for (future<void>& task : parsing) pool.wait(task);
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+};
+
+CatalogImporter::Parsed::Parsed() = default;
+
+CatalogImporter::Parsed::~Parsed() = default;
+
+bool CatalogImporter::parse(const string& fileName, Parsed& parsed, TaskPool& pool) {
+    Report& report = parsed.report;
+    string extension = fileName.substr(fileName.find_last_of('.') + 1);
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    bool isCSV = (extension == "csv");
+    if (!isCSV && extension != "jsonl" && extension != "json") {
+        report.error = fileName + " is not a .csv or .jsonl file";
+        return false;
+    }
+
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if (file == nullptr) {
+        report.error = "Can not open " + fileName;
+        return false;
+    }
+
+    auto start = chrono::steady_clock::now();
+    parsed.reader.reset(new Parsed::Reader(pool, file, isCSV));
+    Parsed::Reader& reader = *parsed.reader;
+    if (isCSV) {
+        string line;
+        int c;
+        while ((c = fgetc(file)) != EOF && c != '\n') line.push_back((char) c);
+        if (line.compare(0, 3, "\xEF\xBB\xBF") == 0) line.erase(0, 3);
+        splitCSV(line.data(), line.data() + line.size(), reader.header);
+        for (string& column : reader.header) {
+            transform(column.begin(), column.end(), column.begin(), ::tolower);
+        }
+        reader.firstLine = 2;
+    }
+    reader.round = pool.submit([&reader]() { reader.parseRound(); });
+    report.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool CatalogImporter::apply(Parsed& parsed, CommodityList& list, bool wait) {
+    if (parsed.reader == nullptr) return true;
+    Parsed::Reader& reader = *parsed.reader;
+    if (!wait && reader.round.wait_for(chrono::seconds(0)) != future_status::ready) return false;
+    STORE_TIMED(IMPORT);
+    reader.pool.wait(reader.round);
+
+    auto start = chrono::steady_clock::now();
+    Report& report = parsed.report;
+    vector<pair<Commodity*, int>> rows;
+    for (int i = 0; i < reader.filled; i++) {
+        Batch& batch = reader.batches[i];
+        report.rows += (long long) batch.rows.size() + (long long) batch.badLines.size();
+        report.malformed += (long long) batch.badLines.size();
+        for (long long line : batch.badLines) {
+            if (report.badLines.size() < MAX_BAD_LINES) report.badLines.push_back(reader.firstLine + line);
+        }
+        for (ParsedRow& row : batch.rows) rows.emplace_back(row.commodity, row.category);
+        batch.rows.clear();
+        reader.firstLine += batch.lines;
+    }
+    reader.filled = 0;
+    report.imported += list.addBatch(rows);
+    // The rows left are the names the list already has
+    report.duplicated += (long long) rows.size();
+    for (pair<Commodity*, int>& row : rows) delete row.first;
+
+    report.seconds += reader.seconds + chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (reader.endOfFile) {
+        parsed.reader.reset();
+        return true;
+    }
+    reader.round = reader.pool.submit([&reader]() { reader.parseRound(); });
+    return false;
+}
+
+bool CatalogImporter::import(const string& fileName, CommodityList& list, Report& report, TaskPool& pool) {
+    Parsed parsed;
+    bool success = parse(fileName, parsed, pool);
+    if (success) {
+        while (!apply(parsed, list, true)) {}
+    }
+    report = parsed.report;
+    return success;
+}
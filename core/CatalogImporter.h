@@ -0,0 +1,94 @@
+#ifndef STORE_CORE_CATALOG_IMPORTER_H
+#define STORE_CORE_CATALOG_IMPORTER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CommodityList.h"
+#include "TaskPool.h"
+
+/*
+ * CatalogImporter read the commodities from a supplier feed into the CommodityList.
+ * Two formats are supported and chosen by the file extension:
+ *  .csv: The first line is the header, every following line is a commodity. Cells may be quoted with '"'.
+ *  .jsonl: Every line is a flat JSON object, e.g. {"category": "Sound", "name": "JBL Go", "price": 500}.
+ * The "category" column is matched to the labels inside CategoryRegistry, every other non-empty column is passed to
+ * Commodity::setField. A record must stay on one line.
+ * The file is read in fixed size chunks, and a round of chunks, one for every worker and one more, is parsed by the
+ * tasks of a TaskPool at the same time. Each round is added to the list before the next one is read, so the buffers
+ * and the commodities held do not depend on the file size. The parsed commodities are added in file order, and a
+ * name which already exists in the list is dropped by the same rule as CommodityList::isExist.
+ */
+class CatalogImporter {
+public:
+    /*
+     * The result of one import.
+     * ATTRIBUTE:
+     *  rows: The number of records read from the file.
+     *  imported: The number of commodities added to the list.
+     *  duplicated: The number of records dropped because the name already exists.
+     *  malformed: The number of records which can not be parsed.
+     *  badLines: The line numbers of the first malformed records.
+     *  seconds: The time the import took.
+     *  error: Why the file is not imported at all.
+     */
+    struct Report {
+        long long rows = 0;
+        long long imported = 0;
+        long long duplicated = 0;
+        long long malformed = 0;
+        std::vector<long long> badLines;
+        double seconds = 0;
+        std::string error;
+    };
+
+    /*
+     * An import in progress: the open file and the round of chunks parsed by the pool and not added yet.
+     * A round left when the object is destroyed is waited for and its commodities are deleted.
+     */
+    class Parsed {
+    public:
+        Report report;
+
+        Parsed();
+
+        Parsed(const Parsed&) = delete;
+
+        Parsed& operator=(const Parsed&) = delete;
+
+        ~Parsed();
+
+    private:
+        friend class CatalogImporter;
+
+        struct Reader;
+        std::unique_ptr<Reader> reader;
+    };
+
+    /*
+     * Open a file and start parsing its first round of chunks in the background, without touching any list.
+     * INPUT: The file name, the object to keep the import and the report, and the pool (option)
+     * OUTPUT: Bool. False if the file can not be opened or the format is unknown, the reason is in report.error
+     */
+    static bool parse(const std::string& fileName, Parsed& parsed, TaskPool& pool = TaskPool::shared());
+
+    /*
+     * Add the parsed round to the list on the thread which owns it, then start parsing the next round. The parsing
+     * stops until the next call, so only one round of commodities is held. report.imported and report.duplicated
+     * are counted here.
+     * INPUT: The import, the list, and whether to wait for a round which is still parsed
+     * OUTPUT: Bool. True once the whole file is added, false if rounds are left or the round is not parsed yet
+     */
+    static bool apply(Parsed& parsed, CommodityList& list, bool wait);
+
+    /*
+     * Import a file into the list, parse() and apply() one after the other.
+     * INPUT: The file name, the list to add the commodities to, and the pool (option)
+     * OUTPUT: Bool. False if the file can not be opened or the format is unknown, the reason is in report.error
+     */
+    static bool import(const std::string& fileName, CommodityList& list, Report& report,
+                       TaskPool& pool = TaskPool::shared());
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "CheckoutPricing.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+#include "Json.h"
+
+using namespace std;
+
+namespace {
+
+    const long long MICROS = 1000000;
+    const int BASIS_POINTS = 10000;
+    const int MAX_DECIMALS = 4;
+
+    /*
+     * Read a non negative decimal number with at most places digits after the point, as an integer of that scale,
+     * e.g. "19.5" with 2 places is 1950.
+     * RETURN: Bool. False if the text is not such a number
+     */
+    bool parseFixed(const string& text, int places, long long& value) {
+        long long result = 0;
+        int digits = 0;
+        int decimals = -1;
+        for (char c : text) {
+            if (c == '.' && decimals < 0) {
+                decimals = 0;
+                continue;
+            }
+            if (!isdigit((unsigned char) c) || ++digits > 15) return false;
+            if (decimals >= 0 && ++decimals > places) return false;
+            result = result * 10 + (c - '0');
+        }
+        if (digits == 0) return false;
+        for (int i = max(decimals, 0); i < places; i++) result *= 10;
+        value = result;
+        return true;
+    }
+
+    long long gcd(long long a, long long b) {
+        while (b != 0) {
+            long long rest = a % b;
+            a = b;
+            b = rest;
+        }
+        return a;
+    }
+
+    /*
+     * Return amount * numerator / denominator rounded half up, without overflow as long as the result fits and the
+     * square of denominator fits. The amount is split by the denominator, so only the remainders are multiplied.
+     */
+    long long mulDiv(long long amount, long long numerator, long long denominator) {
+        if (amount < 0) return -mulDiv(-amount, numerator, denominator);
+        long long quotient = amount / denominator;
+        long long remainder = amount % denominator;
+        return quotient * numerator + remainder * (numerator / denominator) +
+               (remainder * (numerator % denominator) + denominator / 2) / denominator;
+    }
+}
+
+const char* const CheckoutPricing::DEFAULT_FILE = "Regions.jsonl";
+
+CheckoutPricing::CheckoutPricing() : categories(CategoryRegistry::size()) {
+    add({{"region", "Local"}, {"currency", "USD"}});
+}
+
+bool CheckoutPricing::load(const string& fileName, vector<string>* errors) {
+    ifstream file(fileName);
+    if (!file) return false;
+    vector<Region> previous;
+    vector<int32_t> previousTaxes;
+    regions.swap(previous);
+    taxTable.swap(previousTaxes);
+
+    string line;
+    vector<pair<string, string>> fields;
+    for (int number = 1; getline(file, line); number++) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.find_first_not_of(" \t") == string::npos) continue;
+        fields.clear();
+        string error = Json::parseObject(line.data(), line.data() + line.size(), fields) ? add(fields)
+                                                                                         : "not a flat JSON object";
+        if (!error.empty() && errors != nullptr) errors->push_back("line " + to_string(number) + ": " + error);
+    }
+    if (regions.empty()) {
+        regions.swap(previous);
+        taxTable.swap(previousTaxes);
+    }
+    return true;
+}
+
+string CheckoutPricing::add(const vector<pair<string, string>>& fields) {
+    Region region = {"", "", 2, 1, 1};
+    long long rate = MICROS;
+    long long tax = 0;
+    vector<pair<int, long long>> categoryTaxes;
+    for (const pair<string, string>& field : fields) {
+        long long decimals;
+        if (field.first == "region") {
+            region.name = field.second;
+        } else if (field.first == "currency") {
+            region.currency = field.second;
+        } else if (field.first == "decimals") {
+            if (!parseFixed(field.second, 0, decimals) || decimals > MAX_DECIMALS) {
+                return "bad decimals " + field.second;
+            }
+            region.decimals = (int) decimals;
+        } else if (field.first == "rate") {
+            if (!parseFixed(field.second, 6, rate) || rate == 0) return "bad rate " + field.second;
+        } else if (field.first == "tax") {
+            if (!parseFixed(field.second, 2, tax) || tax > BASIS_POINTS) return "bad tax " + field.second;
+        } else if (field.first.compare(0, 4, "tax.") == 0) {
+            int category = CategoryRegistry::find(field.first.substr(4));
+            long long categoryTax;
+            if (category < 0) return "unknown category " + field.first.substr(4);
+            if (!parseFixed(field.second, 2, categoryTax) || categoryTax > BASIS_POINTS) {
+                return "bad tax " + field.second;
+            }
+            categoryTaxes.emplace_back(category, categoryTax);
+        } else {
+            return "unknown field " + field.first;
+        }
+    }
+    if (region.name.empty()) return "no region";
+    if (region.currency.empty()) return "no currency";
+
+    // One cent of the store is rate / MICROS units, and a unit is 10^decimals minor units
+    region.rateNumerator = rate;
+    for (int i = 0; i < region.decimals; i++) region.rateNumerator *= 10;
+    region.rateDenominator = 100 * MICROS;
+    long long divisor = gcd(region.rateNumerator, region.rateDenominator);
+    region.rateNumerator /= divisor;
+    region.rateDenominator /= divisor;
+
+    vector<int32_t> taxes((size_t) categories, (int32_t) tax);
+    for (const pair<int, long long>& categoryTax : categoryTaxes) {
+        if (categoryTax.first < categories) taxes[categoryTax.first] = (int32_t) categoryTax.second;
+    }
+    int index = find(region.name);
+    if (index < 0) {
+        index = (int) regions.size();
+        regions.push_back(region);
+        taxTable.resize(regions.size() * categories);
+    } else {
+        regions[index] = region;
+    }
+    copy(taxes.begin(), taxes.end(), taxTable.begin() + (long) index * categories);
+    return "";
+}
+
+int CheckoutPricing::find(const string& name) const {
+    for (int i = 0; i < (int) regions.size(); i++) {
+        if (regions[i].name == name) return i;
+    }
+    return -1;
+}
+
+void CheckoutPricing::price(int region, const ShoppingCart::SoldLine* lines, size_t count, Totals& totals) {
+    categoryNet.assign((size_t) categories, 0);
+    long long untaxed = 0;
+    for (size_t i = 0; i < count; i++) {
+        long long cents = ((long long) lines[i].price * lines[i].quantity - lines[i].discount) * 100;
+        if (lines[i].category < categories) categoryNet[lines[i].category] += cents;
+        else untaxed += cents;
+    }
+
+    // The money of a category is converted first, then its tax is taken in the currency of the region
+    const Region& chosen = regions[region];
+    totals.net = mulDiv(untaxed, chosen.rateNumerator, chosen.rateDenominator);
+    totals.tax = 0;
+    for (int c = 0; c < categories; c++) {
+        if (categoryNet[c] == 0) continue;
+        long long net = mulDiv(categoryNet[c], chosen.rateNumerator, chosen.rateDenominator);
+        totals.net += net;
+        totals.tax += mulDiv(net, taxOf(region, c), BASIS_POINTS);
+    }
+    totals.total = totals.net + totals.tax;
+}
+
+void CheckoutPricing::priceBatch(const vector<int>& checkoutRegions, const vector<ShoppingCart::SoldLine>& lines,
+                                 const vector<uint32_t>& firstLine, vector<Totals>& totals) {
+    totals.resize(checkoutRegions.size());
+    for (size_t i = 0; i < checkoutRegions.size(); i++) {
+        price(checkoutRegions[i], lines.data() + firstLine[i], firstLine[i + 1] - firstLine[i], totals[i]);
+    }
+}
+
+void CheckoutPricing::format(string& out, int region, long long amount) const {
+    const Region& chosen = regions[region];
+    if (amount < 0) {
+        out += '-';
+        amount = -amount;
+    }
+    long long unit = 1;
+    for (int i = 0; i < chosen.decimals; i++) unit *= 10;
+    out += to_string(amount / unit);
+    if (chosen.decimals > 0) {
+        string minor = to_string(amount % unit);
+        out += '.';
+        out.append((size_t) chosen.decimals - minor.size(), '0');
+        out += minor;
+    }
+    out += ' ';
+    out += chosen.currency;
+}
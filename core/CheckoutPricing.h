@@ -0,0 +1,130 @@
+#ifndef STORE_CORE_CHECKOUT_PRICING_H
+#define STORE_CORE_CHECKOUT_PRICING_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ShoppingCart.h"
+
+/*
+ * CheckoutPricing turn the lines of a checkout into what a region pays: the tax of every category and the money in
+ * the currency of the region.
+ * The regions are read from a JSON Lines file, one flat object for every region:
+ *  {"region": "EU", "currency": "EUR", "decimals": 2, "rate": "0.92", "tax": "20", "tax.Laptop": "19.5"}
+ * rate is what one dollar of the store is worth in the currency, with at most 6 decimals. tax is the percent of
+ * every category, with at most 2 decimals, and "tax.<label>" sets it for one category. decimals is the number of
+ * minor units the currency shows, from 0 to 4.
+ * Everything is integer: the prices are taken as cents, the tax rate of every region and category is kept in basis
+ * points in one table, and the rate as a reduced fraction of minor units per cent. The tax of a category is taken
+ * from the sum of its lines, and the tax and the net money are converted apart, so the total is always their sum.
+ * Every division rounds half up. A region is the same on every machine, so a checkout always gets the same result.
+ * Without a file there is one region, "Local", which pays dollars without tax.
+ * The object is used by one thread at a time.
+ */
+class CheckoutPricing {
+public:
+    // The file the front ends read the regions from, beside the catalog files
+    static const char* const DEFAULT_FILE;
+
+    /*
+     * What a checkout pays, in minor units of the currency of its region.
+     */
+    struct Totals {
+        long long net;
+        long long tax;
+        long long total;
+    };
+
+    CheckoutPricing();
+
+    /*
+     * Read the regions of a file, the regions in memory are replaced. A malformed line is skipped, and the Local
+     * region is kept when no line is valid.
+     * INPUT: The file name, and the vector to receive why each skipped line is skipped (option)
+     * OUTPUT: Bool. False if the file can not be opened, nothing is changed then
+     */
+    bool load(const std::string& fileName, std::vector<std::string>* errors = nullptr);
+
+    /*
+     * Add a region, see the file format above. A region with the name of an existing one replaces it.
+     * INPUT: The fields of one region
+     * OUTPUT: String. Why the region is not added, empty when it is
+     */
+    std::string add(const std::vector<std::pair<std::string, std::string>>& fields);
+
+    /*
+     * Return the number of regions, the first one is the default of the front ends
+     */
+    int size() const {
+        return (int) regions.size();
+    }
+
+    /*
+     * Find a region by name.
+     * OUTPUT: Integer. The region index, or -1 if there is no such region
+     */
+    int find(const std::string& name) const;
+
+    const std::string& getName(int region) const {
+        return regions[region].name;
+    }
+
+    const std::string& getCurrency(int region) const {
+        return regions[region].currency;
+    }
+
+    int getDecimals(int region) const {
+        return regions[region].decimals;
+    }
+
+    /*
+     * Work out what one checkout pays.
+     * INPUT: The region index, the lines sold with their discount, see ShoppingCart::checkOut and Promotions::apply,
+     * and the totals to fill
+     * OUTPUT: None
+     */
+    void price(int region, const ShoppingCart::SoldLine* lines, size_t count, Totals& totals);
+
+    /*
+     * Work out what many checkouts pay at once. The lines of checkout i are lines[firstLine[i]] to
+     * lines[firstLine[i + 1]], so firstLine has one more entry than regions.
+     * INPUT: The region of every checkout, the lines of all of them, where each one starts, and the vector to receive
+     * the totals of every checkout
+     * OUTPUT: None
+     */
+    void priceBatch(const std::vector<int>& checkoutRegions, const std::vector<ShoppingCart::SoldLine>& lines,
+                    const std::vector<uint32_t>& firstLine, std::vector<Totals>& totals);
+
+    /*
+     * Append an amount of minor units with its decimal point and currency, e.g. "1234.50 EUR".
+     */
+    void format(std::string& out, int region, long long amount) const;
+
+private:
+    struct Region {
+        std::string name;
+        std::string currency;
+        int decimals;
+        // Minor units of the currency for one cent of the store is rateNumerator / rateDenominator
+        long long rateNumerator;
+        long long rateDenominator;
+    };
+
+    std::vector<Region> regions;
+    // The tax of region r and category c in basis points is taxTable[r * categories + c]
+    std::vector<int32_t> taxTable;
+    int categories;
+    // The net cents of every category of the checkout being priced, reused by every price()
+    std::vector<long long> categoryNet;
+
+    /*
+     * Return the tax of a region and a category in basis points.
+     */
+    int32_t taxOf(int region, int category) const {
+        return category < categories ? taxTable[(size_t) region * categories + category] : 0;
+    }
+};
+
+#endif
@@ -0,0 +1,361 @@
+#include "Checkpointer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#include "AtomicFile.h"
+#include "Metrics.h"
+
+#ifdef STORE_IO_URING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+    /*
+     * One catalog file built in memory from a snapshot, with its checksum trailer.
+     */
+    struct FileImage {
+        string fileName;
+        string data;
+        bool written = false;
+    };
+
+#ifdef STORE_IO_URING
+    /*
+     * A minimal io_uring on the raw system calls: one submission ring and one completion ring, used by one thread.
+     */
+    class Ring {
+    private:
+        int fd = -1;
+        void* ringMap = MAP_FAILED;
+        size_t ringSize = 0;
+        void* completionMap = MAP_FAILED;
+        size_t completionSize = 0;
+        io_uring_sqe* entries = (io_uring_sqe*) MAP_FAILED;
+        size_t entriesSize = 0;
+        unsigned* submitHead = nullptr;
+        unsigned* submitTail = nullptr;
+        unsigned* submitMask = nullptr;
+        unsigned* submitArray = nullptr;
+        unsigned capacity = 0;
+        unsigned* completeHead = nullptr;
+        unsigned* completeTail = nullptr;
+        unsigned* completeMask = nullptr;
+        io_uring_cqe* completions = nullptr;
+        unsigned queued = 0;
+
+    public:
+        explicit Ring(unsigned size) {
+            io_uring_params params;
+            memset(&params, 0, sizeof(params));
+            fd = (int) syscall(__NR_io_uring_setup, size, &params);
+            if (fd < 0) return;
+            ringSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            completionSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single) ringSize = completionSize = max(ringSize, completionSize);
+            ringMap = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                           IORING_OFF_SQ_RING);
+            if (ringMap == MAP_FAILED) return;
+            completionMap = single ? ringMap : mmap(nullptr, completionSize, PROT_READ | PROT_WRITE,
+                                                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (completionMap == MAP_FAILED) return;
+            entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+            entries = (io_uring_sqe*) mmap(nullptr, entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                           fd, IORING_OFF_SQES);
+            if (entries == MAP_FAILED) return;
+
+            char* ring = (char*) ringMap;
+            submitHead = (unsigned*) (ring + params.sq_off.head);
+            submitTail = (unsigned*) (ring + params.sq_off.tail);
+            submitMask = (unsigned*) (ring + params.sq_off.ring_mask);
+            submitArray = (unsigned*) (ring + params.sq_off.array);
+            capacity = params.sq_entries;
+            char* completion = (char*) completionMap;
+            completeHead = (unsigned*) (completion + params.cq_off.head);
+            completeTail = (unsigned*) (completion + params.cq_off.tail);
+            completeMask = (unsigned*) (completion + params.cq_off.ring_mask);
+            completions = (io_uring_cqe*) (completion + params.cq_off.cqes);
+        }
+
+        ~Ring() {
+            if (entries != MAP_FAILED) munmap(entries, entriesSize);
+            if (completionMap != MAP_FAILED && completionMap != ringMap) munmap(completionMap, completionSize);
+            if (ringMap != MAP_FAILED) munmap(ringMap, ringSize);
+            if (fd >= 0) close(fd);
+        }
+
+        bool isOpen() {
+            return entries != MAP_FAILED;
+        }
+
+        /*
+         * Queue one operation, the caller never queues more than the ring size before submit().
+         */
+        io_uring_sqe* next(unsigned char opcode, int file, uint64_t tag) {
+            unsigned tail = *submitTail;
+            unsigned index = tail & *submitMask;
+            io_uring_sqe* entry = &entries[index];
+            memset(entry, 0, sizeof(*entry));
+            entry->opcode = opcode;
+            entry->fd = file;
+            entry->user_data = tag;
+            submitArray[index] = index;
+            __atomic_store_n(submitTail, tail + 1, __ATOMIC_RELEASE);
+            queued++;
+            return entry;
+        }
+
+        void write(int file, const char* data, size_t length, uint64_t offset, uint64_t tag) {
+            io_uring_sqe* entry = next(IORING_OP_WRITE, file, tag);
+            entry->addr = (uint64_t) (uintptr_t) data;
+            entry->len = (uint32_t) length;
+            entry->off = offset;
+        }
+
+        void fsync(int file, uint64_t tag) {
+            next(IORING_OP_FSYNC, file, tag);
+        }
+
+        unsigned size() {
+            return capacity;
+        }
+
+        /*
+         * Submit the queued operations and wait until all of them complete.
+         * INPUT: The vector to store (tag, result) of every completion, the result is negative errno on failure
+         * OUTPUT: Bool. False if the ring itself fails
+         */
+        bool submit(vector<pair<uint64_t, int>>& done) {
+            done.clear();
+            unsigned waiting = queued;
+            unsigned toSubmit = queued;
+            queued = 0;
+            while (done.size() < waiting) {
+                long entered = syscall(__NR_io_uring_enter, fd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (entered < 0 && errno != EINTR) return false;
+                if (entered > 0) toSubmit -= (unsigned) entered;
+                unsigned head = *completeHead;
+                unsigned tail = __atomic_load_n(completeTail, __ATOMIC_ACQUIRE);
+                for (; head != tail; head++) {
+                    io_uring_cqe& completion = completions[head & *completeMask];
+                    done.emplace_back(completion.user_data, completion.res);
+                }
+                __atomic_store_n(completeHead, head, __ATOMIC_RELEASE);
+            }
+            return true;
+        }
+    };
+
+    /*
+     * The temporary files of writeWithRing. A file still open when the object goes away is closed and unlinked, so a
+     * checkpoint which gives up on the ring leaves neither a descriptor nor a ".tmp" file behind it.
+     */
+    class TempFiles {
+    private:
+        vector<int> descriptors;
+        vector<string> names;
+
+    public:
+        explicit TempFiles(const vector<FileImage>& files) : descriptors(files.size(), -1) {
+            for (const FileImage& file : files) {
+                names.push_back(file.fileName + ".tmp");
+                descriptors[names.size() - 1] = open(names.back().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                                     0644);
+            }
+        }
+
+        TempFiles(const TempFiles&) = delete;
+
+        TempFiles& operator=(const TempFiles&) = delete;
+
+        ~TempFiles() {
+            for (size_t i = 0; i < descriptors.size(); i++) {
+                if (descriptors[i] < 0) continue;
+                close(descriptors[i]);
+                unlink(names[i].c_str());
+            }
+        }
+
+        int descriptor(size_t i) {
+            return descriptors[i];
+        }
+
+        const string& name(size_t i) {
+            return names[i];
+        }
+
+        /*
+         * Close one file, it is left to the caller to rename or unlink it.
+         * OUTPUT: Bool. False if the close fails
+         */
+        bool release(size_t i) {
+            bool closed = close(descriptors[i]) == 0;
+            descriptors[i] = -1;
+            return closed;
+        }
+    };
+
+    bool ringAvailable() {
+        static const bool available = []() {
+            Ring probe(2);
+            return probe.isOpen();
+        }();
+        return available;
+    }
+
+    /*
+     * Write the files to their temporary names through the ring, then fsync them, then rename them.
+     * A file which fails any step keeps written = false and is left for the fallback.
+     */
+    void writeWithRing(vector<FileImage>& files) {
+        Ring ring((unsigned) files.size());
+        if (!ring.isOpen() || ring.size() < files.size()) return;
+        TempFiles temps(files);
+        vector<size_t> offsets(files.size(), 0);
+
+        // A short write is submitted again for the rest of the file
+        vector<bool> failed(files.size(), false);
+        vector<pair<uint64_t, int>> done;
+        while (true) {
+            for (size_t i = 0; i < files.size(); i++) {
+                if (temps.descriptor(i) < 0 || failed[i] || offsets[i] == files[i].data.size()) continue;
+                const string& data = files[i].data;
+                ring.write(temps.descriptor(i), data.data() + offsets[i],
+                           min(data.size() - offsets[i], (size_t) 1 << 30), offsets[i], i);
+            }
+            if (!ring.submit(done)) return;
+            if (done.empty()) break;
+            for (const pair<uint64_t, int>& completion : done) {
+                if (completion.second <= 0) failed[completion.first] = true;
+                else offsets[completion.first] += (size_t) completion.second;
+            }
+        }
+
+        for (size_t i = 0; i < files.size(); i++) {
+            if (temps.descriptor(i) >= 0 && !failed[i]) ring.fsync(temps.descriptor(i), i);
+        }
+        if (!ring.submit(done)) return;
+        for (const pair<uint64_t, int>& completion : done) {
+            if (completion.second < 0) failed[completion.first] = true;
+        }
+
+        for (size_t i = 0; i < files.size(); i++) {
+            if (temps.descriptor(i) < 0) continue;
+            bool closed = temps.release(i);
+            if (failed[i] || !closed) {
+                unlink(temps.name(i).c_str());
+                continue;
+            }
+            files[i].written = AtomicFileWriter::replace(temps.name(i), files[i].fileName);
+        }
+    }
+#endif
+
+    /*
+     * Write one file through AtomicFileWriter, the trailer of the image is left out because the writer adds it.
+     */
+    bool writeWithStream(const FileImage& file) {
+        AtomicFileWriter writer(file.fileName);
+        if (!writer.isOpen()) return false;
+        size_t trailer = file.data.find_last_of('#');
+        ostream out(&writer);
+        out.write(file.data.data(), (streamsize) trailer);
+        return out.good() && writer.commit();
+    }
+}
+
+Checkpointer::Checkpointer(chrono::milliseconds interval, TaskPool& pool)
+        : pool(pool), interval(interval), lastStart(chrono::steady_clock::now()) {}
+
+Checkpointer::~Checkpointer() {
+    Result result;
+    wait(result);
+}
+
+bool Checkpointer::usesUring() {
+#ifdef STORE_IO_URING
+    return ringAvailable();
+#else
+    return false;
+#endif
+}
+
+bool Checkpointer::tick(CommodityList& list) {
+    if (!dirty(list) || running.valid() || chrono::steady_clock::now() - lastStart < interval) return false;
+    return start(list);
+}
+
+bool Checkpointer::start(CommodityList& list) {
+    if (running.valid()) return false;
+    STORE_TIMED(CHECKPOINT_SNAPSHOT);
+    shared_ptr<Snapshot> snapshot = make_shared<Snapshot>();
+    snapshot->start = chrono::steady_clock::now();
+    snapshot->version = list.pin();
+    lastStart = snapshot->start;
+    runningVersion = list.version();
+    TaskPool& tasks = pool;
+    running = pool.submit([snapshot, &tasks]() { return write(*snapshot, tasks); });
+    return true;
+}
+
+bool Checkpointer::collect(Result& result) {
+    if (!running.valid() || running.wait_for(chrono::seconds(0)) != future_status::ready) return false;
+    result = running.get();
+    finish(result);
+    return true;
+}
+
+bool Checkpointer::wait(Result& result) {
+    if (!running.valid()) return false;
+    result = pool.wait(running);
+    finish(result);
+    return true;
+}
+
+void Checkpointer::finish(const Result& result) {
+    if (result.success) savedVersion = runningVersion;
+}
+
+Checkpointer::Result Checkpointer::write(const Snapshot& snapshot, TaskPool& pool) {
+    STORE_TIMED(CHECKPOINT);
+    vector<FileImage> files(CategoryRegistry::size());
+    for (size_t i = 0; i < files.size(); i++) {
+        ostringstream out;
+        CommodityList::writeRecords(out, (int) i, snapshot.version->getCategory((int) i));
+        files[i].fileName = CategoryRegistry::get((int) i).fileName;
+        files[i].data = out.str();
+        files[i].data += AtomicFileWriter::trailer(Crc32c::update(0, files[i].data.data(), files[i].data.size()));
+    }
+
+#ifdef STORE_IO_URING
+    if (ringAvailable()) writeWithRing(files);
+#endif
+    vector<future<bool>> fallback(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        if (files[i].written) continue;
+        const FileImage& file = files[i];
+        fallback[i] = pool.submit([&file]() { return writeWithStream(file); });
+    }
+
+    Result result;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (fallback[i].valid()) files[i].written = pool.wait(fallback[i]);
+        if (files[i].written) {
+            result.bytes += (long long) files[i].data.size();
+        } else {
+            result.success = false;
+            result.failedFiles.push_back(files[i].fileName);
+        }
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - snapshot.start).count();
+    return result;
+}
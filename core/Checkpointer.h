@@ -0,0 +1,110 @@
+#ifndef STORE_CORE_CHECKPOINTER_H
+#define STORE_CORE_CHECKPOINTER_H
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "CommodityList.h"
+#include "TaskPool.h"
+
+/*
+ * Checkpointer save the catalog in the background, so adding or removing a commodity never waits for the disk.
+ * A checkpoint pins a version of the list on the thread which owns it, see CommodityList::pin, which is a
+ * consistent snapshot because a removed commodity is not deleted while a version which has it is pinned. Only the
+ * stock and the price keep changing, each one is read once while its file is built, and a change after that makes
+ * the list dirty again so the next checkpoint writes it. A task of the pool then builds the files from the snapshot
+ * and writes them. On Linux the writes and the fsyncs of all the files are
+ * submitted together through io_uring, a file the ring can not write, or every file when io_uring is not available,
+ * goes through AtomicFileWriter on the pool instead. The files are the same as CommodityList::save writes.
+ * Only one checkpoint runs at a time. The object is used by the thread which owns the list.
+ */
+class Checkpointer {
+public:
+    /*
+     * The result of one checkpoint.
+     * ATTRIBUTE:
+     *  success: False if a file is not saved, its previous version is kept.
+     *  failedFiles: The files which are not saved.
+     *  bytes: The size of the files written.
+     *  seconds: The time from the snapshot to the last rename.
+     */
+    struct Result {
+        bool success = true;
+        std::vector<std::string> failedFiles;
+        long long bytes = 0;
+        double seconds = 0;
+    };
+
+    /*
+     * INPUT: The shortest time between two checkpoints started by tick(), and the pool (option)
+     */
+    explicit Checkpointer(std::chrono::milliseconds interval, TaskPool& pool = TaskPool::shared());
+
+    /*
+     * Wait for the running checkpoint.
+     */
+    ~Checkpointer();
+
+    /*
+     * Start a checkpoint when the list changed since the last saved one, the interval passed since the last checkpoint
+     * (or since the object is created) and no checkpoint is running. Call it often from the thread which changes the
+     * list, it costs nothing otherwise.
+     * OUTPUT: Bool. True if a checkpoint is started
+     */
+    bool tick(CommodityList& list);
+
+    /*
+     * Start a checkpoint now, unless one is running.
+     * OUTPUT: Bool. False if a checkpoint is running, nothing is started then
+     */
+    bool start(CommodityList& list);
+
+    /*
+     * Take the result of the checkpoint which finished since the last call, without waiting.
+     * OUTPUT: Bool. False if no checkpoint finished
+     */
+    bool collect(Result& result);
+
+    /*
+     * Wait for the running checkpoint and take its result.
+     * OUTPUT: Bool. False if no checkpoint is running
+     */
+    bool wait(Result& result);
+
+    /*
+     * Check whether the list has changes which are not inside a saved checkpoint. A list which is never saved is
+     * dirty, so the files of a session are always written once.
+     */
+    bool dirty(CommodityList& list) {
+        return list.version() != savedVersion;
+    }
+
+    /*
+     * Whether the checkpoints are written through io_uring.
+     */
+    static bool usesUring();
+
+private:
+    struct Snapshot {
+        CommodityList::Pin version;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    TaskPool& pool;
+    std::chrono::milliseconds interval;
+    std::chrono::steady_clock::time_point lastStart;
+    std::future<Result> running;
+    long long runningVersion = -1;
+    long long savedVersion = -1;
+
+    /*
+     * Take the result of the finished checkpoint, a successful one makes its snapshot the saved version.
+     */
+    void finish(const Result& result);
+
+    static Result write(const Snapshot& snapshot, TaskPool& pool);
+};
+
+#endif
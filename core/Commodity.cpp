@@ -0,0 +1,419 @@
+#include "Commodity.h"
+
+#include <cctype>
+#include <cstdio>
+
+using namespace std;
+
+namespace {
+
+    /*
+     * Append one "label value unit" line of detail(), the number is formatted without a temporary string.
+     */
+    void appendLine(string& out, const char* label, int value, const char* unit = "") {
+        char digits[16];
+        int length = snprintf(digits, sizeof(digits), "%d", value);
+        out += label;
+        out.append(digits, length);
+        out += unit;
+        out += '\n';
+    }
+
+    void appendLine(string& out, const char* label, const string& value, const char* unit = "") {
+        out += label;
+        out += value;
+        out += unit;
+        out += '\n';
+    }
+}
+
+bool Commodity::toInt(const string& str, int& value) {
+    size_t i = (!str.empty() && str[0] == '-') ? 1 : 0;
+    if (i == str.size()) return false;
+    long long result = 0;
+    for (; i < str.size(); i++) {
+        if (!isdigit((unsigned char) str[i])) return false;
+        result = result * 10 + (str[i] - '0');
+        if (result > 2147483648LL) return false;
+    }
+    if (str[0] == '-') result = -result;
+    if (result > 2147483647LL) return false;
+    value = (int) result;
+    return true;
+}
+
+atomic<long long> Commodity::stockChanges(0);
+atomic<long long> Commodity::priceChanges(0);
+atomic<uint64_t> Commodity::nextId(1);
+
+Commodity::Commodity() : price(0), id(0), stock(UNTRACKED), available(UNTRACKED) {
+    description = "";
+    commodityName = "";
+}
+
+Commodity::Commodity(int price, string commodityName, string description)
+        : price(price), id(0), stock(UNTRACKED), available(UNTRACKED) {
+    this->commodityName = commodityName;
+    this->description = description;
+}
+
+void Commodity::setId(uint64_t savedId) {
+    id = savedId;
+    reserveIds(savedId + 1);
+}
+
+void Commodity::reserveIds(uint64_t next) {
+    uint64_t current = nextId.load();
+    while (current < next && !nextId.compare_exchange_weak(current, next)) {}
+}
+
+void Commodity::renewId() {
+    id = nextId.fetch_add(1);
+}
+
+bool Commodity::reserve(int quantity) {
+    int current = available.load(memory_order_relaxed);
+    do {
+        if (current == UNTRACKED) return true;
+        if (current < quantity) return false;
+    } while (!available.compare_exchange_weak(current, current - quantity, memory_order_acq_rel,
+                                              memory_order_relaxed));
+    return true;
+}
+
+void Commodity::release(int quantity) {
+    if (available.load(memory_order_relaxed) == UNTRACKED) return;
+    available.fetch_add(quantity, memory_order_acq_rel);
+}
+
+void Commodity::commit(int quantity) {
+    if (stock.load(memory_order_relaxed) == UNTRACKED) return;
+    stock.fetch_sub(quantity, memory_order_acq_rel);
+    stockChanges.fetch_add(1, memory_order_relaxed);
+}
+
+void Commodity::restock(int quantity) {
+    if (stock.load(memory_order_relaxed) == UNTRACKED) {
+        stock.store(quantity, memory_order_relaxed);
+        available.store(quantity, memory_order_release);
+    } else {
+        stock.fetch_add(quantity, memory_order_acq_rel);
+        available.fetch_add(quantity, memory_order_acq_rel);
+    }
+    stockChanges.fetch_add(1, memory_order_relaxed);
+}
+
+void Commodity::describe(string& out) {
+    out += commodityName;
+    out += '\n';
+    appendLine(out, "price: ", getPrice());
+    appendLine(out, "description: ", description);
+}
+
+void Commodity::detail(string& out) {
+    describe(out);
+    int left = getAvailable();
+    if (left != UNTRACKED) appendLine(out, "in stock: ", left);
+    out += "----------------------------\n";
+}
+
+void Commodity::detail(string& out, int amount) {
+    describe(out);
+    appendLine(out, "x ", amount);
+    out += "----------------------------\n";
+}
+
+const vector<InputPrompt>& Commodity::inputPrompts() {
+    static const vector<InputPrompt> prompts = {
+            {"name", "Please input the commodity name:", InputPrompt::TEXT},
+            {"price", "Please input the commodity price:", InputPrompt::NUMBER},
+            {"description", "Please input the detail of the commodity:", InputPrompt::TEXT}};
+    return prompts;
+}
+
+void Commodity::save(ostream& file) {
+    file  << commodityName << '\n' << getPrice() << '\n' << description << '\n';
+}
+
+const vector<string>& Commodity::recordLayout() {
+    static const vector<string> layout = {"name", "price", "description"};
+    return layout;
+}
+
+bool Commodity::loadRecord(const vector<string>& lines) {
+    const vector<string>& layout = recordLayout();
+    if (lines.size() != layout.size()) return false;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (!setField(layout[i], lines[i])) return false;
+    }
+    return true;
+}
+
+bool Commodity::setField(const string& key, const string& value) {
+    if (key == "name") {
+        commodityName = value;
+        return !value.empty();
+    }
+    if (key == "price") {
+        int parsed;
+        // The same rule as a price typed by hand in the console store
+        if (!toInt(value, parsed) || parsed <= 0) return false;
+        price.store(parsed, memory_order_relaxed);
+        return true;
+    }
+    if (key == "description") description = value;
+    if (key == "stock") {
+        int count;
+        if (!toInt(value, count) || count < UNTRACKED) return false;
+        stock.store(count, memory_order_relaxed);
+        available.store(count, memory_order_relaxed);
+    }
+    return true;
+}
+
+void Commodity::visitFields(FieldVisitor& visitor) {
+    visitor.field("name", commodityName);
+    visitor.field("price", getPrice());
+    visitor.field("description", description);
+    visitor.field("stock", getStock());
+}
+
+Sound::Sound(){
+    lowest_Frequency_Response = 0;
+    highest_Frequency_Response = 0;
+    Sensitivity = 0;
+    Impedance = 0;
+}
+
+void Sound::describe(string& out){
+    appendLine(out, "* ", commodityName, " *");
+    appendLine(out, "price: ", getPrice(), "  dollars");
+    appendLine(out, "Lowest Frequency Response: ", lowest_Frequency_Response, "  Hz");
+    appendLine(out, "Highest Frequency Response: ", highest_Frequency_Response, "  kHz");
+    appendLine(out, "Sensitivity: ", Sensitivity, "  dB");
+    appendLine(out, "Impedance: ", Impedance, "  Ohm");
+    appendLine(out, "description: ", description);
+}
+
+const vector<InputPrompt>& Sound::inputPrompts(){
+    static const vector<InputPrompt> prompts = {
+            {"name", "Please input the commodity name:", InputPrompt::TEXT},
+            {"price", "Please input the commodity price:", InputPrompt::NUMBER},
+            {"lowest_frequency_response", "Please intput the lowest frequency response", InputPrompt::NUMBER},
+            {"highest_frequency_response", "Please intput the highest frequency response", InputPrompt::NUMBER},
+            {"sensitivity", "Please input the Sensitivity", InputPrompt::NUMBER},
+            {"impedance", "Please input the Impedance", InputPrompt::NUMBER},
+            {"description", "Please input the Description", InputPrompt::TEXT}};
+    return prompts;
+}
+
+bool Sound::setField(const string& key, const string& value){
+    if (key == "lowest_frequency_response") return toInt(value, lowest_Frequency_Response);
+    if (key == "highest_frequency_response") return toInt(value, highest_Frequency_Response);
+    if (key == "sensitivity") return toInt(value, Sensitivity);
+    if (key == "impedance") return toInt(value, Impedance);
+    return Commodity::setField(key, value);
+}
+
+void Sound::visitFields(FieldVisitor& visitor){
+    Commodity::visitFields(visitor);
+    visitor.field("lowest_frequency_response", lowest_Frequency_Response);
+    visitor.field("highest_frequency_response", highest_Frequency_Response);
+    visitor.field("sensitivity", Sensitivity);
+    visitor.field("impedance", Impedance);
+}
+
+void Sound::save(ostream& file){
+    file << getPrice() << '\n' << commodityName <<'\n' <<lowest_Frequency_Response;
+    file << '\n' << highest_Frequency_Response << '\n' ;
+    file << Sensitivity <<'\n' << Impedance << '\n' << description << '\n';
+}
+
+const vector<string>& Sound::recordLayout(){
+    static const vector<string> layout = {
+            "price", "name", "lowest_frequency_response", "highest_frequency_response", "sensitivity",
+            "impedance", "description"};
+    return layout;
+}
+
+Smartphone::Smartphone(){
+    Screen_Size = 0;
+    CellularandWireless = "";
+    Camera = 0;
+    chip = "";
+    weight = 0;
+    Vedeo_playback = 0;
+}
+
+void Smartphone::describe(string& out){
+    appendLine(out, "* ", commodityName, " *");
+    appendLine(out, "price: ", getPrice(), "  dollars");
+    appendLine(out, "Screen Size: ", Screen_Size, "  inch");
+    appendLine(out, "Cellular and Wireless: ", CellularandWireless);
+    appendLine(out, "Camera: ", Camera, "  pixel");
+    appendLine(out, "chip: ", chip);
+    appendLine(out, "weight: ", weight, "  grams");
+    appendLine(out, "Vedeo playback time: ", Vedeo_playback, "  hours");
+    appendLine(out, "description: ", description);
+}
+
+const vector<InputPrompt>& Smartphone::inputPrompts(){
+    static const vector<InputPrompt> prompts = {
+            {"name", "Please input the commodity name:", InputPrompt::TEXT},
+            {"price", "Please input the commodity price:", InputPrompt::NUMBER},
+            {"screen_size", "Please intput the Screen Size", InputPrompt::NUMBER},
+            {"cellular_and_wireless", "Please intput the Cellular and Wireless", InputPrompt::TEXT},
+            {"camera", "Please input the Camera(pixel)", InputPrompt::NUMBER},
+            {"chip", "Please input the Chip", InputPrompt::TEXT},
+            {"weight", "Please input the Weight", InputPrompt::NUMBER},
+            {"video_playback", "Please input the Vedeo playback time", InputPrompt::NUMBER},
+            {"description", "Please input the detail of the commodity:", InputPrompt::TEXT}};
+    return prompts;
+}
+
+bool Smartphone::setField(const string& key, const string& value){
+    if (key == "screen_size") return toInt(value, Screen_Size);
+    if (key == "cellular_and_wireless") CellularandWireless = value;
+    else if (key == "camera") return toInt(value, Camera);
+    else if (key == "chip") chip = value;
+    else if (key == "weight") return toInt(value, weight);
+    else if (key == "video_playback") return toInt(value, Vedeo_playback);
+    else return Commodity::setField(key, value);
+    return true;
+}
+
+void Smartphone::visitFields(FieldVisitor& visitor){
+    Commodity::visitFields(visitor);
+    visitor.field("screen_size", Screen_Size);
+    visitor.field("cellular_and_wireless", CellularandWireless);
+    visitor.field("camera", Camera);
+    visitor.field("chip", chip);
+    visitor.field("weight", weight);
+    visitor.field("video_playback", Vedeo_playback);
+}
+
+void Smartphone::save(ostream& file){
+    file  << getPrice() << '\n' << commodityName << '\n';
+    file << Screen_Size << '\n'  << CellularandWireless;
+    file << '\n' << Camera << '\n' << chip << '\n' << weight << '\n' << Vedeo_playback << '\n' << description << '\n';
+}
+
+const vector<string>& Smartphone::recordLayout(){
+    static const vector<string> layout = {
+            "price", "name", "screen_size", "cellular_and_wireless", "camera", "chip", "weight",
+            "video_playback", "description"};
+    return layout;
+}
+
+Laptop::Laptop(){
+    Screen_Size = 0;
+    OStype = "";
+    CPUtype = "";
+    GPUtype = "";
+    Disksize = 0;
+    memorysize = 0;
+    RGB = 0;
+}
+
+void Laptop::describe(string& out){
+    appendLine(out, "* ", commodityName, " *");
+    appendLine(out, "price: ", getPrice(), "  dollars");
+    appendLine(out, "Screen Size: ", Screen_Size, "  inch");
+    appendLine(out, "Operatin System: ", OStype);
+    appendLine(out, "CPU: ", CPUtype);
+    appendLine(out, "GPU: ", GPUtype);
+    appendLine(out, "Max Memory Size: ", memorysize, "  GB");
+    appendLine(out, "Disk Size: ", Disksize, "  GB");
+    out += "Does it have RGB light";
+    if(RGB == 1) out += "  yes\n";
+    else if(RGB == 2) out += "  no\n";
+    appendLine(out, "description: ", description);
+}
+
+const vector<InputPrompt>& Laptop::inputPrompts(){
+    static const vector<InputPrompt> prompts = {
+            {"name", "Please input the commodity name:", InputPrompt::TEXT},
+            {"price", "Please input the commodity price:", InputPrompt::NUMBER},
+            {"os", "Please intput the Operating System", InputPrompt::TEXT},
+            {"screen_size", "Please intput the Screen Size", InputPrompt::NUMBER},
+            {"cpu", "Please input the CPU", InputPrompt::TEXT},
+            {"memory_size", "Please input the max Memory Size", InputPrompt::NUMBER},
+            {"disk_size", "Please input the Disk Size", InputPrompt::NUMBER},
+            {"gpu", "Please input the GPU", InputPrompt::TEXT},
+            {"rgb", "Is this Laptop have RGB light?  1.yes/2.no ", InputPrompt::CHOICE},
+            {"description", "Please input the detail of the commodity:", InputPrompt::TEXT}};
+    return prompts;
+}
+
+bool Laptop::setField(const string& key, const string& value){
+    if (key == "screen_size") return toInt(value, Screen_Size);
+    if (key == "os") OStype = value;
+    else if (key == "cpu") CPUtype = value;
+    else if (key == "gpu") GPUtype = value;
+    else if (key == "disk_size") return toInt(value, Disksize);
+    else if (key == "memory_size") return toInt(value, memorysize);
+    else if (key == "rgb") {
+        // The RGB attribute keeps the menu choice, 1 means yes, 2 means no and 0 means not answered
+        if (value == "1" || value == "yes" || value == "true") RGB = 1;
+        else if (value == "2" || value == "no" || value == "false") RGB = 2;
+        else if (value == "0") RGB = 0;
+        else return false;
+    }
+    else return Commodity::setField(key, value);
+    return true;
+}
+
+void Laptop::visitFields(FieldVisitor& visitor){
+    Commodity::visitFields(visitor);
+    visitor.field("screen_size", Screen_Size);
+    visitor.field("os", OStype);
+    visitor.field("cpu", CPUtype);
+    visitor.field("gpu", GPUtype);
+    visitor.field("disk_size", Disksize);
+    visitor.field("memory_size", memorysize);
+    visitor.field("rgb", RGB);
+}
+
+void Laptop::save(ostream& file){
+    file << getPrice() << '\n' << commodityName ;
+    file << '\n'  <<  Screen_Size << '\n' << OStype ;
+    file << '\n'  << memorysize << '\n' << CPUtype   << '\n' << RGB << '\n' << GPUtype<< '\n' << Disksize << '\n' << description << '\n';
+}
+
+const vector<string>& Laptop::recordLayout(){
+    static const vector<string> layout = {
+            "price", "name", "screen_size", "os", "memory_size", "cpu", "rgb", "gpu", "disk_size",
+            "description"};
+    return layout;
+}
+
+vector<CommodityCategory>& CategoryRegistry::categories() {
+    static vector<CommodityCategory> registry = {
+            {"Sound", "SoundCommodity.txt", &CategoryRegistry::create<Sound>},
+            {"Smartphone", "SmartphoneCommodity.txt", &CategoryRegistry::create<Smartphone>},
+            {"Laptop", "LaptopCommodity.txt", &CategoryRegistry::create<Laptop>}
+    };
+    return registry;
+}
+
+int CategoryRegistry::size() {
+    return (int) categories().size();
+}
+
+const CommodityCategory& CategoryRegistry::get(int index) {
+    return categories()[index];
+}
+
+int CategoryRegistry::find(const string& label) {
+    for (int i = 0; i < size(); i++) {
+        const string& candidate = categories()[i].label;
+        if (candidate.size() != label.size()) continue;
+        size_t same = 0;
+        while (same < label.size() &&
+               tolower((unsigned char) candidate[same]) == tolower((unsigned char) label[same])) {
+            same++;
+        }
+        if (same == label.size()) return i;
+    }
+    return -1;
+}
@@ -0,0 +1,384 @@
+#ifndef STORE_CORE_COMMODITY_H
+#define STORE_CORE_COMMODITY_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * FieldVisitor receive the attributes of a commodity one by one, see Commodity::visitFields.
+ * The key is the same name accepted by Commodity::setField.
+ */
+class FieldVisitor {
+public:
+    virtual ~FieldVisitor() = default;
+    virtual void field(const char* key, const std::string& value) = 0;
+    virtual void field(const char* key, int value) = 0;
+};
+
+/*
+ * InputPrompt describe one attribute the manager is asked for when a commodity is added by hand.
+ * ATTRIBUTE:
+ *  key: The attribute name passed to Commodity::setField.
+ *  prompt: The question shown to the manager.
+ *  kind: TEXT is a whole line, NUMBER a positive integer, and CHOICE is 1 for yes, 2 for no.
+ */
+struct InputPrompt {
+    enum Kind {TEXT, NUMBER, CHOICE};
+
+    const char* key;
+    const char* prompt;
+    Kind kind;
+};
+
+/*
+ * Commodity is about an item which the user can buy and the manager can add or delete.
+ * ATTRIBUTE:
+ *  price: The price of the commodity, an integer. It is atomic, so the manager can change it with setPrice while a
+ *         checkpoint reads it.
+ *  description: The text which describe the commodity detail, a string.
+ *  commodityName: The name of the commodity, a string.
+ *  id: The number which identifies the commodity for as long as it exists, it never changes and is saved with it.
+ *      It is 0 until the commodity is loaded with its saved id or added to a CommodityList.
+ *  stock: The number of items the store has, UNTRACKED when the store does not count them.
+ *  available: The stock which is not reserved by a cart. Both counters are atomic, so the carts of different threads
+ *             can reserve the same commodity without a lock, see reserve().
+ */
+class Commodity {
+protected:
+    std::atomic<int> price;
+    std::string description;
+    std::string commodityName;
+    uint64_t id;
+    std::atomic<int> stock;
+    std::atomic<int> available;
+
+    // Bumped whenever a stock changes, see stockVersion()
+    static std::atomic<long long> stockChanges;
+    // Bumped whenever a price changes, see priceVersion()
+    static std::atomic<long long> priceChanges;
+    // The id the next commodity gets. The catalog files keep it, see reserveIds, so an id is never given twice
+    static std::atomic<uint64_t> nextId;
+
+    /*
+     * Append the attribute lines of detail(), without the amount and the separator line.
+     */
+    virtual void describe(std::string& out);
+
+    /*
+     * Convert a whole string into an integer. Unlike stoi, it fails on trailing characters and on overflow.
+     * INPUT: string, and the integer to store the result
+     * RETURN: Bool. True if the string is an integer, otherwise false and the integer is unchanged.
+     */
+    static bool toInt(const std::string& str, int& value);
+
+public:
+    static const int UNTRACKED = -1;
+
+    virtual ~Commodity() = default;
+    Commodity();
+
+    Commodity(int price, std::string commodityName, std::string description);
+
+    /*
+     * This method will append the full information of the commodity to out, the front end decides where to show it.
+     * There is a overloading version, with an argument amount which will output the information with the amount
+     * INPUT: The string to append to, and an integer specify the amount of this commodity (option)
+     * RETURN: None
+     */
+    void detail(std::string& out);
+
+    void detail(std::string& out, int amount);
+
+    /*
+     * The attributes asked when the manager add a commodity by hand, in the order they are asked.
+     * The front end read each answer and pass it to setField.
+     */
+    virtual const std::vector<InputPrompt>& inputPrompts();
+
+    /*
+     * Save function is used to write the data to the file, one attribute in each line.
+     * The order of the lines is given by recordLayout, and loadRecord read them back in the same order.
+     * INPUT: ostream
+     * OUTPUT: none
+     */
+    virtual void save(std::ostream& file);
+
+    /*
+     * The attribute names in the order save() write them, the names are the keys accepted by setField.
+     */
+    virtual const std::vector<std::string>& recordLayout();
+
+    /*
+     * Init the object from the lines of one saved record, each line is passed to setField with its layout name.
+     * INPUT: The lines of the record
+     * OUTPUT: Bool. False if the number of lines is wrong or a line is not valid for its attribute
+     */
+    bool loadRecord(const std::vector<std::string>& lines);
+
+    /*
+     * Set one attribute from its text form, it is used by the importer to map a column to the commodity.
+     * The key is the lower case attribute name, e.g. "name", "price" or "screen_size".
+     * Unknown keys are ignored, so a row can carry columns belonging to other categories. A price must be above 0.
+     * INPUT: The attribute name and its value
+     * OUTPUT: Bool. False if the value is not valid for the attribute
+     */
+    virtual bool setField(const std::string& key, const std::string& value);
+
+    /*
+     * Pass every attribute to the visitor, the base attributes come first and always in the same order.
+     * It is the read side of setField, the exporter use it to write a commodity without knowing its type.
+     * INPUT: FieldVisitor
+     * OUTPUT: None
+     */
+    virtual void visitFields(FieldVisitor& visitor);
+
+    /*
+     * The getter function of commodityName
+     */
+    const std::string& getName() {
+        return commodityName;
+    }
+
+    /*
+     * The getter function of id. A loaded commodity gets its saved id back, a new one gets the next free id when it
+     * is added to the list, so a commodity which is only built to read its layout does not use an id up.
+     */
+    uint64_t getId() {
+        return id;
+    }
+
+    /*
+     * Give the commodity its saved id, the commodities created later get larger ids.
+     */
+    void setId(uint64_t savedId);
+
+    /*
+     * Give the commodity the next free id, when it has none yet or its saved id is already taken.
+     */
+    void renewId();
+
+    /*
+     * Return the id the next commodity gets. Every id below it may have been given, to a commodity deleted since.
+     */
+    static uint64_t peekNextId() {
+        return nextId.load();
+    }
+
+    /*
+     * Make the commodities created later get ids of at least next, e.g. the peekNextId() of a previous run.
+     */
+    static void reserveIds(uint64_t next);
+
+    /*
+     * The getter function of price
+     */
+    int getPrice() {
+        return price.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * Change the price in place, the commodity keeps its id and its place in the list.
+     * Like restock, it is called by the thread which owns the list.
+     */
+    void setPrice(int newPrice) {
+        price.store(newPrice, std::memory_order_relaxed);
+        priceChanges.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /*
+     * Return the stock, or UNTRACKED. The stock is not a record line, it is saved on the marker line of the record.
+     */
+    int getStock() {
+        return stock.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * Return the stock which is not reserved, or UNTRACKED.
+     */
+    int getAvailable() {
+        return available.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * Take quantity items out of the available stock for a cart. It is a compare and swap loop on one counter, so
+     * concurrent reservations never sell more than the stock and never wait for a lock.
+     * An untracked commodity can always be reserved.
+     * INPUT: The number of items, more than 0
+     * RETURN: Bool. False if fewer items are available, nothing is reserved then
+     */
+    bool reserve(int quantity);
+
+    /*
+     * Give back items reserved by reserve(), e.g. a line removed from a cart or a reservation which expired.
+     */
+    void release(int quantity);
+
+    /*
+     * The reserved items are sold, they leave the stock. The available stock was already taken by reserve().
+     */
+    void commit(int quantity);
+
+    /*
+     * Add items to the stock, an untracked commodity starts counting from quantity.
+     * Unlike reserve and commit, it is called by the thread which owns the list.
+     */
+    void restock(int quantity);
+
+    /*
+     * A number which changes whenever the stock of any commodity changes, CommodityList::version() includes it.
+     */
+    static long long stockVersion() {
+        return stockChanges.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * A number which changes whenever the price of any commodity changes, CommodityList::version() includes it.
+     */
+    static long long priceVersion() {
+        return priceChanges.load(std::memory_order_relaxed);
+    }
+};
+
+class Sound : public Commodity{
+private:
+    int lowest_Frequency_Response;
+    int highest_Frequency_Response;
+    int Sensitivity;
+    int Impedance;
+
+protected:
+    void describe(std::string& out) override;
+
+public:
+    ~Sound() override = default;
+    Sound();
+
+    const std::vector<InputPrompt>& inputPrompts() override;
+
+    bool setField(const std::string& key, const std::string& value) override;
+
+    void visitFields(FieldVisitor& visitor) override;
+
+    void save(std::ostream& file) override;
+
+    const std::vector<std::string>& recordLayout() override;
+};
+
+class Smartphone :public Commodity{
+private:
+    int Screen_Size;
+    std::string CellularandWireless;
+    int Camera;
+    std::string chip;
+    int weight;
+    int Vedeo_playback;
+
+protected:
+    void describe(std::string& out) override;
+
+public:
+    ~Smartphone() override = default;
+    Smartphone();
+
+    const std::vector<InputPrompt>& inputPrompts() override;
+
+    bool setField(const std::string& key, const std::string& value) override;
+
+    void visitFields(FieldVisitor& visitor) override;
+
+    void save(std::ostream& file) override;
+
+    const std::vector<std::string>& recordLayout() override;
+};
+
+class Laptop:public Commodity{
+private:
+    int Screen_Size;
+    std::string OStype;
+    std::string CPUtype;
+    std::string GPUtype;
+    int Disksize;
+    int memorysize;
+    int RGB;
+
+protected:
+    void describe(std::string& out) override;
+
+public:
+    ~Laptop() override = default;
+    Laptop();
+
+    const std::vector<InputPrompt>& inputPrompts() override;
+
+    bool setField(const std::string& key, const std::string& value) override;
+
+    void visitFields(FieldVisitor& visitor) override;
+
+    void save(std::ostream& file) override;
+
+    const std::vector<std::string>& recordLayout() override;
+};
+
+/*
+ * CommodityCategory describe one kind of commodity the store sells.
+ * ATTRIBUTE:
+ *  label: The name shown before the commodities of this category, e.g. "Sound".
+ *  fileName: The file which the commodities of this category are saved to and loaded from.
+ *  create: The factory function, it return an empty commodity object of this category.
+ */
+struct CommodityCategory {
+    std::string label;
+    std::string fileName;
+    Commodity* (*create)();
+};
+
+/*
+ * CategoryRegistry keep every category the store can sell. The position of a category inside the registry is the
+ * category index used by CommodityList, ShoppingCart and Store.
+ * Sound, Smartphone and Laptop are registered by default. Other types call add<T>() before the store is opened.
+ */
+class CategoryRegistry {
+private:
+    template<class T>
+    static Commodity* create() {
+        return new T();
+    }
+
+    static std::vector<CommodityCategory>& categories();
+
+public:
+    /*
+     * Register a new category, T must be a derived class of Commodity with a default constructor.
+     * INPUT: The label and the file name of the category
+     * RETURN: Integer. The index of the new category
+     */
+    template<class T>
+    static int add(const std::string& label, const std::string& fileName) {
+        categories().push_back({label, fileName, &CategoryRegistry::create<T>});
+        return (int) categories().size() - 1;
+    }
+
+    /*
+     * Return the number of registered categories
+     */
+    static int size();
+
+    /*
+     * Return the category at specified index
+     * INPUT: Integer. The category index
+     * RETURN: CommodityCategory. The wanted category
+     */
+    static const CommodityCategory& get(int index);
+
+    /*
+     * Find the category whose label is the same as the input, the case is ignored.
+     * INPUT: The label
+     * RETURN: Integer. The category index, or -1 if there is no such category
+     */
+    static int find(const std::string& label);
+};
+
+#endif
@@ -0,0 +1,488 @@
+#include "CommodityList.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+
+#include "AtomicFile.h"
+#include "Metrics.h"
+
+using namespace std;
+
+namespace {
+
+    // A compaction starts when a quarter of the slots are tombstones, and there are at least this many of them
+    const int MIN_TOMBSTONES = 64;
+
+    int countTrailingZeros(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(bits);
+#else
+        int count = 0;
+        while ((bits & 1) == 0) {
+            bits >>= 1;
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    int countBits(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(bits);
+#else
+        int count = 0;
+        for (; bits != 0; bits &= bits - 1) count++;
+        return count;
+#endif
+    }
+
+    /*
+     * The buffer a commodity writes its record lines through. A line which starts with '@', '#' or '\' gets a '\'
+     * in front, so a name or a description can not be read back as a marker, the header or the trailer.
+     */
+    class RecordEscaper : public streambuf {
+    public:
+        explicit RecordEscaper(streambuf* target) : target(target) {
+            setp(buffer, buffer + sizeof(buffer));
+        }
+
+    protected:
+        int overflow(int c) override {
+            if (sync() != 0) return traits_type::eof();
+            if (c != traits_type::eof()) {
+                *pptr() = (char) c;
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        int sync() override {
+            const char* p = pbase();
+            const char* end = pptr();
+            setp(buffer, buffer + sizeof(buffer));
+            while (p < end) {
+                if (lineStart && (*p == '@' || *p == '#' || *p == '\\') && target->sputc('\\') == traits_type::eof()) {
+                    return -1;
+                }
+                const char* newline = (const char*) memchr(p, '\n', (size_t) (end - p));
+                const char* stop = newline == nullptr ? end : newline + 1;
+                if (target->sputn(p, stop - p) != stop - p) return -1;
+                lineStart = newline != nullptr;
+                p = stop;
+            }
+            return 0;
+        }
+
+    private:
+        streambuf* target;
+        char buffer[4096];
+        bool lineStart = true;
+    };
+}
+
+void CommodityList::Slots::reserve(int slots) {
+    commodities.reserve(slots);
+    live.reserve((slots + 63) / 64);
+    blockLive.reserve((slots + BLOCK_SLOTS - 1) / BLOCK_SLOTS);
+}
+
+void CommodityList::Slots::push(Commodity* commodity) {
+    int slot = (int) commodities.size();
+    commodities.push_back(commodity);
+    if ((slot & 63) == 0) live.push_back(0);
+    live[slot >> 6] |= (uint64_t) 1 << (slot & 63);
+    if (slot % BLOCK_SLOTS == 0) blockLive.push_back(0);
+    blockLive[slot / BLOCK_SLOTS]++;
+    liveCount++;
+}
+
+void CommodityList::Slots::kill(int slot) {
+    live[slot >> 6] &= ~((uint64_t) 1 << (slot & 63));
+    blockLive[slot / BLOCK_SLOTS]--;
+    liveCount--;
+}
+
+int CommodityList::Slots::select(int rank) const {
+    // Without tombstones the rank is the slot
+    if (liveCount == (int) commodities.size()) return rank;
+    int block = 0;
+    while (rank >= blockLive[block]) {
+        rank -= blockLive[block];
+        block++;
+    }
+    int word = block * (BLOCK_SLOTS / 64);
+    while (rank >= countBits(live[word])) {
+        rank -= countBits(live[word]);
+        word++;
+    }
+    uint64_t bits = live[word];
+    for (; rank > 0; rank--) bits &= bits - 1;
+    return word * 64 + countTrailingZeros(bits);
+}
+
+int CommodityList::Slots::nextLive(int slot) const {
+    int size = (int) commodities.size();
+    if (slot >= size) return size;
+    int word = slot >> 6;
+    uint64_t bits = live[word] & (~(uint64_t) 0 << (slot & 63));
+    while (bits == 0) {
+        if (++word == (int) live.size()) return size;
+        bits = live[word];
+    }
+    return word * 64 + countTrailingZeros(bits);
+}
+
+int CommodityList::Version::size() const {
+    int time = 0;
+    for (const vector<Commodity*>& commodities : categories) time = time + (int) commodities.size();
+    return time;
+}
+
+const vector<Commodity*>& CommodityList::Version::getCategory(int index) const {
+    static const vector<Commodity*> none;
+    if (index < 0 || index >= (int) categories.size()) return none;
+    return categories[index];
+}
+
+Commodity* CommodityList::Version::get(int index) const {
+    for (const vector<Commodity*>& commodities : categories) {
+        if (index < (int) commodities.size()) return commodities[index];
+        index = index - (int) commodities.size();
+    }
+    return nullptr;
+}
+
+int CommodityList::Version::getIndex(int index) const {
+    for (int i = 0; i < (int) categories.size(); i++) {
+        if (index < (int) categories[i].size()) return i;
+        index = index - (int) categories[i].size();
+    }
+    return 0;
+}
+
+CommodityList::Slots& CommodityList::category(int index) {
+    if (index >= (int) commodityList.size()) {
+        commodityList.resize(index + 1);
+    }
+    return commodityList[index];
+}
+
+CommodityList::CommodityList() {
+    commodityList.resize(CategoryRegistry::size());
+}
+
+CommodityList::~CommodityList() {
+    // The task reads the storage of the list
+    if (compacting.valid()) compacting.wait();
+    for (pair<long long, Commodity*>& entry : retired) delete entry.second;
+}
+
+void CommodityList::commoditiesDetail(string& out) {
+    int time = 0;
+    for (int i = 0; i < (int) commodityList.size(); i++) {
+        if (commodityList[i].liveCount == 0) continue;
+        out += CategoryRegistry::get(i).label;
+        out += ":\n";
+        for (Commodity* commodity : CategoryRange(commodityList[i])) {
+            time++;
+            out += to_string(time);
+            out += " .\n";
+            commodity->detail(out);
+        }
+    }
+}
+
+void CommodityList::commoditiesName(string& out) {
+    int time = 0;
+    for (int i = 0; i < (int) commodityList.size(); i++) {
+        if (commodityList[i].liveCount == 0) continue;
+        out += CategoryRegistry::get(i).label;
+        out += ":\n";
+        for (Commodity* commodity : CategoryRange(commodityList[i])) {
+            time++;
+            out += to_string(time);
+            out += " .\n";
+            out += commodity->getName();
+            out += '\n';
+        }
+    }
+}
+
+int CommodityList::size() {
+    int time = 0;
+    for (const Slots& commodities : commodityList) {
+        time = time + commodities.liveCount;
+    }
+    return time;
+}
+
+int CommodityList::Size_index(int index) {
+    if (index < 0 || index >= (int) commodityList.size()) return 0;
+    return commodityList[index].liveCount;
+}
+
+Commodity* CommodityList::get(int index) {
+    for (const Slots& commodities : commodityList) {
+        if (index < commodities.liveCount) return commodities.commodities[commodities.select(index)];
+        index = index - commodities.liveCount;
+    }
+    return nullptr;
+}
+
+int CommodityList::getIndex(int index) {
+    for (int i = 0; i < (int) commodityList.size(); i++) {
+        if (index < commodityList[i].liveCount) return i;
+        index = index - commodityList[i].liveCount;
+    }
+    return 0;
+}
+
+void CommodityList::add(Commodity* newCommodity, int index) {
+    if (newCommodity->getId() == 0 || idIndex.count(newCommodity->getId()) != 0) newCommodity->renewId();
+    Slots& commodities = category(index);
+    grow(commodities, 1);
+    Location location = {newCommodity, index, (int) commodities.commodities.size()};
+    commodities.push(newCommodity);
+    nameIndex.emplace(newCommodity->getName(), make_pair(newCommodity, index));
+    idIndex.emplace(newCommodity->getId(), location);
+    changes++;
+}
+
+int CommodityList::addBatch(vector<pair<Commodity*, int>>& batch) {
+    vector<int> grown(commodityList.size());
+    for (const pair<Commodity*, int>& row : batch) {
+        if (row.second >= (int) grown.size()) grown.resize(row.second + 1);
+        grown[row.second]++;
+    }
+    for (int i = 0; i < (int) grown.size(); i++) {
+        if (grown[i] == 0) continue;
+        // The category may grow the list, so it is looked up before its size is read
+        Slots& slots = category(i);
+        grow(slots, grown[i]);
+    }
+    nameIndex.reserve(nameIndex.size() + batch.size());
+    idIndex.reserve(idIndex.size() + batch.size());
+
+    // The rejected rows are moved to the front of the batch
+    size_t rejected = 0;
+    for (const pair<Commodity*, int>& row : batch) {
+        Commodity* commodity = row.first;
+        if (!nameIndex.emplace(commodity->getName(), row).second) {
+            batch[rejected++] = row;
+            continue;
+        }
+        if (commodity->getId() == 0 || idIndex.count(commodity->getId()) != 0) commodity->renewId();
+        Slots& commodities = commodityList[row.second];
+        idIndex.emplace(commodity->getId(), Location{commodity, row.second, (int) commodities.commodities.size()});
+        commodities.push(commodity);
+    }
+    int added = (int) (batch.size() - rejected);
+    batch.resize(rejected);
+    if (added != 0) changes++;
+    return added;
+}
+
+void CommodityList::grow(Slots& slots, int more) {
+    size_t needed = slots.commodities.size() + (size_t) more;
+    if (compaction != nullptr && needed > slots.commodities.capacity()) {
+        vector<Commodity*> larger;
+        larger.reserve(max(needed, slots.commodities.capacity() * 2));
+        larger.assign(slots.commodities.begin(), slots.commodities.end());
+        // Moving a vector keeps its storage, so what the task reads stays where it is
+        compaction->kept.push_back(move(slots.commodities));
+        slots.commodities = move(larger);
+    }
+    slots.reserve((int) needed);
+}
+
+void CommodityList::removeSlot(int index, int slot) {
+    Commodity* commodity = commodityList[index].commodities[slot];
+    commodityList[index].kill(slot);
+    nameIndex.erase(commodity->getName());
+    idIndex.erase(commodity->getId());
+    tombstones++;
+    if (compaction != nullptr) compaction->removed.push_back(commodity->getId());
+    // The change count is raised after the removal, so the versions pinned from now on have a larger number
+    retired.emplace_back(changes, commodity);
+}
+
+void CommodityList::reclaim() {
+    long long oldest = versions.empty() ? changes : versions.begin()->first;
+    // The commodities are retired in change order
+    size_t freed = 0;
+    for (; freed < retired.size() && retired[freed].first < oldest; freed++) delete retired[freed].second;
+    retired.erase(retired.begin(), retired.begin() + (long) freed);
+}
+
+void CommodityList::remove(int index) {
+    for (int i = 0; i < (int) commodityList.size(); i++) {
+        if (index < commodityList[i].liveCount) {
+            removeSlot(i, commodityList[i].select(index));
+            changes++;
+            return;
+        }
+        index = index - commodityList[i].liveCount;
+    }
+}
+
+bool CommodityList::removeId(uint64_t id) {
+    auto found = idIndex.find(id);
+    if (found == idIndex.end()) return false;
+    removeSlot(found->second.category, found->second.slot);
+    changes++;
+    return true;
+}
+
+int CommodityList::removeBatch(const vector<string>& names, vector<uint64_t>* removedIds) {
+    int removed = 0;
+    for (const string& name : names) {
+        auto found = nameIndex.find(name);
+        if (found == nameIndex.end()) continue;
+        const Location& location = idIndex.find(found->second.first->getId())->second;
+        if (removedIds != nullptr) removedIds->push_back(location.commodity->getId());
+        removeSlot(location.category, location.slot);
+        removed++;
+    }
+    if (removed != 0) changes++;
+    return removed;
+}
+
+void CommodityList::compact(TaskPool& pool) {
+    int slots = 0;
+    for (const Slots& commodities : commodityList) slots += (int) commodities.commodities.size();
+    if (tombstones < MIN_TOMBSTONES || tombstones * 4 < slots) return;
+
+    // Only the live bitmaps are copied here, the slots before copied do not change until the compaction is installed
+    shared_ptr<Compaction> copy = make_shared<Compaction>();
+    for (const Slots& commodities : commodityList) {
+        copy->copied.push_back((int) commodities.commodities.size());
+        copy->storage.push_back(commodities.commodities.data());
+        copy->live.push_back(commodities.live);
+        copy->categories.emplace_back();
+        copy->categories.back().reserve(commodities.liveCount);
+    }
+    compaction = copy;
+    compacting = pool.submit([copy]() {
+        STORE_TIMED(COMPACT);
+        for (int i = 0; i < (int) copy->categories.size(); i++) {
+            Slots& compacted = copy->categories[i];
+            const vector<uint64_t>& live = copy->live[i];
+            for (int word = 0; word < (int) live.size(); word++) {
+                for (uint64_t bits = live[word]; bits != 0; bits &= bits - 1) {
+                    Commodity* commodity = copy->storage[i][word * 64 + countTrailingZeros(bits)];
+                    copy->idIndex[commodity->getId()] = {commodity, i, (int) compacted.commodities.size()};
+                    compacted.push(commodity);
+                }
+            }
+        }
+        return true;
+    });
+}
+
+void CommodityList::install() {
+    shared_ptr<Compaction> done = move(compaction);
+    compacting.get();
+    tombstones = 0;
+    for (uint64_t id : done->removed) {
+        auto found = done->idIndex.find(id);
+        if (found == done->idIndex.end()) continue;
+        done->categories[found->second.category].kill(found->second.slot);
+        done->idIndex.erase(found);
+        tombstones++;
+    }
+    for (int i = 0; i < (int) commodityList.size(); i++) {
+        if (i == (int) done->categories.size()) done->categories.emplace_back();
+        Slots& compacted = done->categories[i];
+        int copied = i < (int) done->copied.size() ? done->copied[i] : 0;
+        // The slots added after the copy keep their tombstones
+        for (int slot = copied; slot < (int) commodityList[i].commodities.size(); slot++) {
+            Commodity* commodity = commodityList[i].commodities[slot];
+            if (commodityList[i].isLive(slot)) {
+                done->idIndex[commodity->getId()] = {commodity, i, (int) compacted.commodities.size()};
+                compacted.push(commodity);
+            } else {
+                compacted.push(commodity);
+                compacted.kill((int) compacted.commodities.size() - 1);
+                tombstones++;
+            }
+        }
+    }
+    commodityList.swap(done->categories);
+    idIndex.swap(done->idIndex);
+}
+
+CommodityList::Pin CommodityList::pin() {
+    Pin current = pinned(changes);
+    if (current != nullptr) return current;
+
+    shared_ptr<Version> version = make_shared<Version>();
+    version->number = changes;
+    version->categories.resize(commodityList.size());
+    for (int i = 0; i < (int) commodityList.size(); i++) {
+        CategoryRange commodities(commodityList[i]);
+        version->categories[i].assign(commodities.begin(), commodities.end());
+    }
+    versions[changes] = version;
+    return version;
+}
+
+CommodityList::Pin CommodityList::pinned(long long number) {
+    auto found = versions.find(number);
+    return found == versions.end() ? nullptr : found->second.lock();
+}
+
+void CommodityList::maintain(TaskPool& pool) {
+    for (auto i = versions.begin(); i != versions.end();) {
+        if (i->second.expired()) i = versions.erase(i);
+        else ++i;
+    }
+    if (compacting.valid()) {
+        if (compacting.wait_for(chrono::seconds(0)) != future_status::ready) return;
+        install();
+    }
+    reclaim();
+    compact(pool);
+}
+
+void CommodityList::writeRecords(ostream& out, int index, const vector<Commodity*>& commodities) {
+    const string& label = CategoryRegistry::get(index).label;
+    out << "#next-id " << Commodity::peekNextId() << '\n';
+    RecordEscaper escaper(out.rdbuf());
+    ostream record(&escaper);
+    for (Commodity* commodity : commodities) {
+        int stock = commodity->getStock();
+        out << '@' << label << " id=" << commodity->getId();
+        if (stock != Commodity::UNTRACKED) out << " stock=" << stock;
+        out << '\n';
+        commodity->save(record);
+        // The marker of the next record is written around the escaper
+        if (!record.flush()) out.setstate(ios::badbit);
+    }
+}
+
+bool CommodityList::save(vector<string>* failedFiles, TaskPool& pool) {
+    STORE_TIMED(SAVE);
+    // One task for each file, the list is only read and the caller waits for all of them
+    vector<future<bool>> saved;
+    Pin version = pin();
+    for (int i = 0; i < CategoryRegistry::size(); i++) {
+        const CommodityCategory& commodityCategory = CategoryRegistry::get(i);
+        const vector<Commodity*>& commodities = version->getCategory(i);
+        saved.push_back(pool.submit([&commodityCategory, &commodities, i]() {
+            AtomicFileWriter writer(commodityCategory.fileName);
+            if (!writer.isOpen()) return false;
+            ostream FileOutput(&writer);
+            writeRecords(FileOutput, i, commodities);
+            return writer.commit();
+        }));
+    }
+    bool success = true;
+    for (int i = 0; i < (int) saved.size(); i++) {
+        if (pool.wait(saved[i])) continue;
+        if (failedFiles != nullptr) failedFiles->push_back(CategoryRegistry::get(i).fileName);
+        success = false;
+    }
+    return success;
+}
@@ -0,0 +1,463 @@
+#ifndef STORE_CORE_COMMODITY_LIST_H
+#define STORE_CORE_COMMODITY_LIST_H
+
+#include <cstddef>
+#include <future>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Commodity.h"
+#include "TaskPool.h"
+
+/*
+ * This is a list storing the existing commodity in the store.
+ * There are some method which can modify the content.
+ * The commodities are grouped by category, each category is kept in its own contiguous vector. The position shown to
+ * the user counts through the categories in registry order, and only the live commodities are counted.
+ * A removed commodity leaves a tombstone: its slot stays and its bit in the live bitmap of the category is cleared, so
+ * a removal does not move the other slots. When the tombstones grow to a quarter of the slots, a task of the pool
+ * copies the live slots into new vectors and maintain() installs them, the order of the live commodities is kept.
+ * The task reads the slot vectors of the list itself, only the live bitmaps are copied when it starts, and a vector
+ * which must grow meanwhile leaves its old storage to the task. The pointer kept by a tombstone is never read.
+ * The list owns a commodity once it is removed, and maintain() deletes it when nothing can reach it any more.
+ * A reader which must see the positions it listed, a shopper between the list and the choice or a checkpoint, pins
+ * a Version. While the list does not change every pin shares the same copy, and a copy is freed with its last pin.
+ * A removed commodity is deleted once the last version older than its removal is freed, the newer ones never had it.
+ */
+class CommodityList {
+private:
+    /*
+     * The slots of one category. blockLive counts the live slots of every BLOCK_SLOTS slots, so the slot of the n-th
+     * live commodity is found by skipping whole blocks and then whole words of the bitmap.
+     */
+    struct Slots {
+        static const int BLOCK_SLOTS = 512;
+
+        std::vector<Commodity*> commodities;
+        std::vector<uint64_t> live;
+        std::vector<int> blockLive;
+        int liveCount = 0;
+
+        bool isLive(int slot) const {
+            return (live[slot >> 6] >> (slot & 63) & 1) != 0;
+        }
+
+        void reserve(int slots);
+
+        void push(Commodity* commodity);
+
+        void kill(int slot);
+
+        /*
+         * Return the slot of the live commodity at rank, rank must be less than liveCount.
+         */
+        int select(int rank) const;
+
+        /*
+         * Return the first live slot from slot on, or the slot count if there is none.
+         */
+        int nextLive(int slot) const;
+    };
+
+    // Where a commodity is, the slot is the index inside the vector of its category
+    struct Location {
+        Commodity* commodity;
+        int category;
+        int slot;
+    };
+
+    // The compacted slots built by a task of the pool, see maintain()
+    struct Compaction {
+        std::vector<Slots> categories;
+        std::unordered_map<uint64_t, Location> idIndex;
+        // The slot count of every category when the copy was taken, and the ids removed since
+        std::vector<int> copied;
+        std::vector<uint64_t> removed;
+        // The slots the task reads, the storage of every category and its live bitmap when the copy was taken
+        std::vector<Commodity* const*> storage;
+        std::vector<std::vector<uint64_t>> live;
+        // The storage a category grew out of while the task reads it
+        std::vector<std::vector<Commodity*>> kept;
+    };
+
+    std::vector<Slots> commodityList;
+    // The commodity and its category by name, and the commodity, its category and its slot by id
+    std::unordered_map<std::string, std::pair<Commodity*, int>> nameIndex;
+    std::unordered_map<uint64_t, Location> idIndex;
+    long long changes = 0;
+    int tombstones = 0;
+    std::shared_ptr<Compaction> compaction;
+    std::future<bool> compacting;
+    // The removed commodities which are not deleted yet, each with the change it was removed at. Only the versions
+    // with that number or a smaller one have it
+    std::vector<std::pair<long long, Commodity*>> retired;
+
+    /*
+     * Return the storage of a category, it grows when the category is registered after the list is created.
+     */
+    Slots& category(int index);
+
+    /*
+     * Make room for more slots in a category. While a compaction reads the storage it is not moved, a larger one
+     * takes its place and the compaction keeps the old one.
+     */
+    void grow(Slots& slots, int more);
+
+    /*
+     * Tombstone a slot and drop it from the indexes, the change count is left to the caller.
+     */
+    void removeSlot(int index, int slot);
+
+    /*
+     * Delete the removed commodities nothing can reach any more, it is not called while a compaction runs.
+     */
+    void reclaim();
+
+    /*
+     * Start a compaction when there are enough tombstones and none is running.
+     */
+    void compact(TaskPool& pool);
+
+    /*
+     * Install a finished compaction, the removals and adds made after the copy was taken are replayed on it.
+     */
+    void install();
+
+public:
+    /*
+     * The live commodities of a category in the order they are shown to the user. The iterator skips the tombstones
+     * one bitmap word at a time. A change of the list invalidates the range.
+     */
+    class CategoryRange {
+    private:
+        const Slots* slots;
+
+    public:
+        class iterator {
+        private:
+            const Slots* slots;
+            int slot;
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef Commodity* value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef Commodity* const* pointer;
+            typedef Commodity* const& reference;
+
+            iterator(const Slots* slots, int slot) : slots(slots), slot(slot) {}
+
+            reference operator*() const {
+                return slots->commodities[slot];
+            }
+
+            iterator& operator++() {
+                slot = slots->nextLive(slot + 1);
+                return *this;
+            }
+
+            iterator operator++(int) {
+                iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            bool operator==(const iterator& other) const {
+                return slot == other.slot;
+            }
+
+            bool operator!=(const iterator& other) const {
+                return slot != other.slot;
+            }
+        };
+
+        explicit CategoryRange(const Slots& slots) : slots(&slots) {}
+
+        iterator begin() const {
+            return iterator(slots, slots->nextLive(0));
+        }
+
+        iterator end() const {
+            return iterator(slots, (int) slots->commodities.size());
+        }
+
+        int size() const {
+            return slots->liveCount;
+        }
+
+        bool empty() const {
+            return slots->liveCount == 0;
+        }
+    };
+
+    /*
+     * The positions of the list at one change, it is never changed after pin() builds it.
+     */
+    class Version {
+    private:
+        friend class CommodityList;
+
+        std::vector<std::vector<Commodity*>> categories;
+        long long number = 0;
+
+    public:
+        /*
+         * Return the change of the list this version was taken at, see CommodityList::pinned.
+         */
+        long long getNumber() const {
+            return number;
+        }
+
+        int size() const;
+
+        /*
+         * Return the commodities of a category, empty for a category the version does not know.
+         */
+        const std::vector<Commodity*>& getCategory(int index) const;
+
+        /*
+         * Return the commodity at a position of this version
+         * INPUT: Integer. The index of that commodity
+         * RETURN: Commodity. The commodity, or nullptr if the position is out of range
+         */
+        Commodity* get(int index) const;
+
+        /*
+         * Return the category index of the commodity at a position of this version
+         */
+        int getIndex(int index) const;
+    };
+
+    typedef std::shared_ptr<const Version> Pin;
+
+private:
+    // The versions handed out by pin(), by number. An entry whose version is freed is dropped by maintain(), and the
+    // oldest entry left tells which removed commodities can be deleted
+    std::map<long long, std::weak_ptr<const Version>> versions;
+
+public:
+    CommodityList();
+
+    /*
+     * Wait for the running compaction, then delete the removed commodities. The live ones belong to the caller.
+     */
+    ~CommodityList();
+
+    /*
+     * Append the full information of the commodities inside the list to out, grouped under their category label.
+     * Commodity.detail() is used for every commodity, the front end print the text.
+     * INPUT: The string to append to
+     * RETURN: None
+     */
+    void commoditiesDetail(std::string& out);
+
+    /*
+     * Append only the commodity name of the commodities inside the list to out
+     * INPUT: The string to append to
+     * RETURN: None
+     */
+    void commoditiesName(std::string& out);
+
+    /*
+     * Check whether the list is empty or not
+     * INPUT: None
+     * RETURN: Bool. True if the list is empty, otherwise false
+     */
+    bool empty() {
+        return size() == 0;
+    }
+
+    /*
+     * Return the size(or length) of the list
+     * INPUT: None
+     * RETURN: Integer. List size
+     */
+    int size();
+
+    /*
+     * Return the number of commodities inside a category
+     * INPUT: Integer. The category index
+     * RETURN: Integer. The category size
+     */
+    int Size_index(int index);
+
+    /*
+     * Return the number of categories the list keeps, some of them may be empty
+     */
+    int categoryCount() {
+        return (int) commodityList.size();
+    }
+
+    /*
+     * Return every commodity of a category, in the order they are shown to the user
+     * INPUT: Integer. The category index
+     * RETURN: The live commodities of that category
+     */
+    CategoryRange getCategory(int index) {
+        return CategoryRange(category(index));
+    }
+
+    /*
+     * Return a commodity object at specified position
+     * INPUT: Integer. The index of that commodity
+     * RETURN: Commodity. The wanted commodity object
+     */
+    Commodity* get(int index);
+
+    /*
+     * Return the category index of the commodity at specified position
+     * INPUT: Integer. The index of that commodity
+     * RETURN: Integer. The category index
+     */
+    int getIndex(int index);
+
+    /*
+     * Push a new commodity object into the list
+     * A commodity without an id, or whose id is already in the list, gets a new id, so every id inside the list stays
+     * unique.
+     * INPUT: Commodity. The object need to be pushed, and the index of its category
+     * RETURN: None
+     */
+    void add(Commodity* newCommodity, int index);
+
+    /*
+     * Push many commodities in one update. The names are checked against the list and against the batch itself in
+     * one hashed pass, and the storage grows once for the whole batch.
+     * INPUT: The commodities and the index of their category, the ones whose name already exists stay in batch and
+     * the caller still owns them
+     * RETURN: Integer. The number of commodities added
+     */
+    int addBatch(std::vector<std::pair<Commodity*, int>>& batch);
+
+    /*
+     * Check the input commodity object is existing inside the list
+     * If the commodity name is the same, we take those objects the same object
+     * The names are kept in a hash set, so the check does not scan the list.
+     * INPUT: Commodity. The object need to be checked
+     * OUTPUT: Bool. True if the object existing, otherwise false
+     */
+    bool isExist(Commodity* commodity) {
+        return isExist(commodity->getName());
+    }
+
+    bool isExist(const std::string& name) {
+        return nameIndex.count(name) != 0;
+    }
+
+    /*
+     * Find a commodity by its name without scanning the list.
+     * INPUT: The name, and the integer to receive the category index
+     * OUTPUT: Commodity. The commodity, or nullptr if no commodity has that name
+     */
+    Commodity* find(const std::string& name, int& categoryIndex) {
+        auto found = nameIndex.find(name);
+        if (found == nameIndex.end()) return nullptr;
+        categoryIndex = found->second.second;
+        return found->second.first;
+    }
+
+    /*
+     * Find a commodity by its id, see Commodity::getId. Unlike a position, an id keeps pointing at the same
+     * commodity when another one is removed.
+     * INPUT: The id, and the integer to receive the category index
+     * OUTPUT: Commodity. The commodity, or nullptr if it is not in the list
+     */
+    Commodity* find(uint64_t id, int& categoryIndex) {
+        auto found = idIndex.find(id);
+        if (found == idIndex.end()) return nullptr;
+        categoryIndex = found->second.category;
+        return found->second.commodity;
+    }
+
+    /*
+     * Remove an object specified by the position
+     * The list owns the commodity from now on. It stays readable through the versions pinned before, and maintain()
+     * deletes it once none of them is left. A cart must drop its lines of the commodity before.
+     * INPUT: Integer. The position of the object which need to be removed
+     * OUTPUT: None
+     */
+    void remove(int index);
+
+    /*
+     * Remove a commodity by its id, the id table knows its slot so nothing is counted.
+     * INPUT: The id
+     * OUTPUT: Bool. False if no commodity has that id
+     */
+    bool removeId(uint64_t id);
+
+    /*
+     * Remove the commodities with the given names in one update, the names which are not in the list are skipped.
+     * Like remove(), the list owns the removed commodities.
+     * INPUT: The names, and the vector to receive the ids of the removed commodities (option)
+     * OUTPUT: Integer. The number of commodities removed
+     */
+    int removeBatch(const std::vector<std::string>& names, std::vector<uint64_t>* removedIds = nullptr);
+
+    /*
+     * Install the compaction which finished in the background, and start one when the tombstones grow to a quarter
+     * of the slots. The versions nobody pins any more are forgotten too, and the removed commodities no version can
+     * see are deleted. The owner of the list calls it between requests, the positions shown to the user do not change.
+     * INPUT: The pool to compact in (option)
+     * OUTPUT: None
+     */
+    void maintain(TaskPool& pool = TaskPool::shared());
+
+    /*
+     * Pin the current positions, the version is only copied when the list changed since the last one.
+     * The commodities of a version are not deleted, a removed one is still readable through it.
+     * INPUT: None
+     * OUTPUT: Pin. The version, it stays until the last copy of the pin is dropped
+     */
+    Pin pin();
+
+    /*
+     * Find a version which is still pinned by its number.
+     * INPUT: The number, see Version::getNumber
+     * OUTPUT: Pin. The version, or nullptr if nothing pins it any more
+     */
+    Pin pinned(long long number);
+
+    /*
+     * A number which grows on every add and remove, and on every stock or price change, so a saved copy can tell
+     * whether the list changed since.
+     */
+    long long version() {
+        return changes + Commodity::stockVersion() + Commodity::priceVersion();
+    }
+
+    /*
+     * A number which grows on every add and remove only, so an index by id can tell whether it must be built again.
+     */
+    long long changeCount() {
+        return changes;
+    }
+
+    /*
+     * Write the records of one category in the format of the catalog files, without the checksum trailer. The
+     * first line is "#next-id <n>", Commodity::peekNextId() when the file is written, which is at least every id
+     * inside any version, so the ids of the commodities deleted before are not given again after a restart.
+     * A record line which starts with '@', '#' or '\' is written with a '\' in front, see RecordLoader.
+     * INPUT: The stream, the category index, and its commodities
+     * OUTPUT: None
+     */
+    static void writeRecords(std::ostream& out, int index, const std::vector<Commodity*>& commodities);
+
+    /*
+     * Write every category into its own file, the file name is decided by the registry.
+     * Each record starts with a marker line "@" + category label, the id, and the stock when it is counted, see
+     * RecordLoader.
+     * The files are replaced by AtomicFileWriter, so a crash during save leaves the previous files in place.
+     * The files are written at the same time by tasks of the pool, from a version pinned when save starts.
+     * INPUT: The vector to receive the names of the files which are not saved (option), and the pool (option)
+     * OUTPUT: Bool. False if a file can not be saved, its previous version is kept
+     */
+    bool save(std::vector<std::string>* failedFiles = nullptr, TaskPool& pool = TaskPool::shared());
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "FacetIndex.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+    /*
+     * Collect the facet values of one commodity, found[i] is the value of keys[i] or empty.
+     */
+    class FacetCollector : public FieldVisitor {
+    public:
+        const vector<string>& keys;
+        const vector<char>& choice;
+        vector<string> found;
+        vector<char> numeric;
+
+        FacetCollector(const vector<string>& keys, const vector<char>& choice)
+                : keys(keys), choice(choice), found(keys.size()), numeric(keys.size(), 0) {}
+
+        void field(const char* key, const string& value) override {
+            int index = find(key);
+            if (index >= 0) found[index] = value;
+        }
+
+        void field(const char* key, int value) override {
+            int index = find(key);
+            if (index < 0 || value == 0) return;
+            if (choice[index]) {
+                found[index] = value == 1 ? "yes" : value == 2 ? "no" : "";
+            } else {
+                found[index] = to_string(value);
+                numeric[index] = 1;
+            }
+        }
+
+    private:
+        int find(const char* key) {
+            for (size_t i = 0; i < keys.size(); i++) {
+                if (keys[i] == key) return (int) i;
+            }
+            return -1;
+        }
+    };
+
+    // The numbers are ordered by value, a shorter one is smaller as long as none is negative
+    bool numberBefore(const string& a, const string& b) {
+        return a.size() != b.size() ? a.size() < b.size() : a < b;
+    }
+}
+
+FacetIndex::FacetIndex(int category) : FacetIndex(category, defaultKeys(category)) {}
+
+FacetIndex::FacetIndex(int category, vector<string> keys) : category(category) {
+    for (string& key : keys) facets.push_back({move(key), vector<string>(), vector<RoaringBitmap>()});
+}
+
+vector<string> FacetIndex::defaultKeys(int category) {
+    const string& label = CategoryRegistry::get(category).label;
+    if (label == "Laptop") return {"memory_size", "disk_size", "os", "rgb"};
+    if (label == "Smartphone") return {"screen_size", "chip", "cellular_and_wireless"};
+    if (label == "Sound") return {"impedance", "sensitivity"};
+    return {};
+}
+
+void FacetIndex::update(CommodityList& list) {
+    if (built && builtChanges == list.changeCount()) {
+        // The positions only move when the list changes, so the bitmaps still fit the current version
+        if (version == nullptr) version = list.pin();
+        return;
+    }
+    version = list.pin();
+    const vector<Commodity*>& commodities = version->getCategory(category);
+
+    vector<string> keys;
+    for (const Facet& facet : facets) keys.push_back(facet.key);
+    vector<char> choice(keys.size(), 0);
+    if (!commodities.empty()) {
+        for (const InputPrompt& prompt : commodities[0]->inputPrompts()) {
+            for (size_t i = 0; i < keys.size(); i++) {
+                if (prompt.kind == InputPrompt::CHOICE && keys[i] == prompt.key) choice[i] = 1;
+            }
+        }
+    }
+
+    FacetCollector collector(keys, choice);
+    vector<unordered_map<string, int>> valueIndex(facets.size());
+    for (Facet& facet : facets) {
+        facet.values.clear();
+        facet.commodities.clear();
+    }
+    for (uint32_t i = 0; i < (uint32_t) commodities.size(); i++) {
+        fill(collector.found.begin(), collector.found.end(), string());
+        commodities[i]->visitFields(collector);
+        for (size_t f = 0; f < facets.size(); f++) {
+            const string& value = collector.found[f];
+            if (value.empty()) continue;
+            auto found = valueIndex[f].find(value);
+            if (found == valueIndex[f].end()) {
+                found = valueIndex[f].emplace(value, (int) facets[f].values.size()).first;
+                facets[f].values.push_back(value);
+                facets[f].commodities.emplace_back();
+            }
+            // The commodities come in index order, so every add is an append
+            facets[f].commodities[found->second].add(i);
+        }
+    }
+
+    // The values are shown in order, the bitmaps move with them
+    for (size_t f = 0; f < facets.size(); f++) {
+        Facet& facet = facets[f];
+        vector<int> order(facet.values.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = (int) i;
+        bool numeric = collector.numeric[f] != 0;
+        sort(order.begin(), order.end(), [&facet, numeric](int a, int b) {
+            return numeric ? numberBefore(facet.values[a], facet.values[b]) : facet.values[a] < facet.values[b];
+        });
+        Facet sorted = {facet.key, vector<string>(), vector<RoaringBitmap>()};
+        for (int index : order) {
+            sorted.values.push_back(move(facet.values[index]));
+            sorted.commodities.push_back(move(facet.commodities[index]));
+        }
+        facet = move(sorted);
+    }
+
+    everything.fill((uint32_t) commodities.size());
+    built = true;
+    builtChanges = list.changeCount();
+}
+
+bool FacetIndex::matchOthers(const vector<vector<int>>& picks, int skip, RoaringBitmap& out) {
+    bool filtered = false;
+    for (int f = 0; f < (int) facets.size() && f < (int) picks.size(); f++) {
+        if (f == skip || picks[f].empty()) continue;
+        if (!filtered) {
+            out = picked[f];
+            filtered = true;
+        } else {
+            RoaringBitmap::intersect(out, picked[f], scratch);
+            swap(out, scratch);
+        }
+    }
+    return filtered;
+}
+
+void FacetIndex::count(const vector<vector<int>>& picks, vector<vector<long long>>& counts, RoaringBitmap* matches) {
+    // A facet matches one of its picked values
+    picked.resize(facets.size());
+    for (int f = 0; f < (int) facets.size() && f < (int) picks.size(); f++) {
+        picked[f].clear();
+        for (int value : picks[f]) {
+            if (value < 0 || value >= (int) facets[f].values.size()) continue;
+            RoaringBitmap::unite(picked[f], facets[f].commodities[value], scratch);
+            swap(picked[f], scratch);
+        }
+    }
+
+    counts.resize(facets.size());
+    for (int f = 0; f < (int) facets.size(); f++) {
+        const vector<RoaringBitmap>& commodities = facets[f].commodities;
+        counts[f].resize(commodities.size());
+        bool filtered = matchOthers(picks, f, others);
+        // The filter is probed by every value of the facet
+        if (filtered && commodities.size() > 1) others.densify();
+        for (size_t v = 0; v < commodities.size(); v++) {
+            counts[f][v] = (long long) (filtered ? RoaringBitmap::intersectCount(commodities[v], others)
+                                                 : commodities[v].cardinality());
+        }
+    }
+    if (matches != nullptr && !matchOthers(picks, -1, *matches)) *matches = everything;
+}
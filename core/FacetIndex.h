@@ -0,0 +1,108 @@
+#ifndef STORE_CORE_FACET_INDEX_H
+#define STORE_CORE_FACET_INDEX_H
+
+#include <string>
+#include <vector>
+
+#include "CommodityList.h"
+#include "RoaringBitmap.h"
+
+/*
+ * FacetIndex count the commodities of one category by the values of their attributes, e.g. how many laptops have
+ * 32 GB of memory, among the laptops which run Windows 10.
+ * A facet is one attribute, by its Commodity::visitFields key. Every value of a facet has a RoaringBitmap of the
+ * commodities having it, by their index inside the category of a pinned version of the list. A filter picks some
+ * values of some facets: a commodity matches when it has one of the picked values of every facet with a pick. The
+ * count of a value is the number of commodities with that value which match the picks of the other facets, so a
+ * shopper sees how many commodities each change of the filter would give. The counts are intersections of bitmaps,
+ * and none of them walks the commodities.
+ * A value is not indexed when it is empty or 0, which is what an attribute nobody filled in holds. A yes or no
+ * attribute, InputPrompt::CHOICE, is shown as "yes" and "no".
+ * The version is only pinned from update() to release(), so an index nobody looks at does not keep the removed
+ * commodities alive. The bitmaps stay, and while the list does not change they are used again with a new pin.
+ * The object is used by the thread which owns the list.
+ */
+class FacetIndex {
+public:
+    /*
+     * The values of one attribute, in increasing order, with the commodities having each of them.
+     */
+    struct Facet {
+        std::string key;
+        std::vector<std::string> values;
+        std::vector<RoaringBitmap> commodities;
+    };
+
+    /*
+     * The index of a category over the attributes the store lets the shoppers filter by, see defaultKeys.
+     */
+    explicit FacetIndex(int category);
+
+    FacetIndex(int category, std::vector<std::string> keys);
+
+    /*
+     * Return the attributes the store filters a category by, nothing for a category it does not know.
+     */
+    static std::vector<std::string> defaultKeys(int category);
+
+    /*
+     * Build the bitmaps against the current list and pin it. They are built again when the list gained or lost a
+     * commodity since the last update, otherwise only the version is pinned again if release() dropped it.
+     * INPUT: The list
+     * OUTPUT: None
+     */
+    void update(CommodityList& list);
+
+    /*
+     * Drop the pinned version once the matches are shown, get() may not be called until the next update().
+     */
+    void release() {
+        version.reset();
+    }
+
+    int facetCount() const {
+        return (int) facets.size();
+    }
+
+    const Facet& getFacet(int index) const {
+        return facets[index];
+    }
+
+    /*
+     * Return the commodity with an index of the bitmaps, from the version the index was built from.
+     */
+    Commodity* get(uint32_t index) const {
+        return version->getCategory(category)[index];
+    }
+
+    /*
+     * Count the values of every facet under a filter.
+     * INPUT: The picked value indexes of every facet, an empty vector when the facet is not filtered, the vector to
+     * receive the count of every value of every facet, and the bitmap to receive the commodities which match the
+     * whole filter (option)
+     * OUTPUT: None
+     */
+    void count(const std::vector<std::vector<int>>& picks, std::vector<std::vector<long long>>& counts,
+               RoaringBitmap* matches = nullptr);
+
+private:
+    int category;
+    std::vector<Facet> facets;
+    CommodityList::Pin version;
+    bool built = false;
+    long long builtChanges = 0;
+
+    // The union of the picks of every facet, and the scratch bitmaps of count()
+    std::vector<RoaringBitmap> picked;
+    RoaringBitmap everything;
+    RoaringBitmap others;
+    RoaringBitmap scratch;
+
+    /*
+     * Put into out the commodities matching the picks of every facet but skip, -1 to skip none.
+     * RETURN: Bool. False if none of those facets has a pick, every commodity matches and out is unchanged then
+     */
+    bool matchOthers(const std::vector<std::vector<int>>& picks, int skip, RoaringBitmap& out);
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "Json.h"
+
+#include <cctype>
+
+using namespace std;
+
+void Json::appendString(string& out, const string& text) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\t') {
+            out += "\\t";
+        } else if (c == '\r') {
+            out += "\\r";
+        } else if ((unsigned char) c < 0x20) {
+            char escaped[6] = {'\\', 'u', '0', '0', hex[(c >> 4) & 0xF], hex[c & 0xF]};
+            out.append(escaped, 6);
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+bool Json::parseString(const char*& p, const char* end, string& out) {
+    out.clear();
+    p++;
+    while (p < end && *p != '"') {
+        if (*p == '\\') {
+            if (++p >= end) return false;
+            switch (*p) {
+                case 'n': out.push_back('\n'); break;
+                case 't': out.push_back('\t'); break;
+                case 'r': out.push_back('\r'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'u': {
+                    if (end - p < 5) return false;
+                    unsigned code = 0;
+                    for (int i = 1; i <= 4; i++) {
+                        if (!isxdigit((unsigned char) p[i])) return false;
+                        code = code * 16 + (isdigit((unsigned char) p[i]) ? p[i] - '0' : (tolower(p[i]) - 'a' + 10));
+                    }
+                    // Encode the code point as UTF-8, surrogate pairs are not combined
+                    if (code < 0x80) {
+                        out.push_back((char) code);
+                    } else if (code < 0x800) {
+                        out.push_back((char) (0xC0 | (code >> 6)));
+                        out.push_back((char) (0x80 | (code & 0x3F)));
+                    } else {
+                        out.push_back((char) (0xE0 | (code >> 12)));
+                        out.push_back((char) (0x80 | ((code >> 6) & 0x3F)));
+                        out.push_back((char) (0x80 | (code & 0x3F)));
+                    }
+                    p += 4;
+                    break;
+                }
+                default: out.push_back(*p);
+            }
+        } else {
+            out.push_back(*p);
+        }
+        p++;
+    }
+    if (p >= end) return false;
+    p++;
+    return true;
+}
+
+bool Json::parseObject(const char* p, const char* end, vector<pair<string, string>>& fields) {
+    fields.clear();
+    auto skipSpace = [&]() { while (p < end && isspace((unsigned char) *p)) p++; };
+    skipSpace();
+    if (p >= end || *p != '{') return false;
+    p++;
+    skipSpace();
+    if (p < end && *p == '}') return true;
+    while (p < end) {
+        pair<string, string> field;
+        skipSpace();
+        if (p >= end || *p != '"' || !parseString(p, end, field.first)) return false;
+        skipSpace();
+        if (p >= end || *p != ':') return false;
+        p++;
+        skipSpace();
+        if (p >= end) return false;
+        if (*p == '"') {
+            if (!parseString(p, end, field.second)) return false;
+        } else {
+            const char* start = p;
+            while (p < end && *p != ',' && *p != '}' && !isspace((unsigned char) *p)) p++;
+            field.second.assign(start, p);
+            if (field.second.empty() || field.second == "null") field.second.clear();
+        }
+        fields.push_back(field);
+        skipSpace();
+        if (p < end && *p == ',') {
+            p++;
+        } else if (p < end && *p == '}') {
+            return true;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,34 @@
+#ifndef STORE_CORE_JSON_H
+#define STORE_CORE_JSON_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Json holds the small pieces of JSON the store reads and writes. Only flat objects are supported, which is what the
+ * catalog feeds and the HTTP requests use.
+ */
+class Json {
+public:
+    /*
+     * Append text as a quoted JSON string, the quotes, backslashes and control characters are escaped.
+     * INPUT: The string to append to, and the text
+     * OUTPUT: None
+     */
+    static void appendString(std::string& out, const std::string& text);
+
+    /*
+     * Parse a JSON string starting at the opening '"', p is moved after the closing '"'.
+     * OUTPUT: Bool. False if the string is not closed or has a bad escape
+     */
+    static bool parseString(const char*& p, const char* end, std::string& out);
+
+    /*
+     * Parse a flat JSON object into key and value pairs. Numbers, true, false and null are kept in their text form.
+     * OUTPUT: Bool. False if the text is not a flat JSON object
+     */
+    static bool parseObject(const char* p, const char* end, std::vector<std::pair<std::string, std::string>>& fields);
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+uint64_t LatencyHistogram::valueOf(int bucket) {
+    if (bucket < SUB_BUCKETS) return (uint64_t) bucket;
+    int shift = bucket / SUB_BUCKETS - 1;
+    uint64_t lowest = (uint64_t) (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lowest + ((1ULL << shift) >> 1);
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    for (atomic<uint64_t>& count : counts) count.store(0, memory_order_relaxed);
+    total.store(0, memory_order_relaxed);
+    sum.store(0, memory_order_relaxed);
+    maximum.store(0, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::mean() {
+    uint64_t n = count();
+    return n == 0 ? 0 : sum.load(memory_order_relaxed) / n;
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) {
+    uint64_t n = count();
+    if (n == 0) return 0;
+    uint64_t rank = (uint64_t) (fraction * (double) n + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += counts[i].load(memory_order_relaxed);
+        if (seen >= rank) return min(valueOf(i), max());
+    }
+    return max();
+}
+
+StoreMetrics& StoreMetrics::instance() {
+    static StoreMetrics metrics;
+    return metrics;
+}
+
+void StoreMetrics::dump(ostream& out, bool json) {
+    static const char* const stateNames[STATE_COUNT] = {
+            "OPENING", "DECIDING", "SHOPPING", "BROWSING", "CART_CHECKING", "CHECK_OUT", "MANAGING", "CLOSE"};
+    static const char* const operationNames[OPERATION_COUNT] = {
+            "load", "save", "chooseCommodity", "checkOut", "commodityInput", "import", "export", "checkpointSnapshot",
+            "checkpoint", "compact"};
+
+    if (json) {
+        out << "{\"states\":{";
+        dumpJSON(out, stateNames, states, STATE_COUNT);
+        out << "},\"operations\":{";
+        dumpJSON(out, operationNames, operations, OPERATION_COUNT);
+        out << "}}" << endl;
+    } else {
+        out << "name                 count     mean(us)  p50(us)   p90(us)   p99(us)   max(us)" << endl;
+        dumpText(out, stateNames, states, STATE_COUNT);
+        dumpText(out, operationNames, operations, OPERATION_COUNT);
+    }
+}
+
+void StoreMetrics::dumpText(ostream& out, const char* const names[], LatencyHistogram histograms[], int size) {
+    char line[160];
+    for (int i = 0; i < size; i++) {
+        LatencyHistogram& histogram = histograms[i];
+        if (histogram.count() == 0) continue;
+        snprintf(line, sizeof(line), "%-20s %-9llu %-9.1f %-9.1f %-9.1f %-9.1f %.1f", names[i],
+                 (unsigned long long) histogram.count(), micro(histogram.mean()), micro(histogram.percentile(0.5)),
+                 micro(histogram.percentile(0.9)), micro(histogram.percentile(0.99)), micro(histogram.max()));
+        out << line << endl;
+    }
+}
+
+void StoreMetrics::dumpJSON(ostream& out, const char* const names[], LatencyHistogram histograms[], int size) {
+    bool first = true;
+    for (int i = 0; i < size; i++) {
+        LatencyHistogram& histogram = histograms[i];
+        if (histogram.count() == 0) continue;
+        out << (first ? "" : ",") << '"' << names[i] << "\":{\"count\":" << histogram.count()
+            << ",\"mean_us\":" << micro(histogram.mean()) << ",\"p50_us\":" << micro(histogram.percentile(0.5))
+            << ",\"p90_us\":" << micro(histogram.percentile(0.9)) << ",\"p99_us\":"
+            << micro(histogram.percentile(0.99)) << ",\"max_us\":" << micro(histogram.max()) << '}';
+        first = false;
+    }
+}
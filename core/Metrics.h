@@ -0,0 +1,159 @@
+#ifndef STORE_CORE_METRICS_H
+#define STORE_CORE_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/*
+ * LatencyHistogram count latencies in nanoseconds with a fixed relative precision, in the way of HDR histograms.
+ * Every power of two is split into 16 linear sub buckets, so a recorded value is kept within 1/16 of its size and
+ * the whole range of uint64_t fits in less than a thousand counters. Recording is a few instructions and lock free.
+ */
+class LatencyHistogram {
+private:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    std::atomic<uint64_t> counts[BUCKETS];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> maximum;
+
+    static int highestBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - __builtin_clzll(value);
+#else
+        int bit = 0;
+        while (value >>= 1) bit++;
+        return bit;
+#endif
+    }
+
+    static int bucketOf(uint64_t value) {
+        if (value < (uint64_t) SUB_BUCKETS) return (int) value;
+        int shift = highestBit(value) - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + (int) ((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    /*
+     * The middle of the values kept by a bucket
+     */
+    static uint64_t valueOf(int bucket);
+
+public:
+    LatencyHistogram();
+
+    void reset();
+
+    void record(uint64_t nanoseconds) {
+        counts[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+        uint64_t current = maximum.load(std::memory_order_relaxed);
+        while (nanoseconds > current &&
+               !maximum.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t count() {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    uint64_t mean();
+
+    uint64_t max() {
+        return maximum.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * Return the latency below which the given fraction of the records are, e.g. 0.99 for p99.
+     */
+    uint64_t percentile(double fraction);
+};
+
+/*
+ * StoreMetrics keep a LatencyHistogram for every Store state and for the expensive operations.
+ * The instrumentation is only compiled when STORE_METRICS is defined (cmake -DSTORE_METRICS=ON). Otherwise the
+ * STORE_TIMED macros below are empty and the store pays nothing for it.
+ */
+class StoreMetrics {
+public:
+    enum Operation {LOAD, SAVE, CHOOSE_COMMODITY, CHECK_OUT, COMMODITY_INPUT, IMPORT, EXPORT, CHECKPOINT_SNAPSHOT,
+                    CHECKPOINT, COMPACT, OPERATION_COUNT};
+
+    /*
+     * The states must be in the same order as Store::SMode, which asserts it has STATE_COUNT of them
+     */
+    static const int STATE_COUNT = 8;
+
+    static StoreMetrics& instance();
+
+    static bool enabled() {
+#ifdef STORE_METRICS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    LatencyHistogram& operation(Operation operation) {
+        return operations[operation];
+    }
+
+    LatencyHistogram& state(int state) {
+        return states[state];
+    }
+
+    /*
+     * Record the time from its construction to its destruction into a histogram.
+     */
+    class ScopedTimer {
+    private:
+        LatencyHistogram& histogram;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit ScopedTimer(LatencyHistogram& histogram)
+                : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+
+        ~ScopedTimer() {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            histogram.record((uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    };
+
+    /*
+     * Write every histogram which has records, the latencies are in microseconds.
+     * INPUT: The output stream, and whether to write JSON instead of a text table
+     * OUTPUT: None
+     */
+    void dump(std::ostream& out, bool json);
+
+private:
+    LatencyHistogram states[STATE_COUNT];
+    LatencyHistogram operations[OPERATION_COUNT];
+
+    StoreMetrics() = default;
+
+    static double micro(uint64_t nanoseconds) {
+        return nanoseconds / 1000.0;
+    }
+
+    static void dumpText(std::ostream& out, const char* const names[], LatencyHistogram histograms[], int size);
+
+    static void dumpJSON(std::ostream& out, const char* const names[], LatencyHistogram histograms[], int size);
+};
+
+#ifdef STORE_METRICS
+#define STORE_TIMED(name) \
+    StoreMetrics::ScopedTimer storeTimer(StoreMetrics::instance().operation(StoreMetrics::name))
+#define STORE_TIMED_STATE(value) \
+    StoreMetrics::ScopedTimer storeStateTimer(StoreMetrics::instance().state((int) (value)))
+#else
+#define STORE_TIMED(name) ((void) 0)
+#define STORE_TIMED_STATE(value) ((void) 0)
+#endif
+
+#endif
@@ -0,0 +1,312 @@
+#include "PriceHistory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+
+#include "AtomicFile.h"
+#include "Varint.h"
+
+using namespace std;
+
+namespace {
+
+    // The first files had no generation, they load as generation 0
+    const char MAGIC[] = "PRICEHISTORY2\n";
+    const char FIRST_MAGIC[] = "PRICEHISTORY1\n";
+    const size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+    const char JOURNAL_MAGIC[] = "PRICELOG1\n";
+    const size_t JOURNAL_MAGIC_SIZE = sizeof(JOURNAL_MAGIC) - 1;
+    // The magic and the generation
+    const size_t JOURNAL_HEADER_SIZE = JOURNAL_MAGIC_SIZE + 8;
+    const size_t RECORD_HEADER_SIZE = 8;
+    const uint32_t MAX_PAYLOAD = 64;
+    // The journal is not folded before it has this many points
+    const long long MIN_JOURNAL_POINTS = 4096;
+}
+
+const char* const PriceHistory::DEFAULT_FILE = "PriceHistory.db";
+
+PriceHistory::~PriceHistory() {
+    if (journal != nullptr) fclose(journal);
+}
+
+bool PriceHistory::decode(const Block& block, vector<pair<long long, int>>& points) {
+    points.clear();
+    points.emplace_back(block.firstTime, block.firstPrice);
+    const char* time = block.times.data();
+    const char* timeEnd = time + block.times.size();
+    const char* price = block.prices.data();
+    const char* priceEnd = price + block.prices.size();
+    for (int i = 1; i < block.count; i++) {
+        uint64_t timeDelta;
+        long long priceDelta;
+        if (!Varint::get(time, timeEnd, timeDelta) || !Varint::getSigned(price, priceEnd, priceDelta)) return false;
+        points.emplace_back(points.back().first + (long long) timeDelta, (int) (points.back().second + priceDelta));
+    }
+    return time == timeEnd && price == priceEnd;
+}
+
+int PriceHistory::findBlock(const vector<Block>& blocks, long long time) {
+    auto after = upper_bound(blocks.begin(), blocks.end(), time,
+                             [](long long value, const Block& block) { return value < block.firstTime; });
+    return (int) (after - blocks.begin()) - 1;
+}
+
+void PriceHistory::record(uint64_t id, long long time, int price) {
+    vector<Block>& blocks = series[id];
+    if (!blocks.empty()) {
+        Block& last = blocks.back();
+        if (price == last.lastPrice) return;
+        time = max(time, last.lastTime);
+        if (last.count < BLOCK_POINTS) {
+            Varint::put(last.times, (uint64_t) (time - last.lastTime));
+            Varint::putSigned(last.prices, (long long) price - last.lastPrice);
+            last.lastTime = time;
+            last.lastPrice = price;
+            last.lowest = min(last.lowest, price);
+            last.highest = max(last.highest, price);
+            last.count++;
+            return;
+        }
+    }
+    blocks.push_back({time, time, price, price, price, price, 1, string(), string()});
+}
+
+int PriceHistory::points(uint64_t id) {
+    auto found = series.find(id);
+    if (found == series.end()) return 0;
+    int count = 0;
+    for (const Block& block : found->second) count += block.count;
+    return count;
+}
+
+bool PriceHistory::priceAt(uint64_t id, long long time, int& price) {
+    auto found = series.find(id);
+    if (found == series.end()) return false;
+    int index = findBlock(found->second, time);
+    if (index < 0) return false;
+    const Block& block = found->second[index];
+    if (time >= block.lastTime) {
+        price = block.lastPrice;
+        return true;
+    }
+    decode(block, scratch);
+    for (const pair<long long, int>& point : scratch) {
+        if (point.first > time) break;
+        price = point.second;
+    }
+    return true;
+}
+
+bool PriceHistory::range(uint64_t id, long long from, long long to, int& lowest, int& highest) {
+    auto found = series.find(id);
+    if (found == series.end() || from > to) return false;
+    const vector<Block>& blocks = found->second;
+    bool any = false;
+    vector<pair<long long, int>>& points = scratch;
+    auto take = [&](int low, int high) {
+        lowest = any ? min(lowest, low) : low;
+        highest = any ? max(highest, high) : high;
+        any = true;
+    };
+    // The block holding the price in effect at from, or the first block when the history starts later
+    for (int i = max(findBlock(blocks, from), 0); i < (int) blocks.size() && blocks[i].firstTime <= to; i++) {
+        const Block& block = blocks[i];
+        if (block.firstTime > from && block.lastTime <= to) {
+            take(block.lowest, block.highest);
+            continue;
+        }
+        decode(block, points);
+        for (size_t j = 0; j < points.size() && points[j].first <= to; j++) {
+            // A price is in effect until the next point, the last point of the history stays in effect
+            long long until = j + 1 < points.size() ? points[j + 1].first
+                              : i + 1 < (int) blocks.size() ? blocks[i + 1].firstTime : to + 1;
+            if (until > from) take(points[j].second, points[j].second);
+        }
+    }
+    return any;
+}
+
+bool PriceHistory::open(const string& fileName) {
+    this->fileName = fileName;
+    bool intact = load(fileName) || !ifstream(fileName).good();
+    if (!intact) {
+        series.clear();
+        generation = 0;
+    }
+    // A damaged file is written anew, so is a journal which can not be appended to
+    if (intact && replay(fileName + ".log")) {
+        journal = fopen((fileName + ".log").c_str(), "ab");
+        if (journal != nullptr) return true;
+    }
+    checkpoint();
+    return intact;
+}
+
+bool PriceHistory::replay(const string& journalName) {
+    FILE* file = fopen(journalName.c_str(), "rb");
+    if (file == nullptr) return false;
+    char header[JOURNAL_HEADER_SIZE] = {};
+    bool valid = fread(header, 1, JOURNAL_HEADER_SIZE, file) == JOURNAL_HEADER_SIZE &&
+                 memcmp(header, JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE) == 0;
+    uint64_t journalGeneration = (uint64_t) Varint::getFixed32(header + JOURNAL_MAGIC_SIZE + 4) << 32 |
+                                 Varint::getFixed32(header + JOURNAL_MAGIC_SIZE);
+    valid = valid && journalGeneration == generation;
+    journalPoints = 0;
+    char frame[RECORD_HEADER_SIZE + MAX_PAYLOAD];
+    while (valid) {
+        size_t got = fread(frame, 1, RECORD_HEADER_SIZE, file);
+        if (got == 0) break;
+        uint32_t size = got == RECORD_HEADER_SIZE ? Varint::getFixed32(frame + 4) : 0;
+        valid = size != 0 && size <= MAX_PAYLOAD && fread(frame + RECORD_HEADER_SIZE, 1, size, file) == size &&
+                Crc32c::update(0, frame + 4, 4 + size) == Varint::getFixed32(frame);
+        const char* in = frame + RECORD_HEADER_SIZE;
+        const char* end = in + size;
+        uint64_t id;
+        long long time;
+        long long price;
+        valid = valid && Varint::get(in, end, id) && Varint::getSigned(in, end, time) &&
+                Varint::getSigned(in, end, price) && in == end;
+        if (!valid) break;
+        record(id, time, (int) price);
+        journalPoints++;
+    }
+    fclose(file);
+    return valid;
+}
+
+bool PriceHistory::startJournal() {
+    if (journal != nullptr) fclose(journal);
+    journal = fopen((fileName + ".log").c_str(), "wb");
+    if (journal == nullptr) return false;
+    char header[JOURNAL_HEADER_SIZE];
+    memcpy(header, JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE);
+    Varint::putFixed32(header + JOURNAL_MAGIC_SIZE, (uint32_t) generation);
+    Varint::putFixed32(header + JOURNAL_MAGIC_SIZE + 4, (uint32_t) (generation >> 32));
+    journalPoints = 0;
+    return fwrite(header, 1, JOURNAL_HEADER_SIZE, journal) == JOURNAL_HEADER_SIZE && fflush(journal) == 0;
+}
+
+bool PriceHistory::append(uint64_t id, long long time, int price) {
+    auto found = series.find(id);
+    // The same price adds no point, so it is not written either
+    if (found != series.end() && found->second.back().lastPrice == price) return true;
+    record(id, time, price);
+    if (journal == nullptr) return false;
+
+    char frame[RECORD_HEADER_SIZE + MAX_PAYLOAD];
+    string payload;
+    Varint::put(payload, id);
+    Varint::putSigned(payload, time);
+    Varint::putSigned(payload, price);
+    memcpy(frame + RECORD_HEADER_SIZE, payload.data(), payload.size());
+    Varint::putFixed32(frame + 4, (uint32_t) payload.size());
+    Varint::putFixed32(frame, Crc32c::update(0, frame + 4, 4 + payload.size()));
+    size_t size = RECORD_HEADER_SIZE + payload.size();
+    if (fwrite(frame, 1, size, journal) != size || fflush(journal) != 0) return false;
+    if (++journalPoints < max(MIN_JOURNAL_POINTS, filePoints)) return true;
+    return checkpoint();
+}
+
+bool PriceHistory::checkpoint() {
+    // The journal stays valid for the previous file until the new one replaces it
+    generation++;
+    if (!save(fileName)) {
+        generation--;
+        return false;
+    }
+    return startJournal();
+}
+
+bool PriceHistory::save(const string& fileName) {
+    string data(MAGIC, MAGIC_SIZE);
+    Varint::put(data, generation);
+    Varint::put(data, series.size());
+    long long points = 0;
+    for (const pair<const uint64_t, vector<Block>>& entry : series) {
+        Varint::put(data, entry.first);
+        Varint::put(data, entry.second.size());
+        for (const Block& block : entry.second) {
+            Varint::putSigned(data, block.firstTime);
+            Varint::putSigned(data, block.firstPrice);
+            Varint::put(data, (uint64_t) block.count);
+            points += block.count;
+            Varint::put(data, block.times.size());
+            Varint::put(data, block.prices.size());
+            data += block.times;
+            data += block.prices;
+        }
+    }
+
+    AtomicFileWriter writer(fileName);
+    if (!writer.isOpen()) return false;
+    ostream out(&writer);
+    out.write(data.data(), (streamsize) data.size());
+    if (!out.good() || !writer.commit()) return false;
+    filePoints = points;
+    return true;
+}
+
+bool PriceHistory::load(const string& fileName) {
+    ifstream file(fileName, ios::binary);
+    if (!file) return false;
+    string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    size_t trailerSize = AtomicFileWriter::trailer(0).size();
+    if (data.size() < MAGIC_SIZE + trailerSize) return false;
+    bool first = data.compare(0, MAGIC_SIZE, FIRST_MAGIC) == 0;
+    if (!first && data.compare(0, MAGIC_SIZE, MAGIC) != 0) return false;
+    size_t size = data.size() - trailerSize;
+    if (data.compare(size, trailerSize, AtomicFileWriter::trailer(Crc32c::update(0, data.data(), size))) != 0) {
+        return false;
+    }
+
+    unordered_map<uint64_t, vector<Block>> loaded;
+    const char* in = data.data() + MAGIC_SIZE;
+    const char* end = data.data() + size;
+    vector<pair<long long, int>> points;
+    uint64_t fileGeneration = 0;
+    uint64_t commodities;
+    if ((!first && !Varint::get(in, end, fileGeneration)) || !Varint::get(in, end, commodities)) return false;
+    long long pointCount = 0;
+    for (uint64_t i = 0; i < commodities; i++) {
+        uint64_t id;
+        uint64_t blockCount;
+        if (!Varint::get(in, end, id) || !Varint::get(in, end, blockCount)) return false;
+        vector<Block>& blocks = loaded[id];
+        for (uint64_t j = 0; j < blockCount; j++) {
+            long long firstTime;
+            long long firstPrice;
+            uint64_t count;
+            uint64_t timesSize;
+            uint64_t pricesSize;
+            if (!Varint::getSigned(in, end, firstTime) || !Varint::getSigned(in, end, firstPrice) ||
+                !Varint::get(in, end, count) || !Varint::get(in, end, timesSize) ||
+                !Varint::get(in, end, pricesSize) || count == 0 || count > BLOCK_POINTS ||
+                timesSize + pricesSize > (uint64_t) (end - in)) {
+                return false;
+            }
+            Block block = {firstTime, firstTime, (int) firstPrice, (int) firstPrice, (int) firstPrice,
+                           (int) firstPrice, (int) count, string(in, timesSize), string(in + timesSize, pricesSize)};
+            in += timesSize + pricesSize;
+            // The summary is not in the file, it comes from the points
+            if (!decode(block, points)) return false;
+            for (const pair<long long, int>& point : points) {
+                block.lowest = min(block.lowest, point.second);
+                block.highest = max(block.highest, point.second);
+            }
+            block.lastTime = points.back().first;
+            block.lastPrice = points.back().second;
+            pointCount += block.count;
+            blocks.push_back(move(block));
+        }
+    }
+    if (in != end) return false;
+    series.swap(loaded);
+    generation = fileGeneration;
+    filePoints = pointCount;
+    return true;
+}
@@ -0,0 +1,160 @@
+#ifndef STORE_CORE_PRICE_HISTORY_H
+#define STORE_CORE_PRICE_HISTORY_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * PriceHistory keep every price a commodity had, by commodity id, so the price at a time or the lowest and highest
+ * price over a period are answered without reading a log.
+ * The points of a commodity are kept in blocks of BLOCK_POINTS. A block keeps its first time and price as they are,
+ * and the rest as deltas in two byte columns, one for the times and one for the prices, so a point takes two or three
+ * bytes. Every block also keeps its last time and price and its lowest and highest price: priceAt() finds its block
+ * by a binary search and decodes only that one, and range() takes the blocks inside the period from their summary and
+ * decodes at most the two at its ends.
+ * A price is in effect from the time of its point until the next point. Times are seconds since the epoch, and the
+ * price a commodity had before its first change is kept at time 0.
+ * The file is the same blocks, commodity by commodity, written through AtomicFileWriter. A change is not written
+ * into it: append() adds the point to the journal "<fileName>.log", a record of u32 CRC32C of the rest of the
+ * record, u32 payload length, and the id, time and price as varints, so a change costs one small write whatever the
+ * size of the history. The journal is folded into the file by checkpoint(), on its own once it holds as many points
+ * as the file. Both start with the same generation, which checkpoint() raises, so a journal already folded into the
+ * file is never read again.
+ * The object is used by the thread which owns the list.
+ */
+class PriceHistory {
+private:
+    static const int BLOCK_POINTS = 64;
+
+    struct Block {
+        long long firstTime;
+        long long lastTime;
+        int firstPrice;
+        int lastPrice;
+        int lowest;
+        int highest;
+        int count;
+        // The deltas of the points after the first one
+        std::string times;
+        std::string prices;
+    };
+
+    std::unordered_map<uint64_t, std::vector<Block>> series;
+    // The points of the block decoded last, reused by every query
+    std::vector<std::pair<long long, int>> scratch;
+
+    // The file given to open(), its journal, and the generation they start with
+    std::string fileName;
+    FILE* journal = nullptr;
+    uint64_t generation = 0;
+    // The points inside the file and inside the journal, the journal is folded when it catches up
+    long long filePoints = 0;
+    long long journalPoints = 0;
+
+    /*
+     * Replay the journal of the file, the points are recorded in memory.
+     * OUTPUT: Bool. False if the journal is missing, belongs to another generation or ends with a torn record
+     */
+    bool replay(const std::string& journalName);
+
+    /*
+     * Start an empty journal for the current generation.
+     */
+    bool startJournal();
+
+    /*
+     * Append the points of a block to points, the vector is cleared first.
+     * OUTPUT: Bool. False if the columns do not hold count points
+     */
+    static bool decode(const Block& block, std::vector<std::pair<long long, int>>& points);
+
+    /*
+     * Return the index of the last block starting at or before time, or -1.
+     */
+    static int findBlock(const std::vector<Block>& blocks, long long time);
+
+public:
+    // The file the console store keeps the history in, beside the catalog files
+    static const char* const DEFAULT_FILE;
+
+    PriceHistory() = default;
+
+    ~PriceHistory();
+
+    PriceHistory(const PriceHistory&) = delete;
+    PriceHistory& operator=(const PriceHistory&) = delete;
+
+    /*
+     * Add a point, a time before the last point of the commodity is taken as the time of that point.
+     * A price equal to the last one adds nothing.
+     * INPUT: The commodity id, the time, and the price from that time on
+     * OUTPUT: None
+     */
+    void record(uint64_t id, long long time, int price);
+
+    /*
+     * Whether a commodity has any point.
+     */
+    bool has(uint64_t id) {
+        return series.count(id) != 0;
+    }
+
+    /*
+     * Return the number of points of a commodity.
+     */
+    int points(uint64_t id);
+
+    /*
+     * Find the price in effect at a time.
+     * INPUT: The commodity id, the time, and the integer to receive the price
+     * OUTPUT: Bool. False if the commodity has no point at or before that time
+     */
+    bool priceAt(uint64_t id, long long time, int& price);
+
+    /*
+     * Find the lowest and the highest price in effect at any moment from one time to another, both included.
+     * INPUT: The commodity id, the period, and the integers to receive the prices
+     * OUTPUT: Bool. False if no price of the commodity is in effect during the period
+     */
+    bool range(uint64_t id, long long from, long long to, int& lowest, int& highest);
+
+    /*
+     * Read a file and its journal, and keep the journal open for append(). A journal which is torn or left from an
+     * earlier generation is dropped by a checkpoint().
+     * INPUT: The file name
+     * OUTPUT: Bool. False if the file exists but is damaged, the history starts again and the file is written anew
+     */
+    bool open(const std::string& fileName);
+
+    /*
+     * Record a point, and append it to the journal of the file given to open().
+     * INPUT: The commodity id, the time, and the price from that time on
+     * OUTPUT: Bool. False if the point can not be written, it is still recorded in memory
+     */
+    bool append(uint64_t id, long long time, int price);
+
+    /*
+     * Write every point into the file given to open() and start an empty journal.
+     * OUTPUT: Bool. False if the file can not be written, the previous file and the journal are kept
+     */
+    bool checkpoint();
+
+    /*
+     * Write every block into a file, it is replaced by AtomicFileWriter.
+     * OUTPUT: Bool. False if the file can not be written, the previous one is kept
+     */
+    bool save(const std::string& fileName);
+
+    /*
+     * Read a file written by save(), the points in memory are replaced.
+     * OUTPUT: Bool. False if the file does not exist, or it does not match its checksum or its format. Nothing is
+     * loaded then
+     */
+    bool load(const std::string& fileName);
+};
+
+#endif
@@ -0,0 +1,182 @@
+#include "Promotions.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+#include "Json.h"
+
+using namespace std;
+
+namespace {
+
+    // A small positive count or percent, nothing else is accepted
+    bool toCount(const string& text, int& value) {
+        if (text.empty() || text.size() > 9) return false;
+        int result = 0;
+        for (char c : text) {
+            if (!isdigit((unsigned char) c)) return false;
+            result = result * 10 + (c - '0');
+        }
+        value = result;
+        return true;
+    }
+}
+
+const char* const Promotions::DEFAULT_FILE = "Promotions.jsonl";
+
+bool Promotions::load(const string& fileName, vector<string>* errors) {
+    ifstream file(fileName);
+    if (!file) return false;
+    rules.clear();
+    targets.clear();
+    compiled = false;
+
+    string line;
+    vector<pair<string, string>> fields;
+    for (int number = 1; getline(file, line); number++) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.find_first_not_of(" \t") == string::npos) continue;
+        fields.clear();
+        string error = Json::parseObject(line.data(), line.data() + line.size(), fields) ? add(fields)
+                                                                                         : "not a flat JSON object";
+        if (!error.empty() && errors != nullptr) errors->push_back("line " + to_string(number) + ": " + error);
+    }
+    return true;
+}
+
+string Promotions::add(const vector<pair<string, string>>& fields) {
+    Rule rule = {"", 0, (int) targets.size(), 0};
+    int quantity = 1;
+    string category;
+    string commodity;
+    string bundle;
+    for (const pair<string, string>& field : fields) {
+        if (field.first == "name") {
+            rule.name = field.second;
+        } else if (field.first == "category") {
+            category = field.second;
+        } else if (field.first == "commodity") {
+            commodity = field.second;
+        } else if (field.first == "bundle") {
+            bundle = field.second;
+        } else if (field.first == "quantity") {
+            if (!toCount(field.second, quantity) || quantity < 1) return "bad quantity " + field.second;
+        } else if (field.first == "percent") {
+            if (!toCount(field.second, rule.percent) || rule.percent < 1 || rule.percent > 100) {
+                return "bad percent " + field.second;
+            }
+        } else {
+            return "unknown field " + field.first;
+        }
+    }
+    if (rule.percent == 0) return "no percent";
+    if ((int) !category.empty() + (int) !commodity.empty() + (int) !bundle.empty() != 1) {
+        return "one of category, commodity or bundle is needed";
+    }
+
+    vector<Target> parts;
+    if (!category.empty()) {
+        int index = CategoryRegistry::find(category);
+        if (index < 0) return "unknown category " + category;
+        parts.push_back({index, "", quantity, (int) rules.size()});
+    } else if (!commodity.empty()) {
+        parts.push_back({-1, commodity, quantity, (int) rules.size()});
+    } else {
+        for (size_t begin = 0; begin <= bundle.size();) {
+            size_t end = min(bundle.find('+', begin), bundle.size());
+            string part = bundle.substr(begin, end - begin);
+            if (part.empty()) return "empty part in bundle " + bundle;
+            int index = CategoryRegistry::find(part);
+            parts.push_back({index, index < 0 ? part : "", quantity, (int) rules.size()});
+            begin = end + 1;
+        }
+    }
+    if (rule.name.empty()) rule.name = !category.empty() ? category : !commodity.empty() ? commodity : bundle;
+    rule.targetCount = (int) parts.size();
+    targets.insert(targets.end(), parts.begin(), parts.end());
+    rules.push_back(rule);
+    compiled = false;
+    return "";
+}
+
+void Promotions::compile(CommodityList& list) {
+    if (compiled && compiledChanges == list.changeCount()) return;
+    byCategory.assign(CategoryRegistry::size(), vector<int>());
+    byId.clear();
+    for (int i = 0; i < (int) targets.size(); i++) {
+        const Target& target = targets[i];
+        if (target.category >= 0) {
+            byCategory[target.category].push_back(i);
+            continue;
+        }
+        int category;
+        Commodity* commodity = list.find(target.commodity, category);
+        // A commodity which is not in the list yet is found by a later compile
+        if (commodity != nullptr) byId[commodity->getId()].push_back(i);
+    }
+    ruleStamp.assign(rules.size(), 0);
+    ruleActive.assign(rules.size(), 0);
+    ruleDiscount.assign(rules.size(), 0);
+    bought.assign(targets.size(), 0);
+    stamp = 0;
+    compiled = true;
+    compiledChanges = list.changeCount();
+}
+
+int Promotions::apply(vector<ShoppingCart::SoldLine>& lines, vector<pair<string, int>>* applied) {
+    for (ShoppingCart::SoldLine& line : lines) line.discount = 0;
+    if (!compiled || rules.empty()) return 0;
+    if (++stamp == 0) {
+        fill(ruleStamp.begin(), ruleStamp.end(), 0);
+        stamp = 1;
+    }
+
+    // Count the items bought of every target the checkout names
+    touched.clear();
+    for (const ShoppingCart::SoldLine& line : lines) {
+        forTargets(line, [&](int target) {
+            int rule = targets[target].rule;
+            if (ruleStamp[rule] != stamp) {
+                ruleStamp[rule] = stamp;
+                const Rule& touchedRule = rules[rule];
+                fill(bought.begin() + touchedRule.firstTarget,
+                     bought.begin() + touchedRule.firstTarget + touchedRule.targetCount, 0);
+                ruleDiscount[rule] = 0;
+                touched.push_back(rule);
+            }
+            bought[target] += line.quantity;
+        });
+    }
+
+    // A rule applies when every one of its targets is bought enough
+    for (int rule : touched) {
+        const Rule& touchedRule = rules[rule];
+        bool active = true;
+        for (int i = touchedRule.firstTarget; i < touchedRule.firstTarget + touchedRule.targetCount; i++) {
+            active = active && bought[i] >= targets[i].quantity;
+        }
+        ruleActive[rule] = active;
+    }
+
+    int total = 0;
+    for (ShoppingCart::SoldLine& line : lines) {
+        int best = -1;
+        forTargets(line, [&](int target) {
+            int rule = targets[target].rule;
+            if (ruleActive[rule] && (best < 0 || rules[rule].percent > rules[best].percent)) best = rule;
+        });
+        if (best < 0) continue;
+        line.discount = (int) ((long long) line.price * line.quantity * rules[best].percent / 100);
+        ruleDiscount[best] += line.discount;
+        total += line.discount;
+    }
+
+    if (applied != nullptr) {
+        applied->clear();
+        for (int rule : touched) {
+            if (ruleDiscount[rule] > 0) applied->emplace_back(rules[rule].name, ruleDiscount[rule]);
+        }
+    }
+    return total;
+}
@@ -0,0 +1,122 @@
+#ifndef STORE_CORE_PROMOTIONS_H
+#define STORE_CORE_PROMOTIONS_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CommodityList.h"
+#include "ShoppingCart.h"
+
+/*
+ * Promotions keep the discounts of the store and work out the discount of a checkout.
+ * The rules are read from a JSON Lines file, one flat object for every rule:
+ *  {"name": "Laptop week", "category": "Laptop", "percent": 5}
+ *  {"name": "Two sounds", "category": "Sound", "quantity": 2, "percent": 5}
+ *  {"name": "Three AirPods", "commodity": "AirPods Pro", "quantity": 3, "percent": 15}
+ *  {"name": "Phone and sound", "bundle": "Smartphone+Sound", "percent": 10}
+ * A rule has one or more targets, a category or a commodity by name, and it applies when the checkout buys at least
+ * quantity items (1 by default) of every target. The part of a bundle is a category when it is a category label, a
+ * commodity name otherwise. An applied rule takes percent off the lines of its targets. Rules do not add up, a line
+ * gets the largest percent of the rules applied to it, and a discount is rounded down to the dollar.
+ * compile() turns the rules into indexes from a category and from a commodity id to the targets naming them, so a
+ * checkout only visits its lines and the targets of its lines, not every rule.
+ * The object is used by one thread at a time.
+ */
+class Promotions {
+public:
+    // The file the front ends read the rules from, beside the catalog files
+    static const char* const DEFAULT_FILE;
+
+    /*
+     * Read the rules of a file, the rules in memory are replaced. A malformed line is skipped.
+     * INPUT: The file name, and the vector to receive why each skipped line is skipped (option)
+     * OUTPUT: Bool. False if the file can not be opened, nothing is changed then
+     */
+    bool load(const std::string& fileName, std::vector<std::string>* errors = nullptr);
+
+    /*
+     * Add a rule, see the file format above.
+     * INPUT: The fields of one rule
+     * OUTPUT: String. Why the rule is not added, empty when it is
+     */
+    std::string add(const std::vector<std::pair<std::string, std::string>>& fields);
+
+    /*
+     * Return the number of rules
+     */
+    size_t size() const {
+        return rules.size();
+    }
+
+    /*
+     * Build the indexes against the commodities of a list. The commodities are named in the rules and found by id at
+     * checkout, so the indexes are built again when the list gained or lost a commodity since the last compile,
+     * otherwise nothing is done.
+     * INPUT: The list
+     * OUTPUT: None
+     */
+    void compile(CommodityList& list);
+
+    /*
+     * Work out the discount of the lines of a checkout, the discount of every line is written into it.
+     * INPUT: The lines sold, see ShoppingCart::checkOut, and the vector to receive the name and the discount of
+     * every rule applied (option)
+     * OUTPUT: Integer. The discount of the whole checkout
+     */
+    int apply(std::vector<ShoppingCart::SoldLine>& lines, std::vector<std::pair<std::string, int>>* applied = nullptr);
+
+private:
+    /*
+     * A category or a commodity of a rule. A commodity is named until compile() finds its id.
+     */
+    struct Target {
+        int category;
+        std::string commodity;
+        int quantity;
+        int rule;
+    };
+
+    struct Rule {
+        std::string name;
+        int percent;
+        int firstTarget;
+        int targetCount;
+    };
+
+    std::vector<Rule> rules;
+    std::vector<Target> targets;
+    bool compiled = false;
+    long long compiledChanges = 0;
+
+    // The targets naming a category, and the targets naming a commodity id
+    std::vector<std::vector<int>> byCategory;
+    std::unordered_map<uint64_t, std::vector<int>> byId;
+
+    // The state of apply(), by rule and by target. A rule whose stamp is not the current one is not touched by the
+    // checkout, so nothing has to be cleared between two checkouts
+    unsigned stamp = 0;
+    std::vector<unsigned> ruleStamp;
+    std::vector<char> ruleActive;
+    std::vector<int> ruleDiscount;
+    std::vector<int> bought;
+    std::vector<int> touched;
+
+    /*
+     * Call f for every target naming the category or the commodity of a line.
+     */
+    template<typename F>
+    void forTargets(const ShoppingCart::SoldLine& line, F f) {
+        if (line.category < (int) byCategory.size()) {
+            for (int target : byCategory[line.category]) f(target);
+        }
+        auto found = byId.find(line.id);
+        if (found != byId.end()) {
+            for (int target : found->second) f(target);
+        }
+    }
+};
+
+#endif
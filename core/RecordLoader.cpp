@@ -0,0 +1,202 @@
+#include "RecordLoader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "AtomicFile.h"
+
+using namespace std;
+
+namespace {
+
+    const size_t MAX_BAD_RECORDS = 10;
+
+    /*
+     * A valid commodity waiting for the checksum, and the line where its record starts.
+     */
+    struct Staged {
+        Commodity* commodity;
+        long long line;
+    };
+
+    void skip(RecordLoader::Report& report, long long line, const string& reason) {
+        report.skipped++;
+        if (report.badRecords.size() < MAX_BAD_RECORDS) report.badRecords.push_back({line, reason});
+    }
+
+    /*
+     * Check whether the line is the marker of a record, and keep the attributes it carries.
+     * RETURN: Bool. True for "@<label>" alone or followed by " <key>=<value>" pairs, attributes receive the pairs
+     */
+    bool isMarker(const string& line, const string& marker, string& attributes) {
+        if (line.compare(0, marker.size(), marker) != 0) return false;
+        if (line.size() != marker.size() && line[marker.size()] != ' ') return false;
+        attributes.assign(line, marker.size(), string::npos);
+        return true;
+    }
+
+    /*
+     * Apply the attributes of a marker, the id and the stock. Unknown keys are skipped so newer files still load.
+     * RETURN: Bool. False if a value is not valid
+     */
+    bool applyAttributes(const string& attributes, Commodity* commodity) {
+        size_t start = 0;
+        while (start < attributes.size()) {
+            size_t end = attributes.find(' ', start + 1);
+            if (end == string::npos) end = attributes.size();
+            size_t equal = attributes.find('=', start);
+            if (equal == string::npos || equal > end) return false;
+            string key = attributes.substr(start + 1, equal - start - 1);
+            string value = attributes.substr(equal + 1, end - equal - 1);
+            if (key == "id") {
+                char* last = nullptr;
+                unsigned long long id = strtoull(value.c_str(), &last, 10);
+                if (value.empty() || *last != '\0' || id == 0) return false;
+                commodity->setId(id);
+            } else if (key == "stock" && !commodity->setField("stock", value)) {
+                return false;
+            }
+            start = end;
+        }
+        return true;
+    }
+
+    /*
+     * Build a commodity from the lines and keep it until the file is verified.
+     * RETURN: Bool. False if the lines are not a valid record
+     */
+    bool stage(const vector<string>& record, const string& attributes, int category, vector<Staged>& staged,
+               long long line) {
+        Commodity* commodity = CategoryRegistry::get(category).create();
+        if (!commodity->loadRecord(record) || !applyAttributes(attributes, commodity)) {
+            delete commodity;
+            return false;
+        }
+        staged.push_back({commodity, line});
+        return true;
+    }
+
+    void finish(const vector<string>& record, const string& attributes, long long line, int category,
+                vector<Staged>& staged, RecordLoader::Report& report) {
+        if (!stage(record, attributes, category, staged, line)) {
+            skip(report, line, "malformed record");
+        }
+    }
+}
+
+bool RecordLoader::load(const string& fileName, int category, CommodityList& list, Report& report) {
+    vector<char> buffer(1 << 20);
+    ifstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), (streamsize) buffer.size());
+    file.open(fileName, ios::in | ios::binary);
+    if (!file.is_open()) return false;
+
+    auto start = chrono::steady_clock::now();
+    string marker = "@" + CategoryRegistry::get(category).label;
+    Commodity* prototype = CategoryRegistry::get(category).create();
+    size_t recordSize = prototype->recordLayout().size();
+    delete prototype;
+
+    vector<Staged> staged;
+    vector<string> record;
+    string attributes;
+    string nextAttributes;
+    string line;
+    long long lineNumber = 0;
+    long long recordLine = 0;
+    long long firstLine = 1;
+    bool framed = false;
+    bool resyncing = false;
+    bool trailer = false;
+    uint32_t crc = 0;
+    uint32_t expected = 0;
+    while (getline(file, line)) {
+        lineNumber++;
+        report.bytes += (long long) line.size() + 1;
+        if (trailer) {
+            // Nothing may follow the trailer
+            report.checksum = MISMATCH;
+            break;
+        }
+        if (line.compare(0, 8, "#crc32c ") == 0) {
+            trailer = true;
+            expected = (uint32_t) strtoul(line.c_str() + 8, nullptr, 16);
+            report.checksum = (expected == crc) ? VERIFIED : MISMATCH;
+            continue;
+        }
+        crc = Crc32c::update(crc, line.data(), line.size());
+        crc = Crc32c::update(crc, "\n", 1);
+
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (lineNumber == 1 && line.compare(0, 9, "#next-id ") == 0) {
+            // Raised even when the file turns out corrupt, skipping ids costs nothing
+            Commodity::reserveIds(strtoull(line.c_str() + 9, nullptr, 10));
+            firstLine = 2;
+            continue;
+        }
+        if (lineNumber == firstLine) framed = isMarker(line, marker, nextAttributes);
+
+        if (framed) {
+            if (isMarker(line, marker, nextAttributes)) {
+                if (recordLine != 0) finish(record, attributes, recordLine, category, staged, report);
+                record.clear();
+                attributes.swap(nextAttributes);
+                recordLine = lineNumber;
+            } else if (record.size() <= recordSize) {
+                // One extra line is enough to know the record is malformed, the rest is not kept. The '\' written
+                // in front of a line starting with '@', '#' or '\' is removed
+                if (line.size() > 1 && line[0] == '\\' && (line[1] == '@' || line[1] == '#' || line[1] == '\\')) {
+                    line.erase(0, 1);
+                }
+                record.push_back(line);
+            }
+        } else {
+            // Legacy file, slide over the lines until they form a valid record
+            record.push_back(line);
+            if (record.size() == recordSize) {
+                recordLine = lineNumber - (long long) recordSize + 1;
+                if (stage(record, attributes, category, staged, recordLine)) {
+                    record.clear();
+                    resyncing = false;
+                } else {
+                    // The lines skipped until the next valid record are reported as one bad record
+                    if (!resyncing) skip(report, recordLine, "malformed record");
+                    resyncing = true;
+                    record.erase(record.begin());
+                }
+            }
+        }
+    }
+    file.close();
+    if ((framed || firstLine == 2) && report.checksum == MISSING) {
+        // The files with markers or the header are always written with a trailer, so this one is cut short
+        report.checksum = MISMATCH;
+    }
+    if (framed && recordLine != 0) {
+        finish(record, attributes, recordLine, category, staged, report);
+    } else if (!framed && !record.empty()) {
+        skip(report, lineNumber - (long long) record.size() + 1, "incomplete record");
+    }
+
+    if (report.checksum == MISMATCH) {
+        for (Staged& entry : staged) delete entry.commodity;
+        report.skipped = 0;
+        report.badRecords.clear();
+        rename(fileName.c_str(), (fileName + ".corrupt").c_str());
+    } else {
+        for (Staged& entry : staged) {
+            if (list.isExist(entry.commodity)) {
+                delete entry.commodity;
+                skip(report, entry.line, "duplicated name");
+            } else {
+                list.add(entry.commodity, category);
+                report.loaded++;
+            }
+        }
+    }
+
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef STORE_CORE_RECORD_LOADER_H
+#define STORE_CORE_RECORD_LOADER_H
+
+#include <string>
+#include <vector>
+
+#include "CommodityList.h"
+
+/*
+ * RecordLoader read one category file written by CommodityList::save into the list.
+ * Every record starts with a marker line, "@" followed by the category label, then one line for each attribute in
+ * recordLayout order. The marker also carries the attributes which are not part of the layout, the id and the
+ * stock when it is counted, "@<label> id=<n> stock=<n>", so the layouts and the older files stay the same. A record
+ * without an id gets a new one when it is added, and a record without a stock loads as untracked. Each record is
+ * checked by Commodity::loadRecord, so a malformed record is skipped alone and the loading continues from the next
+ * marker. An attribute line which starts with '@', '#' or '\' is saved with a '\' in front, the loader removes it,
+ * so only the lines written as a marker, the header or the trailer are read as one.
+ * A file may start with a "#next-id <n>" line, the first id the commodities created after the load may get, see
+ * Commodity::reserveIds. It keeps the ids of the deleted commodities from being given again.
+ * The file ends with the "#crc32c" trailer written by AtomicFileWriter. The records are only added to the list after
+ * the checksum of the whole file is verified. A file whose checksum does not match, or which has markers or the
+ * header but no trailer, is renamed to "<fileName>.corrupt" and nothing of it is loaded, so the next save can not
+ * overwrite it.
+ * Files written before the markers were introduced are still accepted without a trailer. Without markers the loader
+ * tries the next recordLayout().size() lines, and if they are not a valid record it moves forward by one line.
+ */
+class RecordLoader {
+public:
+    /*
+     * A record which is not loaded, the line where it starts and the reason.
+     */
+    struct BadRecord {
+        long long line;
+        std::string reason;
+    };
+
+    // MISSING is only given to the files without markers, a newer file without a trailer is a MISMATCH
+    enum Checksum {MISSING, VERIFIED, MISMATCH};
+
+    /*
+     * The result of loading one file.
+     * ATTRIBUTE:
+     *  loaded: The number of commodities added to the list.
+     *  skipped: The number of records which are malformed, incomplete or duplicated.
+     *  badRecords: The first skipped records.
+     *  checksum: Whether the file has a trailer and whether it matches.
+     *  bytes: The size of the file.
+     *  seconds: The time the loading took.
+     */
+    struct Report {
+        long long loaded = 0;
+        long long skipped = 0;
+        std::vector<BadRecord> badRecords;
+        Checksum checksum = MISSING;
+        long long bytes = 0;
+        double seconds = 0;
+    };
+
+    /*
+     * Load a file into the list as the specified category.
+     * INPUT: The file name, the category index, and the list
+     * OUTPUT: Bool. False if the file can not be opened
+     */
+    static bool load(const std::string& fileName, int category, CommodityList& list, Report& report);
+};
+
+#endif
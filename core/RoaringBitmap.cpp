@@ -0,0 +1,288 @@
+#include "RoaringBitmap.h"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+
+namespace {
+
+    int countBits(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(bits);
+#else
+        int count = 0;
+        for (; bits != 0; bits &= bits - 1) count++;
+        return count;
+#endif
+    }
+
+    int countTrailingZeros(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(bits);
+#else
+        int count = 0;
+        while ((bits & 1) == 0) {
+            bits >>= 1;
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    bool testBit(const vector<uint64_t>& bits, uint16_t value) {
+        return (bits[value >> 6] >> (value & 63)) & 1;
+    }
+
+    // A small array is looked up in a large one by binary search instead of a merge
+    const size_t SEARCH_RATIO = 32;
+}
+
+void RoaringBitmap::toBitmap(Container& container) {
+    container.bits.assign(BITMAP_WORDS, 0);
+    for (uint16_t value : container.array) container.bits[value >> 6] |= (uint64_t) 1 << (value & 63);
+    container.array.clear();
+    container.array.shrink_to_fit();
+}
+
+void RoaringBitmap::toArray(Container& container) {
+    container.array.clear();
+    container.array.reserve(container.cardinality);
+    for (int word = 0; word < BITMAP_WORDS; word++) {
+        for (uint64_t bits = container.bits[word]; bits != 0; bits &= bits - 1) {
+            container.array.push_back((uint16_t) (word * 64 + countTrailingZeros(bits)));
+        }
+    }
+    container.bits.clear();
+    container.bits.shrink_to_fit();
+}
+
+void RoaringBitmap::add(uint32_t value) {
+    uint16_t key = (uint16_t) (value >> 16);
+    uint16_t low = (uint16_t) value;
+    auto found = containers.empty() || containers.back().key < key
+                 ? containers.end()
+                 : lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& container, uint16_t wanted) { return container.key < wanted; });
+    if (found == containers.end() || found->key != key) {
+        found = containers.insert(found, Container{key, 0, vector<uint16_t>(), vector<uint64_t>()});
+    }
+    Container& container = *found;
+    if (!container.bits.empty()) {
+        uint64_t bit = (uint64_t) 1 << (low & 63);
+        if ((container.bits[low >> 6] & bit) == 0) {
+            container.bits[low >> 6] |= bit;
+            container.cardinality++;
+        }
+        return;
+    }
+    vector<uint16_t>& array = container.array;
+    if (array.empty() || array.back() < low) {
+        array.push_back(low);
+    } else {
+        auto place = lower_bound(array.begin(), array.end(), low);
+        if (*place == low) return;
+        array.insert(place, low);
+    }
+    if (++container.cardinality > ARRAY_LIMIT) toBitmap(container);
+}
+
+bool RoaringBitmap::contains(uint32_t value) const {
+    uint16_t key = (uint16_t) (value >> 16);
+    uint16_t low = (uint16_t) value;
+    auto found = lower_bound(containers.begin(), containers.end(), key,
+                             [](const Container& container, uint16_t wanted) { return container.key < wanted; });
+    if (found == containers.end() || found->key != key) return false;
+    if (!found->bits.empty()) return testBit(found->bits, low);
+    return binary_search(found->array.begin(), found->array.end(), low);
+}
+
+uint64_t RoaringBitmap::cardinality() const {
+    uint64_t count = 0;
+    for (const Container& container : containers) count += (uint64_t) container.cardinality;
+    return count;
+}
+
+void RoaringBitmap::fill(uint32_t count) {
+    containers.clear();
+    for (uint64_t start = 0; start < count; start += 65536) {
+        int size = (int) min<uint64_t>(65536, count - start);
+        Container container = {(uint16_t) (start >> 16), size, vector<uint16_t>(), vector<uint64_t>()};
+        if (size <= ARRAY_LIMIT) {
+            for (int i = 0; i < size; i++) container.array.push_back((uint16_t) i);
+        } else {
+            container.bits.assign(BITMAP_WORDS, 0);
+            for (int word = 0; word < size / 64; word++) container.bits[word] = ~(uint64_t) 0;
+            if (size % 64 != 0) container.bits[size / 64] = ((uint64_t) 1 << (size % 64)) - 1;
+        }
+        containers.push_back(move(container));
+    }
+}
+
+void RoaringBitmap::densify() {
+    for (Container& container : containers) {
+        if (container.bits.empty()) toBitmap(container);
+    }
+}
+
+void RoaringBitmap::values(vector<uint32_t>& out) const {
+    for (const Container& container : containers) {
+        uint32_t high = (uint32_t) container.key << 16;
+        if (container.bits.empty()) {
+            for (uint16_t low : container.array) out.push_back(high | low);
+            continue;
+        }
+        for (int word = 0; word < BITMAP_WORDS; word++) {
+            for (uint64_t bits = container.bits[word]; bits != 0; bits &= bits - 1) {
+                out.push_back(high | (uint32_t) (word * 64 + countTrailingZeros(bits)));
+            }
+        }
+    }
+}
+
+void RoaringBitmap::intersect(const Container& a, const Container& b, Container& out) {
+    out.array.clear();
+    out.bits.clear();
+    if (!a.bits.empty() && !b.bits.empty()) {
+        out.bits.resize(BITMAP_WORDS);
+        int count = 0;
+        for (int word = 0; word < BITMAP_WORDS; word++) {
+            out.bits[word] = a.bits[word] & b.bits[word];
+            count += countBits(out.bits[word]);
+        }
+        out.cardinality = count;
+        if (count <= ARRAY_LIMIT) toArray(out);
+        return;
+    }
+    if (a.bits.empty() && b.bits.empty()) {
+        const vector<uint16_t>& small = a.array.size() <= b.array.size() ? a.array : b.array;
+        const vector<uint16_t>& large = a.array.size() <= b.array.size() ? b.array : a.array;
+        if (small.size() * SEARCH_RATIO < large.size()) {
+            for (uint16_t value : small) {
+                if (binary_search(large.begin(), large.end(), value)) out.array.push_back(value);
+            }
+        } else {
+            set_intersection(small.begin(), small.end(), large.begin(), large.end(), back_inserter(out.array));
+        }
+    } else {
+        const Container& array = a.bits.empty() ? a : b;
+        const Container& bitmap = a.bits.empty() ? b : a;
+        for (uint16_t value : array.array) {
+            if (testBit(bitmap.bits, value)) out.array.push_back(value);
+        }
+    }
+    out.cardinality = (int) out.array.size();
+}
+
+void RoaringBitmap::unite(const Container& a, const Container& b, Container& out) {
+    out.array.clear();
+    out.bits.clear();
+    if (a.bits.empty() && b.bits.empty()) {
+        set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(out.array));
+        out.cardinality = (int) out.array.size();
+        if (out.cardinality > ARRAY_LIMIT) toBitmap(out);
+        return;
+    }
+    if (!a.bits.empty() && !b.bits.empty()) {
+        out.bits.resize(BITMAP_WORDS);
+        for (int word = 0; word < BITMAP_WORDS; word++) out.bits[word] = a.bits[word] | b.bits[word];
+    } else {
+        const Container& array = a.bits.empty() ? a : b;
+        out.bits = (a.bits.empty() ? b : a).bits;
+        for (uint16_t value : array.array) out.bits[value >> 6] |= (uint64_t) 1 << (value & 63);
+    }
+    int count = 0;
+    for (uint64_t word : out.bits) count += countBits(word);
+    out.cardinality = count;
+}
+
+int RoaringBitmap::intersectCount(const Container& a, const Container& b) {
+    int count = 0;
+    if (!a.bits.empty() && !b.bits.empty()) {
+        for (int word = 0; word < BITMAP_WORDS; word++) count += countBits(a.bits[word] & b.bits[word]);
+        return count;
+    }
+    if (a.bits.empty() && b.bits.empty()) {
+        const vector<uint16_t>& small = a.array.size() <= b.array.size() ? a.array : b.array;
+        const vector<uint16_t>& large = a.array.size() <= b.array.size() ? b.array : a.array;
+        if (small.size() * SEARCH_RATIO < large.size()) {
+            for (uint16_t value : small) count += binary_search(large.begin(), large.end(), value) ? 1 : 0;
+            return count;
+        }
+        size_t i = 0;
+        size_t j = 0;
+        while (i < small.size() && j < large.size()) {
+            if (small[i] < large[j]) {
+                i++;
+            } else if (large[j] < small[i]) {
+                j++;
+            } else {
+                count++;
+                i++;
+                j++;
+            }
+        }
+        return count;
+    }
+    const Container& array = a.bits.empty() ? a : b;
+    const Container& bitmap = a.bits.empty() ? b : a;
+    for (uint16_t value : array.array) count += testBit(bitmap.bits, value) ? 1 : 0;
+    return count;
+}
+
+void RoaringBitmap::intersect(const RoaringBitmap& a, const RoaringBitmap& b, RoaringBitmap& out) {
+    out.containers.clear();
+    size_t i = 0;
+    size_t j = 0;
+    Container result = {0, 0, vector<uint16_t>(), vector<uint64_t>()};
+    while (i < a.containers.size() && j < b.containers.size()) {
+        if (a.containers[i].key < b.containers[j].key) {
+            i++;
+        } else if (b.containers[j].key < a.containers[i].key) {
+            j++;
+        } else {
+            result.key = a.containers[i].key;
+            intersect(a.containers[i], b.containers[j], result);
+            if (result.cardinality > 0) out.containers.push_back(move(result));
+            i++;
+            j++;
+        }
+    }
+}
+
+void RoaringBitmap::unite(const RoaringBitmap& a, const RoaringBitmap& b, RoaringBitmap& out) {
+    out.containers.clear();
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.containers.size() || j < b.containers.size()) {
+        if (j == b.containers.size() || (i < a.containers.size() && a.containers[i].key < b.containers[j].key)) {
+            out.containers.push_back(a.containers[i++]);
+        } else if (i == a.containers.size() || b.containers[j].key < a.containers[i].key) {
+            out.containers.push_back(b.containers[j++]);
+        } else {
+            Container result = {a.containers[i].key, 0, vector<uint16_t>(), vector<uint64_t>()};
+            unite(a.containers[i], b.containers[j], result);
+            out.containers.push_back(move(result));
+            i++;
+            j++;
+        }
+    }
+}
+
+uint64_t RoaringBitmap::intersectCount(const RoaringBitmap& a, const RoaringBitmap& b) {
+    uint64_t count = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.containers.size() && j < b.containers.size()) {
+        if (a.containers[i].key < b.containers[j].key) {
+            i++;
+        } else if (b.containers[j].key < a.containers[i].key) {
+            j++;
+        } else {
+            count += (uint64_t) intersectCount(a.containers[i], b.containers[j]);
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
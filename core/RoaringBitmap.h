@@ -0,0 +1,97 @@
+#ifndef STORE_CORE_ROARING_BITMAP_H
+#define STORE_CORE_ROARING_BITMAP_H
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * RoaringBitmap keep a set of 32-bit numbers, in the roaring layout: the numbers are split by their high 16 bits into
+ * containers, and a container keeps its low 16 bits either as a sorted array, while it has at most ARRAY_LIMIT of
+ * them, or as a bitmap of 65536 bits. A sparse set costs two bytes a number and a dense one a bit a number, and the
+ * intersection of two containers is a merge, a lookup per number or a word by word AND, whichever their kinds allow.
+ */
+class RoaringBitmap {
+public:
+    // The most numbers an array container keeps, a bitmap container takes the same 8 KB
+    static const int ARRAY_LIMIT = 4096;
+
+    /*
+     * Add a number, adding in increasing order is the fast way.
+     */
+    void add(uint32_t value);
+
+    bool contains(uint32_t value) const;
+
+    /*
+     * Return the number of numbers in the set
+     */
+    uint64_t cardinality() const;
+
+    bool empty() const {
+        return containers.empty();
+    }
+
+    void clear() {
+        containers.clear();
+    }
+
+    /*
+     * Make the set every number from 0 to count, count excluded.
+     */
+    void fill(uint32_t count);
+
+    /*
+     * Turn every array container into a bitmap one. It takes 8 KB a container, and makes every later intersection
+     * with the set a lookup per number of the other set, which pays for a set intersected with many others.
+     */
+    void densify();
+
+    /*
+     * Append the numbers of the set to out, in increasing order.
+     */
+    void values(std::vector<uint32_t>& out) const;
+
+    /*
+     * Put the numbers in both a and b into out, out must be neither of them.
+     */
+    static void intersect(const RoaringBitmap& a, const RoaringBitmap& b, RoaringBitmap& out);
+
+    /*
+     * Put the numbers in a or b into out, out must be neither of them.
+     */
+    static void unite(const RoaringBitmap& a, const RoaringBitmap& b, RoaringBitmap& out);
+
+    /*
+     * Return the number of numbers in both a and b, without building the intersection.
+     */
+    static uint64_t intersectCount(const RoaringBitmap& a, const RoaringBitmap& b);
+
+private:
+    static const int BITMAP_WORDS = 65536 / 64;
+
+    /*
+     * The numbers whose high 16 bits are key. bits is empty for an array container.
+     */
+    struct Container {
+        uint16_t key;
+        int cardinality;
+        std::vector<uint16_t> array;
+        std::vector<uint64_t> bits;
+    };
+
+    // Sorted by key
+    std::vector<Container> containers;
+
+    /*
+     * Turn an array container into a bitmap one, or a bitmap container with at most ARRAY_LIMIT numbers back into an
+     * array one.
+     */
+    static void toBitmap(Container& container);
+    static void toArray(Container& container);
+
+    static void intersect(const Container& a, const Container& b, Container& out);
+    static void unite(const Container& a, const Container& b, Container& out);
+    static int intersectCount(const Container& a, const Container& b);
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "SalesLog.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "AtomicFile.h"
+#include "Varint.h"
+
+using namespace std;
+
+namespace {
+
+    const size_t HEADER_SIZE = 8;
+    const uint32_t MAX_PAYLOAD = 1 << 24;
+
+    /*
+     * Read the lines of one payload, see SalesLog.
+     */
+    bool parse(const char* in, const char* end, long long& time, vector<ShoppingCart::SoldLine>& lines) {
+        uint64_t count;
+        if (!Varint::getSigned(in, end, time) || !Varint::get(in, end, count)) return false;
+        lines.clear();
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t id;
+            uint64_t category;
+            uint64_t quantity;
+            long long price;
+            if (!Varint::get(in, end, id) || !Varint::get(in, end, category) || !Varint::get(in, end, quantity) ||
+                !Varint::getSigned(in, end, price) || category > 255) {
+                return false;
+            }
+            lines.push_back({id, (int) category, (int) quantity, (int) price, 0});
+        }
+        // The discounts follow the lines only when a line has one
+        for (size_t i = 0; i < lines.size() && in != end; i++) {
+            uint64_t discount;
+            if (!Varint::get(in, end, discount)) return false;
+            lines[i].discount = (int) discount;
+        }
+        return in == end;
+    }
+
+    bool syncFile(FILE* file) {
+        if (fflush(file) != 0) return false;
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+}
+
+const char* const SalesLog::DEFAULT_FILE = "SalesLog.db";
+
+SalesLog::SalesLog(string fileName) : fileName(move(fileName)) {
+    firstLine.push_back(0);
+}
+
+SalesLog::~SalesLog() {
+    if (file != nullptr) fclose(file);
+}
+
+bool SalesLog::open() {
+    file = fopen(fileName.c_str(), "a+b");
+    if (file == nullptr) return false;
+    fseek(file, 0, SEEK_SET);
+
+    long long offset = 0;
+    bool torn = false;
+    char header[HEADER_SIZE];
+    string payload;
+    vector<ShoppingCart::SoldLine> lines;
+    while (true) {
+        size_t got = fread(header, 1, HEADER_SIZE, file);
+        if (got == 0) break;
+        uint32_t size = got == HEADER_SIZE ? Varint::getFixed32(header + 4) : 0;
+        if (got < HEADER_SIZE || size == 0 || size > MAX_PAYLOAD) {
+            torn = true;
+            break;
+        }
+        payload.resize(size);
+        long long time;
+        if (fread(&payload[0], 1, size, file) != size ||
+            Crc32c::update(Crc32c::update(0, header + 4, 4), payload.data(), size) != Varint::getFixed32(header) ||
+            !parse(payload.data(), payload.data() + size, time, lines)) {
+            torn = true;
+            break;
+        }
+        add(time, lines);
+        offset += (long long) (HEADER_SIZE + size);
+    }
+    // Nothing after a torn record can be trusted, the checkouts before it are kept
+    return !torn || truncate(offset);
+}
+
+bool SalesLog::truncate(long long size) {
+    string tempName = fileName + ".tmp";
+    FILE* out = fopen(tempName.c_str(), "wb");
+    if (out == nullptr) return false;
+    bool written = fseek(file, 0, SEEK_SET) == 0;
+    char buffer[1 << 16];
+    for (long long left = size; written && left > 0;) {
+        size_t chunk = (size_t) min<long long>(left, sizeof(buffer));
+        written = fread(buffer, 1, chunk, file) == chunk && fwrite(buffer, 1, chunk, out) == chunk;
+        left -= (long long) chunk;
+    }
+    written = syncFile(out) && written;
+    written = fclose(out) == 0 && written;
+    if (!written) {
+        remove(tempName.c_str());
+        return false;
+    }
+    fclose(file);
+    bool replaced = AtomicFileWriter::replace(tempName, fileName);
+    file = fopen(fileName.c_str(), "a+b");
+    return replaced && file != nullptr;
+}
+
+void SalesLog::add(long long time, const vector<ShoppingCart::SoldLine>& lines) {
+    if (!checkoutTime.empty()) time = max(time, checkoutTime.back());
+    int items = 0;
+    int64_t total = 0;
+    for (const ShoppingCart::SoldLine& line : lines) {
+        auto found = commodityNumbers.find(line.id);
+        if (found == commodityNumbers.end()) {
+            found = commodityNumbers.emplace(line.id, (uint32_t) commodityIds.size()).first;
+            commodityIds.push_back(line.id);
+        }
+        int64_t amount = (int64_t) line.price * line.quantity - line.discount;
+        lineCommodity.push_back(found->second);
+        lineCategory.push_back(line.category);
+        lineQuantity.push_back(line.quantity);
+        lineAmount.push_back(amount);
+        categoryCount = max(categoryCount, line.category + 1);
+        items += line.quantity;
+        total += amount;
+    }
+    checkoutTime.push_back(time);
+    firstLine.push_back((uint32_t) lineCommodity.size());
+    checkoutItems.push_back(items);
+    checkoutTotal.push_back(total);
+}
+
+bool SalesLog::append(long long time, const vector<ShoppingCart::SoldLine>& lines) {
+    add(time, lines);
+    if (file == nullptr) return false;
+
+    string record(HEADER_SIZE, '\0');
+    Varint::putSigned(record, checkoutTime.back());
+    Varint::put(record, lines.size());
+    for (const ShoppingCart::SoldLine& line : lines) {
+        Varint::put(record, line.id);
+        Varint::put(record, (uint64_t) line.category);
+        Varint::put(record, (uint64_t) line.quantity);
+        Varint::putSigned(record, line.price);
+    }
+    bool discounted = false;
+    for (const ShoppingCart::SoldLine& line : lines) discounted = discounted || line.discount != 0;
+    for (size_t i = 0; discounted && i < lines.size(); i++) Varint::put(record, (uint64_t) lines[i].discount);
+    Varint::putFixed32(&record[4], (uint32_t) (record.size() - HEADER_SIZE));
+    Varint::putFixed32(&record[0], Crc32c::update(0, record.data() + 4, record.size() - 4));
+    fseek(file, 0, SEEK_END);
+    return fwrite(record.data(), 1, record.size(), file) == record.size() && fflush(file) == 0;
+}
+
+void SalesLog::basket(size_t checkout, vector<uint64_t>& ids) {
+    ids.clear();
+    for (uint32_t i = firstLine[checkout]; i < firstLine[checkout + 1]; i++) {
+        ids.push_back(commodityIds[lineCommodity[i]]);
+    }
+}
+
+pair<size_t, size_t> SalesLog::slice(long long from, long long to) {
+    size_t first = (size_t) (lower_bound(checkoutTime.begin(), checkoutTime.end(), from) - checkoutTime.begin());
+    size_t last = (size_t) (lower_bound(checkoutTime.begin(), checkoutTime.end(), to) - checkoutTime.begin());
+    return make_pair(first, max(first, last));
+}
+
+void SalesLog::revenueByCategory(long long from, long long to, vector<long long>& revenue) {
+    pair<size_t, size_t> checkouts = slice(from, to);
+    const int32_t* category = lineCategory.data();
+    const int64_t* amount = lineAmount.data();
+    size_t begin = firstLine[checkouts.first];
+    size_t end = firstLine[checkouts.second];
+    revenue.assign(categoryCount, 0);
+    // One branch free pass for each category, the compiler turns the loop into vector instructions
+    for (int c = 0; c < categoryCount; c++) {
+        int64_t sum = 0;
+        for (size_t i = begin; i < end; i++) sum += category[i] == c ? amount[i] : 0;
+        revenue[c] = sum;
+    }
+}
+
+void SalesLog::sumByCommodity(long long from, long long to, bool money, vector<int64_t>& sums) {
+    pair<size_t, size_t> checkouts = slice(from, to);
+    const uint32_t* commodity = lineCommodity.data();
+    size_t begin = firstLine[checkouts.first];
+    size_t end = firstLine[checkouts.second];
+    sums.assign(commodityIds.size(), 0);
+    if (money) {
+        const int64_t* amount = lineAmount.data();
+        for (size_t i = begin; i < end; i++) sums[commodity[i]] += amount[i];
+    } else {
+        const int32_t* quantity = lineQuantity.data();
+        for (size_t i = begin; i < end; i++) sums[commodity[i]] += quantity[i];
+    }
+}
+
+void SalesLog::revenueByCommodity(long long from, long long to, vector<pair<uint64_t, long long>>& revenue) {
+    vector<int64_t> sums;
+    sumByCommodity(from, to, true, sums);
+    revenue.clear();
+    for (size_t i = 0; i < sums.size(); i++) {
+        if (sums[i] != 0) revenue.emplace_back(commodityIds[i], sums[i]);
+    }
+}
+
+void SalesLog::topSellers(long long from, long long to, int count, vector<pair<uint64_t, long long>>& top) {
+    vector<int64_t> sums;
+    sumByCommodity(from, to, false, sums);
+    vector<uint32_t> sold;
+    for (uint32_t i = 0; i < (uint32_t) sums.size(); i++) {
+        if (sums[i] > 0) sold.push_back(i);
+    }
+    size_t wanted = min(sold.size(), (size_t) max(count, 0));
+    partial_sort(sold.begin(), sold.begin() + wanted, sold.end(), [&sums](uint32_t a, uint32_t b) {
+        return sums[a] != sums[b] ? sums[a] > sums[b] : a < b;
+    });
+    top.clear();
+    for (size_t i = 0; i < wanted; i++) top.emplace_back(commodityIds[sold[i]], sums[sold[i]]);
+}
+
+void SalesLog::basketSizes(long long from, long long to, vector<long long>& counts) {
+    pair<size_t, size_t> checkouts = slice(from, to);
+    counts.assign(BASKET_BUCKETS, 0);
+    const int32_t* items = checkoutItems.data();
+    for (size_t i = checkouts.first; i < checkouts.second; i++) counts[min(items[i], BASKET_BUCKETS - 1)]++;
+}
+
+void SalesLog::summarize(long long from, long long to, Report& report, int topCount) {
+    pair<size_t, size_t> checkouts = slice(from, to);
+    const int32_t* items = checkoutItems.data();
+    const int64_t* total = checkoutTotal.data();
+    int64_t itemSum = 0;
+    int64_t revenue = 0;
+    for (size_t i = checkouts.first; i < checkouts.second; i++) {
+        itemSum += items[i];
+        revenue += total[i];
+    }
+    report.checkouts = (long long) (checkouts.second - checkouts.first);
+    report.items = itemSum;
+    report.revenue = revenue;
+    revenueByCategory(from, to, report.categoryRevenue);
+    topSellers(from, to, topCount, report.topSellers);
+    basketSizes(from, to, report.basketSizes);
+}
@@ -0,0 +1,162 @@
+#ifndef STORE_CORE_SALES_LOG_H
+#define STORE_CORE_SALES_LOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ShoppingCart.h"
+
+/*
+ * SalesLog keep every checkout, so the store can tell what it sold.
+ * On the disk a checkout is one record appended to the log: u32 CRC32C of the rest of the record, u32 payload length,
+ * and the payload of varints: the time, the line count, then the id, category, quantity and price of every line, and
+ * the discount of every line when the checkout had one. A record is never rewritten, and a torn record at the end of
+ * the file is cut off when the log is opened.
+ * In memory the checkouts are kept as columns: the time, first line, item count and total of every checkout, and the
+ * commodity, category, quantity and amount of every line. The commodity ids are replaced by a dense number, so the
+ * sums by commodity go into an array instead of a hash table. The checkouts are kept in time order, so a period is a
+ * slice of every column found by a binary search, and an aggregation is one loop over the slices.
+ * Times are seconds since the epoch. The object is used by one thread at a time, and only one process opens a file.
+ */
+class SalesLog {
+public:
+    // The file the front ends keep the sales in, beside the catalog files
+    static const char* const DEFAULT_FILE;
+    // The basket sizes from this number of items on are counted together
+    static const int BASKET_BUCKETS = 16;
+
+    /*
+     * A summary of the checkouts of a period.
+     * ATTRIBUTE:
+     *  checkouts: The number of checkouts.
+     *  items: The number of items sold.
+     *  revenue: The money of all the checkouts.
+     *  categoryRevenue: The money by category index.
+     *  topSellers: The ids of the commodities sold most and their quantities, the most sold first.
+     *  basketSizes: The number of checkouts by the number of items bought, see BASKET_BUCKETS.
+     */
+    struct Report {
+        long long checkouts = 0;
+        long long items = 0;
+        long long revenue = 0;
+        std::vector<long long> categoryRevenue;
+        std::vector<std::pair<uint64_t, long long>> topSellers;
+        std::vector<long long> basketSizes;
+    };
+
+    explicit SalesLog(std::string fileName);
+
+    ~SalesLog();
+
+    SalesLog(const SalesLog&) = delete;
+    SalesLog& operator=(const SalesLog&) = delete;
+
+    /*
+     * Read the log into the columns, the file is created when it does not exist.
+     * OUTPUT: Bool. False if the file can not be opened
+     */
+    bool open();
+
+    /*
+     * Append a checkout, a time before the last checkout is taken as the time of that checkout.
+     * INPUT: The time, and the lines sold, see ShoppingCart::checkOut
+     * OUTPUT: Bool. False if the record can not be written, the checkout is still counted in memory
+     */
+    bool append(long long time, const std::vector<ShoppingCart::SoldLine>& lines);
+
+    /*
+     * Return the number of checkouts
+     */
+    size_t size() {
+        return checkoutTime.size();
+    }
+
+    /*
+     * Return the commodities bought in a checkout.
+     * INPUT: The index of the checkout, less than size(), and the vector to receive the ids
+     * OUTPUT: None
+     */
+    void basket(size_t checkout, std::vector<uint64_t>& ids);
+
+    /*
+     * Sum the money by category over the checkouts from one time to another, from included and to excluded.
+     * INPUT: The period, and the vector to receive the money by category index
+     * OUTPUT: None
+     */
+    void revenueByCategory(long long from, long long to, std::vector<long long>& revenue);
+
+    /*
+     * Sum the money by commodity over a period.
+     * INPUT: The period, and the vector to receive the id and the money of every commodity sold
+     * OUTPUT: None
+     */
+    void revenueByCommodity(long long from, long long to, std::vector<std::pair<uint64_t, long long>>& revenue);
+
+    /*
+     * Find the commodities sold most over a period, by quantity.
+     * INPUT: The period, the number of commodities wanted, and the vector to receive their ids and quantities
+     * OUTPUT: None
+     */
+    void topSellers(long long from, long long to, int count, std::vector<std::pair<uint64_t, long long>>& top);
+
+    /*
+     * Count the checkouts of a period by the number of items bought.
+     * INPUT: The period, and the vector to receive BASKET_BUCKETS counts
+     * OUTPUT: None
+     */
+    void basketSizes(long long from, long long to, std::vector<long long>& counts);
+
+    /*
+     * Build every part of Report over a period.
+     * INPUT: The period, the report, and the number of top sellers wanted (option)
+     * OUTPUT: None
+     */
+    void summarize(long long from, long long to, Report& report, int topCount = 10);
+
+private:
+    std::string fileName;
+    FILE* file = nullptr;
+
+    // One entry for every checkout, firstLine has one more entry which ends the last checkout
+    std::vector<long long> checkoutTime;
+    std::vector<uint32_t> firstLine;
+    std::vector<int32_t> checkoutItems;
+    std::vector<int64_t> checkoutTotal;
+
+    // One entry for every line
+    std::vector<uint32_t> lineCommodity;
+    std::vector<int32_t> lineCategory;
+    std::vector<int32_t> lineQuantity;
+    std::vector<int64_t> lineAmount;
+
+    // The id of every dense commodity number, and the way back
+    std::vector<uint64_t> commodityIds;
+    std::unordered_map<uint64_t, uint32_t> commodityNumbers;
+    int categoryCount = 0;
+
+    /*
+     * Add a checkout to the columns.
+     */
+    void add(long long time, const std::vector<ShoppingCart::SoldLine>& lines);
+
+    /*
+     * Return the checkouts of a period as [first, last).
+     */
+    std::pair<size_t, size_t> slice(long long from, long long to);
+
+    /*
+     * Sum the quantity, or the money, of every dense commodity number over the lines of a period.
+     */
+    void sumByCommodity(long long from, long long to, bool money, std::vector<int64_t>& sums);
+
+    /*
+     * Rewrite the file with its first bytes only, it drops a torn record.
+     */
+    bool truncate(long long size);
+};
+
+#endif
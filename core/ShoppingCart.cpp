@@ -0,0 +1,157 @@
+#include "ShoppingCart.h"
+
+using namespace std;
+
+ShoppingCart::ShoppingCart(chrono::milliseconds hold) : hold(hold) {
+    ShoppingCart_List.resize(CategoryRegistry::size());
+}
+
+ShoppingCart::~ShoppingCart() {
+    releaseAll();
+}
+
+ShoppingCart::ShoppingCart(ShoppingCart&& other) noexcept
+        : ShoppingCart_List(move(other.ShoppingCart_List)), hold(other.hold) {
+    other.ShoppingCart_List.clear();
+}
+
+ShoppingCart& ShoppingCart::operator=(ShoppingCart&& other) noexcept {
+    if (this != &other) {
+        releaseAll();
+        ShoppingCart_List = move(other.ShoppingCart_List);
+        hold = other.hold;
+        other.ShoppingCart_List.clear();
+    }
+    return *this;
+}
+
+void ShoppingCart::releaseAll() {
+    for (vector<CartEntry>& entries : ShoppingCart_List) {
+        for (CartEntry& cartEntry : entries) {
+            if (cartEntry.reserved > 0) cartEntry.commodity->release(cartEntry.reserved);
+        }
+    }
+}
+
+bool ShoppingCart::reserve(CartEntry& cartEntry, int quantity, Clock::time_point now) {
+    int missing = quantity - cartEntry.reserved;
+    if (missing > 0) {
+        if (!cartEntry.commodity->reserve(missing)) return false;
+        // Nothing is taken from an untracked stock, so there is nothing to give back either
+        if (cartEntry.commodity->getStock() != Commodity::UNTRACKED) cartEntry.reserved = quantity;
+    }
+    cartEntry.expires = now + hold;
+    return true;
+}
+
+bool ShoppingCart::push(Commodity* entry , int index, int quantity) {
+    if (index >= (int) ShoppingCart_List.size()) {
+        ShoppingCart_List.resize(index + 1);
+    }
+    Clock::time_point now = Clock::now();
+    uint64_t id = entry->getId();
+    for (CartEntry& cartEntry : ShoppingCart_List[index]) {
+        if (cartEntry.id == id) {
+            if (!reserve(cartEntry, cartEntry.quantity + quantity, now)) return false;
+            cartEntry.quantity += quantity;
+            return true;
+        }
+    }
+    return addLine(entry, index, quantity, now);
+}
+
+bool ShoppingCart::append(Commodity* entry, int index, int quantity) {
+    if (index >= (int) ShoppingCart_List.size()) {
+        ShoppingCart_List.resize(index + 1);
+    }
+    return addLine(entry, index, quantity, Clock::now());
+}
+
+bool ShoppingCart::addLine(Commodity* entry, int index, int quantity, Clock::time_point now) {
+    CartEntry cartEntry = {entry, entry->getId(), quantity, 0, now};
+    if (!reserve(cartEntry, quantity, now)) return false;
+    ShoppingCart_List[index].push_back(cartEntry);
+    return true;
+}
+
+void ShoppingCart::cartDetail(string& out) {
+    int time = 0;
+    for (int i = 0; i < (int) ShoppingCart_List.size(); i++) {
+        if (ShoppingCart_List[i].empty()) continue;
+        out += CategoryRegistry::get(i).label;
+        out += ":\n";
+        for (CartEntry& cartEntry : ShoppingCart_List[i]) {
+            time++;
+            out += to_string(time);
+            out += ".\n";
+            cartEntry.commodity->detail(out, cartEntry.quantity);
+        }
+    }
+}
+
+int ShoppingCart::size() {
+    int Size = 0;
+    for (const vector<CartEntry>& entries : ShoppingCart_List) {
+        Size = Size + (int) entries.size();
+    }
+    return Size;
+}
+
+void ShoppingCart::remove(int index) {
+    for (vector<CartEntry>& entries : ShoppingCart_List) {
+        if (index < (int) entries.size()) {
+            CartEntry& cartEntry = entries[index];
+            if (cartEntry.reserved > 0) cartEntry.commodity->release(cartEntry.reserved);
+            entries.erase(entries.begin() + index);
+            return;
+        }
+        index = index - (int) entries.size();
+    }
+}
+
+bool ShoppingCart::removeId(uint64_t id) {
+    for (vector<CartEntry>& entries : ShoppingCart_List) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].id != id) continue;
+            if (entries[i].reserved > 0) entries[i].commodity->release(entries[i].reserved);
+            entries.erase(entries.begin() + (long) i);
+            return true;
+        }
+    }
+    return false;
+}
+
+int ShoppingCart::expire(Clock::time_point now) {
+    int expired = 0;
+    for (vector<CartEntry>& entries : ShoppingCart_List) {
+        for (CartEntry& cartEntry : entries) {
+            if (cartEntry.reserved == 0 || cartEntry.expires > now) continue;
+            cartEntry.commodity->release(cartEntry.reserved);
+            cartEntry.reserved = 0;
+            expired++;
+        }
+    }
+    return expired;
+}
+
+int ShoppingCart::checkOut(vector<string>* unavailable, vector<SoldLine>* sold) {
+    int total = 0;
+    Clock::time_point now = Clock::now();
+    for (int i = 0; i < (int) ShoppingCart_List.size(); i++) {
+        vector<CartEntry>& entries = ShoppingCart_List[i];
+        for (CartEntry& cartEntry : entries) {
+            // A line whose reservation expired competes for the stock again
+            if (!reserve(cartEntry, cartEntry.quantity, now)) {
+                if (unavailable != nullptr) unavailable->push_back(cartEntry.commodity->getName());
+                continue;
+            }
+            cartEntry.commodity->commit(cartEntry.quantity);
+            cartEntry.reserved = 0;
+            int price = cartEntry.commodity->getPrice();
+            total = total + price * cartEntry.quantity;
+            if (sold != nullptr) sold->push_back({cartEntry.id, i, cartEntry.quantity, price, 0});
+        }
+        entries.clear();
+    }
+    return total;
+}
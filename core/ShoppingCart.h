@@ -0,0 +1,157 @@
+#ifndef STORE_CORE_SHOPPING_CART_H
+#define STORE_CORE_SHOPPING_CART_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Commodity.h"
+
+/*
+ * The shopping cart is used to store the commodities user wanted.
+ * Because the same id represents the same object, if there is a commodity which have more than one object inside
+ * the cart, then it will be store as the same object and the cart must keep the amount of the object.
+ * The entries are grouped by category in the same order as CommodityList, so the cart shows them the same way.
+ * Every line reserves its items from the stock of the commodity, see Commodity::reserve. A reservation is held for
+ * the hold time of the cart after the line last changed, then expire() gives it back and checkOut() has to reserve
+ * the items again. The reservations still held are given back when the cart is destroyed, so a cart can be moved
+ * but not copied.
+ */
+class ShoppingCart {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /*
+     * One line of the cart, the commodity and how many of it the user wants.
+     * id is the id of the commodity, kept beside the pointer so a line is found without touching the commodity.
+     * reserved is the part of quantity taken from the stock, until expires.
+     */
+    struct CartEntry {
+        Commodity* commodity;
+        uint64_t id;
+        int quantity;
+        int reserved;
+        Clock::time_point expires;
+    };
+
+    /*
+     * One line sold by checkOut(), with the price it was sold at. discount is the money taken off the whole line,
+     * see Promotions::apply.
+     */
+    struct SoldLine {
+        uint64_t id;
+        int category;
+        int quantity;
+        int price;
+        int discount;
+    };
+
+private:
+    std::vector<std::vector<CartEntry>> ShoppingCart_List;
+    std::chrono::milliseconds hold;
+
+    /*
+     * Reserve what the line misses to hold quantity items, and restart its hold time.
+     * RETURN: Bool. False if the stock is not enough, the line is unchanged then
+     */
+    bool reserve(CartEntry& cartEntry, int quantity, Clock::time_point now);
+
+    bool addLine(Commodity* entry, int index, int quantity, Clock::time_point now);
+
+    void releaseAll();
+
+public:
+    ~ShoppingCart();
+    explicit ShoppingCart(std::chrono::milliseconds hold = std::chrono::minutes(15));
+
+    ShoppingCart(const ShoppingCart&) = delete;
+    ShoppingCart& operator=(const ShoppingCart&) = delete;
+    ShoppingCart(ShoppingCart&& other) noexcept;
+    ShoppingCart& operator=(ShoppingCart&& other) noexcept;
+
+    /*
+     * Push an commodity object into the cart.
+     * Be careful that if the input object is existing in the list, then keep the amount of that object rather than
+     * actually push the object into the cart.
+     * The items are reserved all at once, so the line grows by quantity or not at all.
+     * INPUT: Commodity. The object need to be pushed, the index of its category, and the number of items (option)
+     * OUTPUT: Bool. False if the commodity does not have enough stock, the cart is unchanged then.
+     */
+    bool push(Commodity* entry , int index, int quantity = 1);
+
+    /*
+     * Add a new line without looking for the commodity in the cart, for a caller which knows it is not there yet,
+     * e.g. a saved cart being restored. The items are reserved like push does.
+     * OUTPUT: Bool. False if the commodity does not have enough stock, the cart is unchanged then.
+     */
+    bool append(Commodity* entry, int index, int quantity);
+
+    /*
+     * Append the content of the cart to out, every line is Commodity.detail() with its amount.
+     * INPUT: The string to append to.
+     * OUTPUT: None.
+     */
+    void cartDetail(std::string& out);
+
+    /*
+     * Return the number of categories the cart keeps, and the lines of one of them in the order they are shown.
+     */
+    int categoryCount() {
+        return (int) ShoppingCart_List.size();
+    }
+
+    const std::vector<CartEntry>& getCategory(int index) {
+        return ShoppingCart_List[index];
+    }
+
+    /*
+     * Return the cart size. (The same object must be seen as one entry)
+     * INPUT: None.
+     * OUTPUT: Integer. The cart size.
+     */
+    int size();
+
+    /*
+     * Remove an entry from the cart. Don't care about the amount of the commodity, just remove it.
+     * Its reservation is given back.
+     * INPUT: The order of the entry.
+     * OUTPUT: None.
+     */
+    void remove(int index);
+
+    /*
+     * Remove the line of a commodity, e.g. when the manager deletes the commodity from the store.
+     * INPUT: The id of the commodity.
+     * OUTPUT: Bool. False if the cart has no line of that commodity.
+     */
+    bool removeId(uint64_t id);
+
+    /*
+     * Give back the reservations whose hold time is over, the lines stay in the cart.
+     * INPUT: The current time (option)
+     * OUTPUT: Integer. The number of lines which lost their reservation.
+     */
+    int expire(Clock::time_point now = Clock::now());
+
+    /*
+     * Check the total amount of price for the user.
+     * Remember to clear the list after checkout.
+     * The lines whose reservation expired are reserved again first. A line whose stock is gone is not sold, its name
+     * is added to unavailable. The other lines already hold their items, so they are sold without a second check.
+     * INPUT: The vector to receive the names of the commodities which are not sold (option), and the vector to
+     * receive the lines which are sold (option).
+     * OUTPUT: Integer. The total price.
+     */
+    int checkOut(std::vector<std::string>* unavailable = nullptr, std::vector<SoldLine>* sold = nullptr);
+
+    /*
+     * Check if the cart have nothing inside.
+     * INPUT: None.
+     * OUTPUT: Bool. True if the cart is empty, otherwise false.
+     */
+    bool empty() {
+        return size() == 0;
+    }
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef STORE_CORE_STORE_CORE_H
+#define STORE_CORE_STORE_CORE_H
+
+/*
+ * The store engine without any console input or output, the front ends include this header and link store-core.
+ */
+#include "AtomicFile.h"
+#include "BoughtTogether.h"
+#include "CartStore.h"
+#include "CatalogExporter.h"
+#include "CatalogImporter.h"
+#include "CheckoutPricing.h"
+#include "Checkpointer.h"
+#include "Commodity.h"
+#include "CommodityList.h"
+#include "FacetIndex.h"
+#include "Json.h"
+#include "Metrics.h"
+#include "PriceHistory.h"
+#include "Promotions.h"
+#include "RecordLoader.h"
+#include "RoaringBitmap.h"
+#include "SalesLog.h"
+#include "ShoppingCart.h"
+#include "TaskPool.h"
+#include "Varint.h"
+
+#endif
@@ -0,0 +1,113 @@
+#include "TaskPool.h"
+
+using namespace std;
+
+namespace {
+
+    // The pool and the worker index of the calling thread, the index is -1 outside every pool
+    thread_local TaskPool* currentPool = nullptr;
+    thread_local int currentWorker = -1;
+}
+
+TaskPool::TaskPool(int workers) : queued(0), pending(0), nextQueue(0) {
+    if (workers <= 0) workers = max(1, (int) thread::hardware_concurrency());
+    for (int i = 0; i < workers; i++) queues.emplace_back(new Queue());
+    for (int i = 0; i < workers; i++) threads.emplace_back(&TaskPool::work, this, i);
+}
+
+TaskPool::~TaskPool() {
+    drain();
+    {
+        lock_guard<mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (thread& worker : threads) worker.join();
+}
+
+TaskPool& TaskPool::shared() {
+    static TaskPool pool;
+    return pool;
+}
+
+void TaskPool::drain() {
+    while (pending.load() > 0) {
+        if (runOne()) continue;
+        unique_lock<mutex> guard(sleepLock);
+        drained.wait(guard, [this]() { return pending.load() == 0 || queued.load() > 0; });
+    }
+}
+
+void TaskPool::push(function<void()> task) {
+    // Counted before it can run, so drain() never sees a finished task which was not counted
+    pending++;
+    int index = currentPool == this ? currentWorker : (int) (nextQueue++ % queues.size());
+    {
+        lock_guard<mutex> guard(queues[index]->lock);
+        queues[index]->tasks.push_back(move(task));
+    }
+    {
+        lock_guard<mutex> guard(sleepLock);
+        queued++;
+    }
+    wakeUp.notify_one();
+    // A thread inside drain() helps with the new task as well
+    drained.notify_all();
+}
+
+bool TaskPool::take(int self, function<void()>& task) {
+    if (queued.load() == 0) return false;
+    int count = (int) queues.size();
+    if (self >= 0) {
+        Queue& own = *queues[self];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    for (int i = 1; i <= count; i++) {
+        Queue& victim = *queues[(self + i + count) % count];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskPool::run(function<void()>& task) {
+    task();
+    task = nullptr;
+    if (--pending == 0) {
+        lock_guard<mutex> guard(sleepLock);
+        drained.notify_all();
+    }
+}
+
+bool TaskPool::runOne() {
+    function<void()> task;
+    if (!take(currentPool == this ? currentWorker : -1, task)) return false;
+    run(task);
+    return true;
+}
+
+void TaskPool::work(int self) {
+    currentPool = this;
+    currentWorker = self;
+    function<void()> task;
+    while (true) {
+        if (take(self, task)) {
+            run(task);
+            continue;
+        }
+        unique_lock<mutex> guard(sleepLock);
+        wakeUp.wait(guard, [this]() { return queued.load() > 0 || stopping; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
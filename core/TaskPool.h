@@ -0,0 +1,119 @@
+#ifndef STORE_CORE_TASK_POOL_H
+#define STORE_CORE_TASK_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+ * TaskPool is a small work stealing thread pool for the work which should not block the shopper, e.g. parsing an
+ * imported file or writing the catalog files.
+ * Every worker has its own deque. A task submitted by a worker goes to the back of its own deque and the worker takes
+ * from the back, so a task split into smaller tasks keeps its data in cache. An idle worker steals from the front of
+ * the other deques, and the tasks submitted from outside the pool are spread over the deques in turn.
+ * submit() return a std::future. A thread which needs the result of a task should use wait(), it runs the queued
+ * tasks meanwhile, so tasks waiting for their own sub tasks can not use up the workers.
+ */
+class TaskPool {
+public:
+    /*
+     * INPUT: The number of worker threads, 0 is one per hardware thread
+     */
+    explicit TaskPool(int workers = 0);
+
+    TaskPool(const TaskPool&) = delete;
+
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    /*
+     * Drain the pool, then stop the workers.
+     */
+    ~TaskPool();
+
+    /*
+     * The pool shared by the store engine, it is created on first use with one worker per hardware thread.
+     */
+    static TaskPool& shared();
+
+    int size() {
+        return (int) threads.size();
+    }
+
+    /*
+     * Queue a task, it can be called from any thread and from inside a task.
+     * INPUT: A callable without argument
+     * OUTPUT: The future of its result, an exception thrown by the task is rethrown by get()
+     */
+    template <class Task>
+    std::future<typename std::result_of<Task()>::type> submit(Task task) {
+        typedef typename std::result_of<Task()>::type Result;
+        // std::function needs a copyable callable, so the packaged task is shared
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> future = packaged->get_future();
+        push([packaged]() { (*packaged)(); });
+        return future;
+    }
+
+    /*
+     * Wait for a future of this pool and return its result, the queued tasks are run while it is not ready.
+     */
+    template <class Result>
+    Result wait(std::future<Result>& future) {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            // Nothing is queued, so the task is running on another thread
+            if (!runOne()) future.wait();
+        }
+        return future.get();
+    }
+
+    /*
+     * Wait until every task submitted before is finished, together with the tasks they submit. The caller runs queued
+     * tasks meanwhile. It must not be called from inside a task.
+     */
+    void drain();
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex sleepLock;
+    std::condition_variable wakeUp;
+    std::condition_variable drained;
+    // Tasks inside the deques, and tasks submitted but not finished
+    std::atomic<long> queued;
+    std::atomic<long> pending;
+    std::atomic<unsigned> nextQueue;
+    bool stopping = false;
+
+    void push(std::function<void()> task);
+
+    /*
+     * Take a task, the back of the own deque first, then the front of the others.
+     * INPUT: The worker index, -1 for a thread outside the pool, and the function to store the task
+     * OUTPUT: Bool. False if every deque is empty
+     */
+    bool take(int self, std::function<void()>& task);
+
+    void run(std::function<void()>& task);
+
+    /*
+     * Run one queued task on the calling thread. Return false if nothing is queued.
+     */
+    bool runOne();
+
+    void work(int self);
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef STORE_CORE_VARINT_H
+#define STORE_CORE_VARINT_H
+
+#include <cstdint>
+#include <string>
+
+/*
+ * Varint hold the integer codecs of the binary files of the store, the cart log, the sales log and the price
+ * history. A varint keeps 7 bits in each byte, the low bits first, and the high bit of a byte tells that another one
+ * follows. A signed value is stored zigzag, so a small drop is as short as a small rise. The fixed size integers are
+ * 4 bytes, little endian, whatever the CPU.
+ */
+class Varint {
+public:
+    static void put(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back((char) (value | 0x80));
+            value >>= 7;
+        }
+        out.push_back((char) value);
+    }
+
+    /*
+     * Read a varint, in is moved after it.
+     * OUTPUT: Bool. False if the bytes end before the varint does, or it is longer than 64 bits
+     */
+    static bool get(const char*& in, const char* end, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; in < end && shift < 64; shift += 7) {
+            unsigned char byte = (unsigned char) *in++;
+            value |= (uint64_t) (byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return true;
+        }
+        return false;
+    }
+
+    static void putSigned(std::string& out, long long value) {
+        put(out, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+    }
+
+    static bool getSigned(const char*& in, const char* end, long long& value) {
+        uint64_t raw;
+        if (!get(in, end, raw)) return false;
+        value = (long long) (raw >> 1) ^ -(long long) (raw & 1);
+        return true;
+    }
+
+    static void putFixed32(char* out, uint32_t value) {
+        for (int i = 0; i < 4; i++) out[i] = (char) ((value >> (8 * i)) & 0xFF);
+    }
+
+    static uint32_t getFixed32(const char* in) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) value |= (uint32_t) (unsigned char) in[i] << (8 * i);
+        return value;
+    }
+};
+
+#endif
@@ -231,21 +231,26 @@ public:
 
     /*
      * Remove an object specified by the position
+     * The list owns the removed node and deletes it, the cart keeps its own copies.
      * INPUT: Integer. The position of the object which need to be removed
      * OUTPUT: None
      */
     void remove(int index) {
         int time = 1;
         Commodity *check;
+        Commodity *removed;
         check=First_Commodity;
         if(check == nullptr)cout<<"No commodity inside the store\n";
         while(check){
             if(index == 0){
                 First_Commodity = First_Commodity->getPtr();
+                delete check;
                 break;
             }
             if(time == index){
-                check->inputPtr(check->getPtr()->getPtr() );
+                removed = check->getPtr();
+                check->inputPtr(removed->getPtr());
+                delete removed;
                 break;
             }
             check = check->getPtr() ;
@@ -463,6 +468,7 @@ private:
         newCom = new Commodity(price, name, detail);
         if (commodityList.isExist(newCom)) {
             cout << "[WARNING] " << name << " is exist in the store. If you want to edit it, please delete it first" << endl;
+            delete newCom;
         } else {
             commodityList.add(newCom);
         }
@@ -673,8 +679,10 @@ public:
 };
 
 
+#ifndef STORE_NO_MAIN
 int main() {
     Store csStore;
     csStore.open();
     return 0;
 }
+#endif
@@ -1,15 +1,17 @@
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <fstream>
+#include <future>
+#include <memory>
+
+#include "core/StoreCore.h"
+
 using namespace std;
 
-class Commodity;
 class Store;
 class InputHandler;
-class Sound;
-class Smartphone;
-class Laptop;
 
 
 class InputHandler {
@@ -117,875 +119,469 @@ public:
     }
 };
 
+// A changed catalog is saved in the background at most this often while the store is open
+const chrono::seconds CHECKPOINT_INTERVAL(30);
+// The name the cart of the console is kept under in the CartStore file
+const string CONSOLE_CART = "console";
+// The period the manager reports look back on
+const long long MONTH_SECONDS = 30LL * 24 * 60 * 60;
+
 /*
- * Commodity is about an item which the user can buy and the manager can add or delete.
- * ATTRIBUTE:
- *  price: The price of the commodity, an integer.
- *  description: The text which describe the commodity detail, a string.
- *  commodityName: The name of the commodity, a string.
+ * [DO NOT MODIFY ANY CODE HERE]
+ * The Store class manage the flow of control, and the interface showing to the user.
+ * Store use status to choose the interface to show. As the result, status control is very important here.
+ * If you can understand the code here, you will have great work on the above two class.
+ * The detail of Store is in the README
  */
-class Commodity {
-protected:
-    int price;
-    string description;
-    string commodityName;
-
-public:
-    ~Commodity() = default;
-    Commodity() {
-        price = 0;
-        description = "";
-        commodityName = "";
-    }
-
-    Commodity(int price, string commodityName, string description) {
-        this->price = price;
-        this->commodityName = commodityName;
-        this->description = description;
-    }
+class Store {
+private:
+    enum UMode {USER, MANAGER} userStatus;
+    enum SMode {OPENING, DECIDING, SHOPPING, BROWSING, CART_CHECKING, CHECK_OUT, MANAGING, CLOSE,
+                SMODE_COUNT} storeStatus;
+    static_assert(SMODE_COUNT == StoreMetrics::STATE_COUNT, "StoreMetrics must have a histogram for every state");
+    CommodityList commodityList;
+    // Declared after the list, so the running checkpoint is waited for before the list goes away
+    Checkpointer checkpointer;
+    ShoppingCart cart;
+    CartStore cartStore;
+    PriceHistory priceHistory;
+    SalesLog salesLog;
+    BoughtTogether boughtTogether;
+    Promotions promotions;
+    CheckoutPricing pricing;
+    // Whether the regions are read from a file, the console pays in the first one
+    bool regional = false;
+    // One for every category, built when a shopper first browses
+    vector<FacetIndex> facetIndexes;
+    // The text of the lists and the cart is built here before it is printed, the buffer is reused by every screen
+    string screen;
 
     /*
-     * This method will show the full information of the commodity to user interface.
-     * There is a overloading version, with an argument amount which will output the information with the amount
-     * INPUT: None, or an integer specify the amount of this commodity
-     * RETURN: None
+     * An import whose rounds are parsed by the tasks of the pool, see finishImports().
      */
-    virtual void detail() {
-        cout << commodityName << endl;
-        cout << "price: " << price << endl;
-        cout << "description: " << description << endl;
-        cout << "----------------------------" << endl;
-    }
+    struct PendingImport {
+        string fileName;
+        unique_ptr<CatalogImporter::Parsed> parsed;
+    };
+    vector<PendingImport> pendingImports;
 
-    virtual void detail(int amount) {
-        cout << commodityName << endl;
-        cout << "price: " << price << endl;
-        cout << "description: " << description << endl;
-        cout << "x " << amount << endl;
-        cout << "----------------------------" << endl;
+
+
+    void load(){
+        STORE_TIMED(LOAD);
+        for (int i = 0; i < CategoryRegistry::size(); i++) {
+            const string& fileName = CategoryRegistry::get(i).fileName;
+            RecordLoader::Report report;
+            if (!RecordLoader::load(fileName, i, commodityList, report)) continue;
+
+            double rate = report.seconds > 0 ? report.bytes / report.seconds / (1 << 20) : 0;
+            if (report.checksum == RecordLoader::MISMATCH) {
+                cout << "[WARNING] " << fileName << " fails its checksum, it is moved to " << fileName
+                     << ".corrupt and not loaded" << endl;
+                continue;
+            }
+            cout << "Load " << fileName << ": " << report.loaded << " loaded, " << report.skipped << " skipped, "
+                 << report.bytes << " bytes in " << report.seconds << " seconds (" << rate << " MB/sec)"
+                 << (report.checksum == RecordLoader::VERIFIED ? ", checksum verified" : ", no checksum") << endl;
+            for (const RecordLoader::BadRecord& bad : report.badRecords) {
+                cout << "[WARNING] " << fileName << " line " << bad.line << ": " << bad.reason << endl;
+            }
+        }
+        if (!priceHistory.open(PriceHistory::DEFAULT_FILE)) {
+            cout << "[WARNING] " << PriceHistory::DEFAULT_FILE << " is damaged, the price history starts again" << endl;
+        }
+        if (!salesLog.open()) {
+            cout << "[WARNING] Can not open " << SalesLog::DEFAULT_FILE << ", the sales are not recorded" << endl;
+        }
+        vector<uint64_t> ids;
+        for (size_t i = 0; i < salesLog.size(); i++) {
+            salesLog.basket(i, ids);
+            boughtTogether.add(ids);
+        }
+        // The store runs without promotions when there is no file
+        loadPromotions(Promotions::DEFAULT_FILE);
+        vector<string> errors;
+        regional = pricing.load(CheckoutPricing::DEFAULT_FILE, &errors);
+        for (const string& error : errors) {
+            cout << "[WARNING] " << CheckoutPricing::DEFAULT_FILE << " " << error << endl;
+        }
     }
 
-    /*
-     * Use this function to get the information data from the user, this will init the object.
-     * INPUT: none
-     * OUTPUT: none
-     */
-    virtual void userSpecifiedCommodity() {
-        cout << "Please input the commodity name:" << endl;
-        commodityName = InputHandler::readWholeLine();
-        cout << "Please input the commodity price:" << endl;
-        price = InputHandler::numberInput();
-        cout << "Please input the detail of the commodity:" << endl;
-        description = InputHandler::readWholeLine();
+    void loadPromotions(const string& fileName) {
+        vector<string> errors;
+        if (!promotions.load(fileName, &errors)) return;
+        for (const string& error : errors) {
+            cout << "[WARNING] " << fileName << " " << error << endl;
+        }
+        cout << promotions.size() << " promotions loaded from " << fileName << endl;
     }
 
-    /*
-     * Save and load function is used to write the data to the file or read the data from the file.
-     * According to the input parameter fstream, they complete the I/O on the specified file.
-     * There have no definition of those method, because it is used to be override in the derived class.
-     * INPUT: fstream
-     * OUTPUT: none
-     */
-    virtual void save(fstream& file) {
-        file  << commodityName << '\n' << price << '\n' << description << '\n';
+    void reloadPromotions() {
+        cout << "Please input the file name of the promotions(.jsonl):" << endl;
+        string fileName = InputHandler::readWholeLine();
+        if (!ifstream(fileName).good()) {
+            cout << "[WARNING] Can not open " << fileName << endl;
+            return;
+        }
+        loadPromotions(fileName);
     }
 
-    virtual void load(fstream& file) {
-        commodityName = InputHandler::readWholeLine(file);
-        file >>price;
-        description = InputHandler::readWholeLine(file);
+    // The time of the price history and the sales log, in seconds since the epoch
+    static long long now() {
+        return (long long) chrono::system_clock::to_time_t(chrono::system_clock::now());
     }
 
     /*
-     * The getter function of commodityName
+     * Fold the journal of the price history into its file, so the next start reads the blocks only.
      */
-    virtual string getName() {
-        return commodityName;
+    void savePriceHistory() {
+        if (!priceHistory.checkpoint()) {
+            cout << "[WARNING] Fail to save " << PriceHistory::DEFAULT_FILE << ", the previous file is kept" << endl;
+        }
     }
 
     /*
-     * The getter function of price
+     * Put back the cart of the last visit, its lines are found by id and reserved again.
      */
-    virtual int getPrice() {
-        return price;
-    }
-};
-
-
-
-/*
- * [YOU SHOULD FINISH THREE TYPES OF DERIVED COMMODITY CLASS HERE]
- * Please try your best to complete the definition of three classes.
- * Use the knowledge you learned from this course.
- * You should follow the OOP concept.
- */
-class Sound : public Commodity{
-private:
-    int price;
-    string description;
-    string commodityName;
-    int lowest_Frequency_Response;
-    int highest_Frequency_Response;
-    int Sensitivity;
-    int Impedance;
-public:
-    ~Sound() =default;
-    Sound(){
-        price = 0;
-        commodityName = "";
-        lowest_Frequency_Response = 0;
-        highest_Frequency_Response = 0;
-        Sensitivity = 0;
-        Impedance = 0;
-        description = "";
-    }
-
-    void detail() override{
-        cout << "* " << commodityName << " *" << endl;
-        cout << "price: " << price << "  dollars" <<endl;
-        cout << "Lowest Frequency Response: " <<lowest_Frequency_Response << "  Hz" <<endl;
-        cout << "Highest Frequency Response: " <<highest_Frequency_Response << "  kHz" <<endl;
-        cout << "Sensitivity: " <<Sensitivity<< "  dB" << endl;
-        cout << "Impedance: " <<Impedance<< "  Ohm" <<endl;
-        cout << "description: " << description << endl;
-        cout << "----------------------------" << endl;
-    }
-
-    void detail(int amount) override{
-        cout << "* " << commodityName << " *" << endl;
-        cout << "price: " << price << "  dollars" <<endl;
-        cout << "Lowest Frequency Response: " <<lowest_Frequency_Response << "  Hz" <<endl;
-        cout << "Highest Frequency Response: " <<highest_Frequency_Response << "  kHz" <<endl;
-        cout << "Sensitivity: " <<Sensitivity<< "  dB" << endl;
-        cout << "Impedance: " <<Impedance<< "  Ohm" <<endl;
-        cout << "description: " << description << endl;
-        cout << "x " << amount << endl;
-        cout << "----------------------------" << endl;
-    }
-
-    void userSpecifiedCommodity() override{
-        cout << "Please input the commodity name:" << endl;
-        commodityName = InputHandler::readWholeLine();
-        cout << "Please input the commodity price:" << endl;
-        price = InputHandler::numberInput();
-        cout<<"Please intput the lowest frequency response"<<endl;
-        lowest_Frequency_Response = InputHandler::numberInput();
-        cout<<"Please intput the highest frequency response"<<endl;
-        highest_Frequency_Response = InputHandler::numberInput();
-        cout<<"Please input the Sensitivity"<<endl;
-        Sensitivity = InputHandler::numberInput();
-        cout<<"Please input the Impedance"<<endl;
-        Impedance = InputHandler::numberInput();
-        cout<<"Please input the Description"<<endl;
-        description = InputHandler::readWholeLine();
-    }
-    string getName() override{
-        return commodityName;
-    }
-
-    int getPrice() override{
-        return price;
-    }
-
-    void save(fstream& file) override{
-        file << price << '\n' << commodityName <<'\n' <<lowest_Frequency_Response;
-        file << '\n' << highest_Frequency_Response << '\n' ;
-        file << Sensitivity <<'\n' << Impedance << '\n' << description << '\n';
-    }
-
-    void load(fstream& file) override{
-        file >> price ;
-        commodityName = InputHandler::readWholeLine(file);
-        file >> lowest_Frequency_Response >> highest_Frequency_Response ;
-        file >> Sensitivity >> Impedance;
-        description = InputHandler::readWholeLine(file);
-
-    }
-};
-
-class Smartphone :public Commodity{
-private:
-    int price;
-    string description;
-    string commodityName;
-    int Screen_Size;
-    string CellularandWireless;
-    int Camera;
-    string chip;
-    int weight;
-    int Vedeo_playback;
-public:
-    ~Smartphone() = default;
-
-    Smartphone(){
-        price = 0;
-        commodityName = "";
-        description = "";
-        Screen_Size = 0;
-        CellularandWireless = "";
-        Camera = 0;
-        chip = "";
-        weight = 0;
-        Vedeo_playback = 0;
-    }
-
-    string getName()override {
-        return commodityName;
-    }
-
-    int getPrice() override{
-        return price;
-    }
-
-    void detail()override {
-        cout << "* " << commodityName << " *" << endl;
-        cout << "price: " << price << "  dollars" <<endl;
-        cout << "Screen Size: " << Screen_Size << "  inch" <<endl;
-        cout << "Cellular and Wireless: " << CellularandWireless <<endl;
-        cout << "Camera: " << Camera << "  pixel" << endl;
-        cout << "chip: " << chip <<endl;
-        cout << "weight: " << weight << "  grams" <<endl;
-        cout << "Vedeo playback time: " << Vedeo_playback << "  hours" <<endl;
-        cout << "description: " << description << endl;
-        cout << "----------------------------" << endl;
-    }
-
-    void detail(int amount) override{
-        cout << "* " << commodityName << " *" << endl;
-        cout << "price: " << price << "  dollars" <<endl;
-        cout << "Screen Size: " << Screen_Size << "  inch" <<endl;
-        cout << "Cellular and Wireless: " << CellularandWireless <<endl;
-        cout << "Camera: " << Camera << "  pixel" << endl;
-        cout << "chip: " << chip <<endl;
-        cout << "weight: " << weight << "  grams" <<endl;
-        cout << "Vedeo playback time: " << Vedeo_playback << "  hours" <<endl;
-        cout << "description: " << description << endl;
-        cout << "x " << amount << endl;
-        cout << "----------------------------" << endl;
-    }
-
-    void userSpecifiedCommodity() override{
-        cout << "Please input the commodity name:" << endl;
-        commodityName = InputHandler::readWholeLine();
-        cout << "Please input the commodity price:" << endl;
-        price = InputHandler::numberInput();
-        cout<<"Please intput the Screen Size"<<endl;
-        Screen_Size = InputHandler::numberInput();
-        cout<<"Please intput the Cellular and Wireless"<<endl;
-        CellularandWireless = InputHandler::readWholeLine();
-        cout<<"Please input the Camera(pixel)"<<endl;
-        Camera = InputHandler::numberInput();
-        cout<<"Please input the Chip"<<endl;
-        chip= InputHandler::readWholeLine();
-        cout<<"Please input the Weight"<<endl;
-        weight = InputHandler::numberInput();
-        cout<<"Please input the Vedeo playback time"<<endl;
-        Vedeo_playback = InputHandler::numberInput();
-        cout << "Please input the detail of the commodity:" << endl;
-        description = InputHandler::readWholeLine();
-    }
-
-    void save(fstream& file) override{
-        file  << price << '\n' << commodityName << '\n';
-        file << Screen_Size << '\n'  << CellularandWireless;
-        file << '\n' << Camera << '\n' << chip << '\n' << weight << '\n' << Vedeo_playback << '\n' << description << '\n';
-    }
-
-    void load(fstream& file) override{
-        file >> price;
-        commodityName = InputHandler::readWholeLine(file);
-        file >> Screen_Size ;
-        CellularandWireless = InputHandler::readWholeLine(file);
-        file >> Camera;
-        chip = InputHandler::readWholeLine(file);
-        file >> weight >> Vedeo_playback;
-        description = InputHandler::readWholeLine(file);
-
-    }
-};
-
-class Laptop:public Commodity{
-private:
-    int price;
-    string description;
-    string commodityName;
-    int Screen_Size;
-    string OStype;
-    string CPUtype;
-    string GPUtype;
-    int Disksize;
-    int memorysize;
-    int RGB;
-public:
-    ~Laptop() = default;
-
-    Laptop(){
-        price = 0;
-        commodityName = "";
-        description = "";
-        Screen_Size = 0;
-        OStype = "";
-        CPUtype = "";
-        GPUtype = "";
-        Disksize = 0;
-        memorysize = 0;
-        RGB = 0;
-    }
-
-    string getName() override{
-        return commodityName;
-    }
-
-    int getPrice() override{
-        return price;
-    }
-
-    void detail() override{
-        cout << "* " << commodityName << " *" << endl;
-        cout << "price: " << price <<"  dollars"<< endl;
-        cout << "Screen Size: " << Screen_Size << "  inch" <<endl;
-        cout << "Operatin System: " <<OStype<<endl;
-        cout << "CPU: " <<CPUtype<<endl;
-        cout << "GPU: " <<GPUtype<<endl;
-        cout << "Max Memory Size: " <<memorysize << "  GB" <<endl;
-        cout << "Disk Size: " << Disksize << "  GB" <<endl;
-        cout << "Does it have RGB light" ;
-        if(RGB == 1)cout << "  yes" << endl;
-        else if(RGB == 2)cout <<"  no" << endl;
-        cout << "description: " << description << endl;
-        cout << "----------------------------" << endl;
-    }
-
-    void detail(int amount) override{
-        cout << "* " << commodityName << " *" << endl;
-        cout << "price: " << price <<"  dollars"<< endl;
-        cout << "Screen Size: " << Screen_Size << "  inch" <<endl;
-        cout << "Operatin System: " <<OStype<<endl;
-        cout << "CPU: " <<CPUtype<<endl;
-        cout << "GPU: " <<GPUtype<<endl;
-        cout << "Max Memory Size: " <<memorysize << "  GB" <<endl;
-        cout << "Disk Size: " << Disksize << "  GB" <<endl;
-        cout << "Does it have RGB light" ;
-        if(RGB == 1)cout << "  yes" << endl;
-        else if(RGB == 2)cout <<"  no" << endl;
-        cout << "description: " << description << endl;
-        cout << "x " << amount << endl;
-        cout << "----------------------------" << endl;
-    }
-
-    void userSpecifiedCommodity()override {
-        cout << "Please input the commodity name:" << endl;
-        commodityName = InputHandler::readWholeLine();
-        cout << "Please input the commodity price:" << endl;
-        price = InputHandler::numberInput();
-        cout<<"Please intput the Operating System"<<endl;
-        OStype = InputHandler::readWholeLine();
-        cout<<"Please intput the Screen Size"<<endl;
-        Screen_Size = InputHandler::numberInput();
-        cout<<"Please input the CPU"<<endl;
-        CPUtype = InputHandler::readWholeLine();
-        cout<<"Please input the max Memory Size"<<endl;
-        memorysize = InputHandler::numberInput();
-        cout<<"Please input the Disk Size"<<endl;
-        Disksize = InputHandler::numberInput();
-        cout<<"Please input the GPU"<<endl;
-        GPUtype= InputHandler::readWholeLine();
-        cout<< "Is this Laptop have RGB light?  1.yes/2.no " << endl;
-        RGB = InputHandler::getInput(2);
-        cout << "Please input the detail of the commodity:" << endl;
-        description = InputHandler::readWholeLine();
-
-    }
-
-    void save(fstream& file) override{
-        file << price << '\n' << commodityName ;
-        file << '\n'  <<  Screen_Size << '\n' << OStype ;
-        file << '\n'  << memorysize << '\n' << CPUtype   << '\n' << RGB << '\n' << GPUtype<< '\n' << Disksize << '\n' << description << '\n';
-    }
-
-    void load(fstream& file) override{
-        file >> price ;
-        commodityName = InputHandler::readWholeLine(file);
-        file >> Screen_Size;
-        OStype = InputHandler::readWholeLine(file);
-        file >> memorysize;
-        CPUtype = InputHandler::readWholeLine(file);
-        file >> RGB;
-        GPUtype = InputHandler::readWholeLine(file);
-        file >> Disksize;
-        description = InputHandler::readWholeLine(file);
+    void resumeCart() {
+        if (!cartStore.open()) {
+            cout << "[WARNING] Can not open " << CartStore::DEFAULT_FILE << ", the cart is not kept after closing"
+                 << endl;
+            return;
+        }
+        int missing = 0;
+        if (!cartStore.resume(CONSOLE_CART, commodityList, cart, &missing)) return;
+        if (missing > 0) {
+            cout << "[WARNING] " << missing << " commodities of your last cart are no longer available" << endl;
+        }
+        if (!cart.empty()) cout << "Your shopping cart of the last visit is restored" << endl;
     }
 
-};
-
-
-
-/*
- * [YOU NEED TO FINISH THIS CLASS]
- * This is a list storing the existing commodity in the store.
- * There are some method which can modify the content.
- * You may use any data structure to complete this class.
- */
-class CommodityList {
-private:
-    vector<Commodity*> commodityList[3];
-    vector<Commodity*>  ::iterator iter;
-
-public:
-
-    CommodityList() {
-        iter = commodityList[0].begin();
+    void saveCart() {
+        if (!cartStore.save(CONSOLE_CART, cart)) {
+            cout << "[WARNING] Fail to save the shopping cart" << endl;
+        }
     }
 
     /*
-     * Print the full information of the commodities inside the list
-     * You must call Commodity.detail() to show the commodity information.
-     * INPUT: None
-     * RETURN: None
+     * The final save only waits for the running checkpoint, and writes again if the list changed after its snapshot.
      */
-    void showCommoditiesDetail() {
-        int time = 0;
-        for(int i = 0 ; i < 3 ; i++ ){
-            if(!commodityList[i].empty() &&  i == 0)cout << "Sound:" <<endl;
-            if(!commodityList[i].empty() && i == 1)cout << "Smartphone:" << endl;
-            if(!commodityList[i].empty() && i == 2)cout << "Laptop:" <<endl;
-            iter = commodityList[i].begin();
-            for(int j=0 ; (iter+j) != commodityList[i].end() ; j++){
-                if(commodityList[i].empty())break;
-                time++;
-                cout << time << " ." <<endl;
-                (*(iter+j))->detail();
-            }
+    void save() {
+        Checkpointer::Result result;
+        checkpointer.wait(result);
+        if (checkpointer.dirty(commodityList)) {
+            checkpointer.start(commodityList);
+            checkpointer.wait(result);
+        }
+        if (result.success) {
+            cout << "save success\n";
+            return;
+        }
+        for (const string& fileName : result.failedFiles) {
+            cout << "[WARNING] Fail to save " << fileName << ", the previous file is kept" << endl;
         }
     }
 
     /*
-     * Print only the commodity name of the commodities inside the list
-     * You don't need to use Commodity.detail() here, just call the Commodity.getName() function is ok
-     * INPUT: None
-     * RETURN: None
+     * Report the checkpoint which finished, and start the next one when the list changed, see Checkpointer.
+     * The list also installs or starts the compaction of its tombstones here.
      */
-    void showCommoditiesName() {
-        int time = 0;
-        for(int i = 0 ; i < 3 ; i++ ){
-            if(!commodityList[i].empty() &&  i == 0)cout << "Sound:" <<endl;
-            if(!commodityList[i].empty() && i == 1)cout << "Smartphone:" << endl;
-            if(!commodityList[i].empty() && i == 2)cout << "Laptop:" <<endl;
-            iter = commodityList[i].begin();
-            for(int j=0 ; (iter+j) != commodityList[i].end() ; j++){
-                if(commodityList[i].empty())break;
-                time++;
-                cout << time << " ." <<endl;
-                cout << (*(iter+j))->getName() << endl;
+    void checkpoint() {
+        Checkpointer::Result result;
+        if (checkpointer.collect(result)) {
+            for (const string& fileName : result.failedFiles) {
+                cout << "[WARNING] Fail to checkpoint " << fileName << ", the previous file is kept" << endl;
             }
         }
+        checkpointer.tick(commodityList);
+        commodityList.maintain();
     }
 
-    /*
-     * Check whether the list is empty or not
-     * INPUT: None
-     * RETURN: Bool. True if the list is empty, otherwise false
-     */
-    bool empty() {
-        if(commodityList->empty())return true;
-        else return false;
-    }
-
-    /*
-     * Return the size(or length) of the list
-     * INPUT: None
-     * RETURN: Integer. List size
-     */
-    int size() {
-        int time = 0;
-        for(int i = 0 ; i < 3 ; i++ ){
-            time = time + commodityList[i].size();
+    void commodityInput() {
+        STORE_TIMED(COMMODITY_INPUT);
+        Commodity* commodityinput;
+        cout << "Which type of commodity you want to add?" << endl;
+        for (int i = 0; i < CategoryRegistry::size(); i++) {
+            cout << (i == 0 ? "" : ", ") << i + 1 << ". " << CategoryRegistry::get(i).label;
         }
-        return time;
-    }
+        cout << endl;
+        int choice = InputHandler::getInput(CategoryRegistry::size(), true);
+        commodityinput = CategoryRegistry::get(choice - 1).create();
+        userSpecifiedCommodity(commodityinput);
+        if( commodityList.isExist(commodityinput) ){
+            cout << "[WARNING] " << commodityinput->getName() << " is exist in the store. If you want to edit it, please "
+                 << "delete it first, or change its price with 9" << endl;
+        } else  commodityList.add(commodityinput , choice-1);
 
+        /*
+         * You should finish this method, because you need to identify the type of commodity, and instantiate a
+         * corresponding derived commodity class here.
+         */
 
-    int Size_index(int index) {
-        if(index == 0) return commodityList[0].size();
-        if(index == 1) return commodityList[1].size();
-        if(index == 2) return commodityList[2].size();
-        return 0;
     }
 
     /*
-     * Return a commodity object at specified position
-     * INPUT: Integer. The index of that commodity
-     * RETURN: Commodity. The wanted commodity object
+     * Ask the manager for every attribute of a new commodity, the questions come from Commodity::inputPrompts.
+     * INPUT: The empty commodity to init
+     * OUTPUT: None
      */
-    Commodity* get(int index) {
-        int time = 0;
-        for(int i = 0 ; i < 3 ; i++ ){
-            iter = commodityList[i].begin();
-            for(int j=0 ; j < commodityList[i].size() ; j++){
-                if(time == index){
-                    return (*(iter+j));
-                }
-                time++;
-            }
-        }
-        return nullptr;
-    }
-
-    int getIndex(int index){
-        int time = 0;
-        for(int i = 0 ; i < 3 ; i++ ){
-            iter = commodityList[i].begin();
-            for(int j=0 ; j < commodityList[i].size() ; j++){
-                if(time == index)   return i;
-                time++;
+    void userSpecifiedCommodity(Commodity* commodity) {
+        for (const InputPrompt& prompt : commodity->inputPrompts()) {
+            cout << prompt.prompt << endl;
+            if (prompt.kind == InputPrompt::TEXT) {
+                commodity->setField(prompt.key, InputHandler::readWholeLine());
+            } else if (prompt.kind == InputPrompt::NUMBER) {
+                commodity->setField(prompt.key, to_string(InputHandler::numberInput()));
+            } else {
+                commodity->setField(prompt.key, to_string(InputHandler::getInput(2)));
             }
         }
-        return 0;
     }
 
     /*
-     * Push a new commodity object into the list
-     * INPUT: Commodity. The object need to be pushed
-     * RETURN: None
+     * The file is parsed in the background, so the manager can go on. The commodities are added by finishImports().
      */
-    void add(Commodity* newCommodity, int index) {
-        commodityList[index].push_back(newCommodity);
-    }
+    void importCommodities() {
+        cout << "Please input the file name(.csv or .jsonl):" << endl;
+        string fileName = InputHandler::readWholeLine();
 
-    /*
-     * Check the input commodity object is existing inside the list
-     * If the commodity name is the same, we take those objects the same object
-     * INPUT: Commodity. The object need to be checked
-     * OUTPUT: Bool. True if the object existing, otherwise false
-     */
-    bool isExist(Commodity* commodity) {
-        for(int i = 0 ; i < 3 ; i++ ){
-            iter = commodityList[i].begin();
-            for(int j=0 ; j < commodityList[i].size() ; j++){
-                if(commodity->getName() == (*(iter+j) )->getName() )return true;
-            }
+        unique_ptr<CatalogImporter::Parsed> parsed(new CatalogImporter::Parsed());
+        if (!CatalogImporter::parse(fileName, *parsed)) {
+            cout << "[WARNING] " << parsed->report.error << endl;
+            return;
         }
-        return false;
+        pendingImports.push_back({fileName, move(parsed)});
+        cout << "Importing " << fileName << " in the background, the commodities are added as it is parsed" << endl;
     }
 
     /*
-     * Remove an object specified by the position
-     * INPUT: Integer. The position of the object which need to be removed
+     * Add the parsed rounds of the imports to the list and print the reports of the finished ones. It runs before
+     * every screen, so the list is only changed by this thread. A round waits here to be added before the next one
+     * is parsed, which keeps a large file from being held in memory.
+     * INPUT: Bool. True to wait for the imports until their whole file is added
      * OUTPUT: None
      */
-    void remove(int index) {
-        int time = 0;
-        for(int i = 0 ; i < 3 ; i++ ){
-            iter = commodityList[i].begin();
-            for(int j=0 ; (iter+j) != commodityList[i].end() ; j++){
-                if(time == index) {
-                    commodityList[i].erase(iter+j);
-                    time++;
-                    break;
-                }
-                time++;
+    void finishImports(bool wait) {
+        for (size_t i = 0; i < pendingImports.size();) {
+            PendingImport& pending = pendingImports[i];
+            bool finished = CatalogImporter::apply(*pending.parsed, commodityList, wait);
+            while (wait && !finished) finished = CatalogImporter::apply(*pending.parsed, commodityList, true);
+            if (!finished) {
+                i++;
+                continue;
             }
+            importReport(pending.fileName, pending.parsed->report);
+            pendingImports.erase(pendingImports.begin() + i);
         }
     }
 
-    void save() {
-        fstream FileOutput ;
-        for(int i = 0 ; i < 3 ; i++){
-            iter = commodityList[i].begin();
-            if( i == 0 )FileOutput.open("SoundCommodity.txt" , ios::out);
-            if( i == 1 )FileOutput.open("SmartphoneCommodity.txt" , ios::out);
-            if( i == 2 )FileOutput.open("LaptopCommodity.txt" , ios::out);
-            while(iter != commodityList[i].end()){
-                (*iter)->save(FileOutput);
-                iter++;
-            }
-            FileOutput.close();
+    void importReport(const string& fileName, const CatalogImporter::Report& report) {
+        double rate = report.seconds > 0 ? report.rows / report.seconds : 0;
+        cout << "Import of " << fileName << " finished: " << report.imported << " added, " << report.duplicated
+             << " already exist, " << report.malformed << " malformed" << endl;
+        cout << report.rows << " rows in " << report.seconds << " seconds (" << (long long) rate << " rows/sec)" << endl;
+        if (!report.badLines.empty()) {
+            cout << "Malformed line:";
+            for (long long line : report.badLines) cout << " " << line;
+            if (report.malformed > (long long) report.badLines.size()) cout << " ...";
+            cout << endl;
         }
-        cout << "save success\n";
-
     }
-};
 
-/*
- * [YOU NEED TO FINISH THIS CLASS]
- * The shopping cart is used to store the commodities user wanted.
- * Because the same name represents the same object, if there is a commodity which have more than one object inside
- * the cart, then it will be store as the same object and the cart must keep the amount of the object.
- * You may use any data structure to complete this class.
- */
-class ShoppingCart {
-private:
-    vector<Commodity*> ShoppingCart_List[3];
-    vector<int> Quantity[3];
-    vector<Commodity*> ::iterator itershop;
-    vector<int> ::iterator iterquan;
-public:
-    ~ShoppingCart() = default;
-    ShoppingCart()  {
-        iterquan = Quantity[0].begin();
-        itershop = ShoppingCart_List[0].begin();
-    }
-    /*
-     * Push an commodity object into the cart.
-     * Be careful that if the input object is existing in the list, then keep the amount of that object rather than
-     * actually push the object into the cart.
-     * INPUT: Commodity. The object need to be pushed.
-     * OUTPUT: None.
-     */
-    void BuildShoppingCart(int first , int second ,int third){
-        ShoppingCart_List[0].resize(first);
-        ShoppingCart_List[1].resize(second);
-        ShoppingCart_List[2].resize(third);
-    }
+    void exportCommodities() {
+        STORE_TIMED(EXPORT);
+        CatalogExporter::Filter filter;
+        cout << "Please input the file name(.csv, .jsonl or .bin):" << endl;
+        string fileName = InputHandler::readWholeLine();
 
-    void push(Commodity* entry , int index) {
-
-        if(index == 0){
-            itershop =  ShoppingCart_List[0].begin() ;
-            iterquan = Quantity[0].begin();
-            for(int i=0 ;(itershop+i) != ShoppingCart_List[0].end() ; i++) {
-                if ( *(itershop+i) == NULL) {
-                    ShoppingCart_List[0].insert((itershop+i), entry);
-                    Quantity[0].insert((iterquan+i), 1);
-                    break;
-                }
-                if ( (*(itershop+i))->getName() == entry->getName()) {
-                    Quantity[0].insert((iterquan+i), (*(iterquan+i) + 1) );
-                    break;
-                }
-            }
-        }
-        if(index == 1){
-            iterquan = Quantity[1].begin();
-            itershop =  ShoppingCart_List[1].begin() ;
-            for(int i=0 ; (itershop+i) != ShoppingCart_List[1].end() ; i++) {
-                if( *(itershop+i) == NULL )  {
-                    ShoppingCart_List[1].insert( (itershop+i) , entry );
-                    Quantity[1].insert((iterquan+i) , 1);
-                    break;
-                }
-                if( (*(itershop+i))->getName() == entry->getName() ) {
-                    Quantity[1].insert( (iterquan+i) , (*(iterquan+i)+1) );
-                    break;
-                }
-            }
-        }
-        if(index == 2){
-            itershop =  ShoppingCart_List[2].begin() ;
-            iterquan = Quantity[2].begin();
-            for(int i=0 ; (itershop+i) != ShoppingCart_List[2].end() ; i++) {
-                if( *(itershop+i) == NULL ) {
-                    ShoppingCart_List[2].insert( (itershop+i) , entry );
-                    Quantity[2].insert((iterquan+i) , 1);
-                    break;
-                }
-                if( (*(itershop+i) )->getName() == entry->getName() ) {
-                    Quantity[2].insert( (iterquan+i) , (*(iterquan+i))+1);
-                    break;
-                }
-            }
+        cout << "Which category do you want to export?" << endl;
+        for (int i = 0; i < CategoryRegistry::size(); i++) {
+            cout << i + 1 << ". " << CategoryRegistry::get(i).label << ", ";
         }
-    }
+        cout << "Or type 0 to export all of them" << endl;
+        filter.category = InputHandler::getInput(CategoryRegistry::size()) - 1;
 
-    /*
-     * Show the content of the cart to user interface.
-     * INPUT: None.
-     * OUTPUT: None.
-     */
-    void showCart() {
-        int time = 0;
-        for(int i = 0 ; i < 3 ; i++ ){
-            if(!ShoppingCart_List[i].empty() &&  i == 0)cout << "Sound:" <<endl;
-            if(!ShoppingCart_List[i].empty() && i == 1)cout << "Smartphone:" << endl;
-            if(!ShoppingCart_List[i].empty() && i == 2)cout << "Laptop:" <<endl;
-            iterquan = Quantity[i].begin();
-            for( itershop = ShoppingCart_List[i].begin() ; itershop != ShoppingCart_List[i].end() ; itershop++){
-                if( *itershop == NULL )break;
-                time++;
-                cout << time <<"." <<endl;
-                (*itershop)->detail(*iterquan);
-                iterquan++;
-            }
+        cout << "Do you want to export only a price range?" << endl
+             << "1. yes, 2. no" << endl;
+        if (InputHandler::getInput(2, true) == 1) {
+            cout << "Please input the lowest price:" << endl;
+            filter.minPrice = InputHandler::numberInput();
+            cout << "Please input the highest price:" << endl;
+            filter.maxPrice = InputHandler::numberInput();
         }
-    }
 
-    /*
-     * Return the cart size. (The same object must be seen as one entry)
-     * INPUT: None.
-     * OUTPUT: Integer. The cart size.
-     */
-    int size() {
-        int Size = 0;
-        for(int i=0 ; i<3 ; i++){
-            Size = Size + ShoppingCart_List[i].size();
+        CatalogExporter::Report report;
+        if (!CatalogExporter::exportTo(fileName, commodityList, filter, report)) {
+            cout << "[WARNING] " << report.error << endl;
+            return;
         }
-        return Size;
-    }
 
-    /*
-     * Remove an entry from the cart. Don't care about the amount of the commodity, just remove it.
-     * INPUT: The order of the entry.
-     * OUTPUT: None.
-     */
-    void remove(int index) {
-        int time = 0;
-        for(int i=0 ;i<3 ; i++){
-            iterquan = Quantity[i].begin();
-            itershop = ShoppingCart_List[i].begin();
-            while(  itershop != ShoppingCart_List[i].end() ){
-                if( (*itershop) == NULL )break;
-                if( time == index ){
-                    ShoppingCart_List[i].erase(itershop);
-                    Quantity[i].erase(iterquan);
-                    time++;
-                    break;
-                }
-                itershop++;
-                iterquan++;
-                time++;
-            }
-        }
+        double rate = report.seconds > 0 ? report.bytes / report.seconds / (1 << 20) : 0;
+        cout << "Export finished: " << report.items << " commodities, " << report.bytes << " bytes in "
+             << report.seconds << " seconds (" << rate << " MB/sec)" << endl;
     }
 
-    /*
-     * Check the total amount of price for the user.
-     * Remember to clear the list after checkout.
-     * INPUT: None.
-     * OUTPUT: Integer. The total price.
-     */
-    int checkOut() {
-        int total=0;
-        for(int i=0 ;i<3 ;i++){
-            itershop = ShoppingCart_List[i].begin();
-            iterquan = Quantity[i].begin();
-            for(int j=0 ; (itershop+j) != ShoppingCart_List[i].end() ;j++){
-                if( *(itershop+j) == NULL)break;
-                total = total + ((*(itershop+j) )->getPrice())*(*(iterquan+j) );
-            }
+    void showMetrics() {
+        if (!StoreMetrics::enabled()) {
+            cout << "The statistics are not collected, build the store with STORE_METRICS=ON to enable them" << endl;
+            return;
         }
-        return total;
-    }
-
-    /*
-     * Check if the cart have nothing inside.
-     * INPUT: None.
-     * OUTPUT: Bool. True if the cart is empty, otherwise false.
-     */
-    bool empty() {
-        if(ShoppingCart_List->empty())return true;
-        else return false;
+        cout << "How do you want to see the statistics?" << endl
+             << "1. text, 2. JSON" << endl;
+        int choice = InputHandler::getInput(2, true);
+        StoreMetrics::instance().dump(cout, choice == 2);
     }
-};
 
-/*
- * [DO NOT MODIFY ANY CODE HERE]
- * The Store class manage the flow of control, and the interface showing to the user.
- * Store use status to choose the interface to show. As the result, status control is very important here.
- * If you can understand the code here, you will have great work on the above two class.
- * The detail of Store is in the README
- */
-class Store {
-private:
-    enum UMode {USER, MANAGER} userStatus;
-    enum SMode {OPENING, DECIDING, SHOPPING, CART_CHECKING, CHECK_OUT, MANAGING, CLOSE} storeStatus;
-    CommodityList commodityList;
-    ShoppingCart cart;
+    void deleteCommodity() {
+        if (commodityList.empty()) {
+            cout << "No commodity inside the store" << endl;
+            return;
+        }
 
+        int choice;
+        cout << "There are existing commodity in our store:" << endl;
+        screen.clear();
+        commodityList.commoditiesName(screen);
+        cout << screen;
+        cout << "Or type 0 to regret" << endl
+             << "Which one do you want to delete?" << endl;
 
+        choice = InputHandler::getInput(commodityList.size());
 
-    void load(){
-        Commodity * fileinput;
-        fstream Fileinput ;
-        int index ;
-        for( int i = 0 ; i < 3 ; i++){
-                if(i == 0){
-                    index = 0;
-                    Fileinput.open("SoundCommodity.txt" , ios::in);
-                    if(Fileinput.is_open()) {
-                        while (!Fileinput.eof()) {
-                            fileinput = new Sound();
-                            fileinput->load(Fileinput);
-                            if (!Fileinput.fail()) {
-                                commodityList.add(fileinput, index);
-                            }
-                        }
-                    }
-                }
-                if(i == 1){
-                    index = 1;
-                    Fileinput.open("SmartphoneCommodity.txt" , ios::in);
-                    if(Fileinput.is_open()){
-                        while(!Fileinput.eof()){
-                            fileinput = new Smartphone();
-                            fileinput->load(Fileinput);
-                            if(!Fileinput.fail()){
-                                commodityList.add(fileinput,index);
-                            }
-                        }
-                    }
-                }
-                if(i == 2){
-                    index = 2;
-                    Fileinput.open("LaptopCommodity.txt" , ios::in);
-                    if(Fileinput.is_open()){
-                        while(!Fileinput.eof()){
-                            fileinput = new Laptop();
-                            fileinput->load(Fileinput);
-                            if(!Fileinput.fail()){
-                                commodityList.add(fileinput,index);
-                            }
-                        }
-                    }
-                }
-                Fileinput.close();
+        if (choice != 0) {
+            // A line of the cart must not outlive its commodity
+            uint64_t id = commodityList.get(choice - 1)->getId();
+            cart.removeId(id);
+            commodityList.removeId(id);
+            boughtTogether.erase(id);
         }
     }
 
-    void commodityInput() {
-        Commodity* commodityinput;
-        cout << "Which type of commodity you want to add?" << endl;
-        cout << "1. Sound, 2. Smartphone, 3. Laptop\n";
-        int choice = InputHandler::getInput(3);
-        if(choice == 1){
-            commodityinput = new Sound();
-            commodityinput ->userSpecifiedCommodity();
+    /*
+     * Delete every commodity whose name is a line of a text file, the list is updated once for the whole file.
+     */
+    void deleteFromFile() {
+        cout << "Please input the file name(one commodity name in a line):" << endl;
+        string fileName = InputHandler::readWholeLine();
+        ifstream file(fileName);
+        if (!file) {
+            cout << "[WARNING] Can not open " << fileName << endl;
+            return;
         }
-        if(choice == 2){
-            commodityinput = new Smartphone();
-            commodityinput->userSpecifiedCommodity();
+
+        vector<string> names;
+        string line;
+        while (getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) names.push_back(line);
         }
-        if(choice == 3){
-            commodityinput = new Laptop();
-            commodityinput->userSpecifiedCommodity();
+        vector<uint64_t> removedIds;
+        int removed = commodityList.removeBatch(names, &removedIds);
+        // A line of the cart must not outlive its commodity
+        for (uint64_t id : removedIds) {
+            cart.removeId(id);
+            boughtTogether.erase(id);
         }
-        if( commodityList.isExist(commodityinput) ){
-            cout << "[WARNING] " << commodityinput->getName() << " is exist in the store. If you want to edit it, please delete it first" << endl;
-        } else  commodityList.add(commodityinput , choice-1);
-
-        /*
-         * You should finish this method, because you need to identify the type of commodity, and instantiate a
-         * corresponding derived commodity class here.
-         */
-
+        cout << removed << " commodities deleted, " << (int) names.size() - removed << " names not found" << endl;
     }
 
-    void deleteCommodity() {
+    /*
+     * Choose a commodity of the list for a manager action.
+     * INPUT: The question to ask
+     * OUTPUT: Commodity. The chosen commodity, or nullptr if the manager regrets
+     */
+    Commodity* chooseForManager(const char* question) {
         if (commodityList.empty()) {
             cout << "No commodity inside the store" << endl;
-            return;
+            return nullptr;
         }
 
-        int choice;
         cout << "There are existing commodity in our store:" << endl;
-        commodityList.showCommoditiesName();
+        screen.clear();
+        commodityList.commoditiesName(screen);
+        cout << screen;
         cout << "Or type 0 to regret" << endl
-             << "Which one do you want to delete?" << endl;
+             << question << endl;
+        int choice = InputHandler::getInput(commodityList.size());
+        return choice == 0 ? nullptr : commodityList.get(choice - 1);
+    }
 
-        choice = InputHandler::getInput(commodityList.size());
+    /*
+     * Change the price of a commodity in place, the change is kept in the price history.
+     */
+    void changePrice() {
+        Commodity* commodity = chooseForManager("Which one do you want to change the price?");
+        if (commodity == nullptr) return;
+
+        cout << "Please input the new price:" << endl;
+        int price = InputHandler::numberInput();
+        // The price before the first change has been in effect since ever
+        uint64_t id = commodity->getId();
+        bool kept = priceHistory.has(id) || priceHistory.append(id, 0, commodity->getPrice());
+        kept = priceHistory.append(id, now(), price) && kept;
+        commodity->setPrice(price);
+        if (!kept) cout << "[WARNING] Fail to save the price change into " << PriceHistory::DEFAULT_FILE << endl;
+        cout << commodity->getName() << " now costs " << price << " dollars" << endl;
+    }
+
+    void showPriceHistory() {
+        Commodity* commodity = chooseForManager("Which one do you want to see the price history?");
+        if (commodity == nullptr) return;
+
+        uint64_t id = commodity->getId();
+        if (!priceHistory.has(id)) {
+            cout << commodity->getName() << " always costs " << commodity->getPrice() << " dollars" << endl;
+            return;
+        }
+        long long monthAgo = now() - MONTH_SECONDS;
+        int before = 0;
+        int lowest = 0;
+        int highest = 0;
+        priceHistory.priceAt(id, monthAgo, before);
+        priceHistory.range(id, monthAgo, now(), lowest, highest);
+        cout << commodity->getName() << " changed its price " << priceHistory.points(id) - 1 << " times" << endl
+             << "It cost " << before << " dollars 30 days ago, and between " << lowest << " and " << highest
+             << " dollars since then" << endl;
+    }
+
+    void showSales() {
+        SalesLog::Report report;
+        salesLog.summarize(now() - MONTH_SECONDS, now() + 1, report, 5);
+        if (report.checkouts == 0) {
+            cout << "Nothing is sold in the last 30 days" << endl;
+            return;
+        }
 
-        if (choice != 0) {
-            commodityList.remove(choice - 1);
+        cout << "In the last 30 days " << report.checkouts << " checkouts bought " << report.items << " items for "
+             << report.revenue << " dollars" << endl;
+        for (int i = 0; i < (int) report.categoryRevenue.size() && i < CategoryRegistry::size(); i++) {
+            cout << CategoryRegistry::get(i).label << ": " << report.categoryRevenue[i] << " dollars" << endl;
+        }
+        cout << "Top sellers:" << endl;
+        for (size_t i = 0; i < report.topSellers.size(); i++) {
+            int category;
+            Commodity* commodity = commodityList.find(report.topSellers[i].first, category);
+            cout << i + 1 << ". " << (commodity != nullptr ? commodity->getName() : "(removed)") << ", "
+                 << report.topSellers[i].second << " sold" << endl;
         }
+        cout << "Items in a checkout:";
+        for (int i = 1; i < SalesLog::BASKET_BUCKETS; i++) {
+            if (report.basketSizes[i] == 0) continue;
+            cout << " " << i << (i == SalesLog::BASKET_BUCKETS - 1 ? "+" : "") << ": " << report.basketSizes[i];
+        }
+        cout << endl;
+    }
+
+    /*
+     * Add items to the stock of a commodity, a commodity whose stock is not counted starts counting from them.
+     */
+    void restockCommodity() {
+        Commodity* commodity = chooseForManager("Which one do you want to restock?");
+        if (commodity == nullptr) return;
+
+        cout << "How many items arrived?" << endl;
+        commodity->restock(InputHandler::numberInput());
+        cout << commodity->getName() << " has " << commodity->getStock() << " in stock" << endl;
     }
 
     void showCommodity() {
@@ -995,7 +591,9 @@ private:
         }
 
         cout << "Here are all commodity in our store:" << endl;
-        commodityList.showCommoditiesDetail();
+        screen.clear();
+        commodityList.commoditiesDetail(screen);
+        cout << screen;
         cout << endl;
     }
 
@@ -1026,38 +624,127 @@ private:
              << "1. Buy the commodity you want" << endl
              << "2. Check your shopping cart" << endl
              << "3. Check out" << endl
+             << "4. Find commodities by their attributes" << endl
              << "Or type 0 to exit user mode" << endl
              << "You may choose what you need:" << endl;
 
-        int choice = InputHandler::getInput(3);
+        int choice = InputHandler::getInput(4);
 
         if (choice == 1) {
-            cart.BuildShoppingCart(commodityList.Size_index(0) , commodityList.Size_index(1) , commodityList.Size_index(2) );
             storeStatus = SMode::SHOPPING;
         } else if (choice == 2) {
             storeStatus = SMode::CART_CHECKING;
         } else if (choice == 3) {
             storeStatus = SMode::CHECK_OUT;
+        } else if (choice == 4) {
+            storeStatus = SMode::BROWSING;
         } else if (choice == 0) {
+            saveCart();
             storeStatus = SMode::OPENING;
         }
     }
 
     void chooseCommodity() {
+        STORE_TIMED(CHOOSE_COMMODITY);
         string input;
+        // The choice is a position of the list as it was shown, even if the list changes meanwhile
+        CommodityList::Pin shown = commodityList.pin();
         showCommodity();
         cout << "Or input 0 to exit shopping" << endl;
 
-        int choice = InputHandler::getInput(commodityList.size());
+        int choice = InputHandler::getInput(shown->size());
 
         // Push the commodity into shopping cart here
         if (choice == 0) {
             storeStatus = SMode::DECIDING;
         } else {
-            // May be some bug here, test later
-            cout<<"check2\n";
-            cart.push(commodityList.get(choice - 1) , commodityList.getIndex(choice-1));
+            Commodity* chosen = shown->get(choice - 1);
+            int category;
+            if (commodityList.find(chosen->getId(), category) != chosen) {
+                cout << "[WARNING] " << chosen->getName() << " is no longer in the store" << endl;
+            } else if (!cart.push(chosen, category)) {
+                cout << "[WARNING] " << chosen->getName() << " is out of stock" << endl;
+            } else {
+                showBoughtTogether(chosen->getId());
+            }
+        }
+    }
+
+    /*
+     * Show the commodities bought most often with a commodity, the removed ones are skipped.
+     */
+    void showBoughtTogether(uint64_t id) {
+        uint64_t ids[BoughtTogether::NEIGHBOURS];
+        int count = boughtTogether.suggest(id, ids, BoughtTogether::NEIGHBOURS);
+        int shown = 0;
+        for (int i = 0; i < count && shown < 3; i++) {
+            int category;
+            Commodity* commodity = commodityList.find(ids[i], category);
+            if (commodity == nullptr) continue;
+            cout << (shown == 0 ? "Customers who bought this also bought: " : ", ") << commodity->getName();
+            shown++;
+        }
+        if (shown != 0) cout << endl;
+    }
+
+    /*
+     * Narrow a category down by the values of its attributes, the count beside a value is the number of commodities
+     * picking it would show. The matching commodities are shown at the end.
+     */
+    void browseCommodities() {
+        storeStatus = SMode::DECIDING;
+        if (facetIndexes.empty()) {
+            for (int i = 0; i < CategoryRegistry::size(); i++) facetIndexes.emplace_back(i);
+        }
+        cout << "Which category do you want to look into?" << endl;
+        for (int i = 0; i < CategoryRegistry::size(); i++) {
+            cout << i + 1 << ". " << CategoryRegistry::get(i).label << ", ";
+        }
+        cout << "Or type 0 to go back" << endl;
+        int category = InputHandler::getInput(CategoryRegistry::size()) - 1;
+        if (category < 0) return;
+
+        FacetIndex& index = facetIndexes[category];
+        index.update(commodityList);
+        vector<vector<int>> picks(index.facetCount());
+        vector<vector<long long>> counts;
+        RoaringBitmap matches;
+        while (true) {
+            index.count(picks, counts, &matches);
+            cout << matches.cardinality() << " " << CategoryRegistry::get(category).label << " commodities match"
+                 << endl;
+            // The number typed for every value shown
+            vector<pair<int, int>> numbers;
+            for (int f = 0; f < index.facetCount(); f++) {
+                const FacetIndex::Facet& facet = index.getFacet(f);
+                string title = facet.key;
+                replace(title.begin(), title.end(), '_', ' ');
+                if (!title.empty()) title[0] = (char) toupper((unsigned char) title[0]);
+                cout << title << ":";
+                for (int v = 0; v < (int) facet.values.size(); v++) {
+                    bool picked = find(picks[f].begin(), picks[f].end(), v) != picks[f].end();
+                    if (counts[f][v] == 0 && !picked) continue;
+                    numbers.emplace_back(f, v);
+                    cout << " " << numbers.size() << ". " << (picked ? "[x] " : "") << facet.values[v] << " ("
+                         << counts[f][v] << ")";
+                }
+                cout << endl;
+            }
+            cout << "Type a number to pick or drop it, or 0 to show the commodities which match" << endl;
+            int choice = InputHandler::getInput((int) numbers.size());
+            if (choice == 0) break;
+            vector<int>& facetPicks = picks[numbers[choice - 1].first];
+            auto picked = find(facetPicks.begin(), facetPicks.end(), numbers[choice - 1].second);
+            if (picked != facetPicks.end()) facetPicks.erase(picked);
+            else facetPicks.push_back(numbers[choice - 1].second);
         }
+
+        vector<uint32_t> shown;
+        matches.values(shown);
+        screen.clear();
+        for (uint32_t i : shown) index.get(i)->detail(screen);
+        index.release();
+        cout << screen << endl;
     }
 
     void showCart() {
@@ -1070,7 +757,9 @@ private:
         int choice;
         do {
             cout << "Here is the current cart content:" << endl;
-            cart.showCart();
+            screen.clear();
+            cart.cartDetail(screen);
+            cout << screen;
             cout<<"CHECK\n";
             cout << "Do you want to delete the entry from the cart?" << endl
                  << "1. yes, 2. no" << endl;
@@ -1100,20 +789,52 @@ private:
     }
 
     void checkOut() {
+        STORE_TIMED(CHECK_OUT);
         if (cart.empty()) {
             cout<<"CHECK\n";
             cout << "Your shopping cart is empty, nothing can checkout" << endl;
         } else {
             cout << "Here is the current cart content:" << endl;
-            cart.showCart();
+            screen.clear();
+            cart.cartDetail(screen);
+            cout << screen;
             cout << "Are you sure you want to buy all of them?" << endl
                  << "1. Yes, sure, 2. No, I want to buy more" << endl;
 
             int choice = InputHandler::getInput(2, true);
 
             if (choice == 1) {
-                int amount = cart.checkOut();
+                vector<string> unavailable;
+                vector<ShoppingCart::SoldLine> sold;
+                int amount = cart.checkOut(&unavailable, &sold);
+                vector<pair<string, int>> applied;
+                promotions.compile(commodityList);
+                amount -= promotions.apply(sold, &applied);
+                if (!sold.empty() && !salesLog.append(now(), sold)) {
+                    cout << "[WARNING] Fail to record the sale in " << SalesLog::DEFAULT_FILE << endl;
+                }
+                vector<uint64_t> ids;
+                for (const ShoppingCart::SoldLine& line : sold) ids.push_back(line.id);
+                boughtTogether.add(ids);
+                for (const string& name : unavailable) {
+                    cout << "[WARNING] " << name << " is sold out, it is not bought" << endl;
+                }
+                for (const pair<string, int>& promotion : applied) {
+                    cout << "Promotion " << promotion.first << ": -" << promotion.second << endl;
+                }
                 cout << "Total Amount: " << amount << endl;
+                if (regional && !sold.empty()) {
+                    CheckoutPricing::Totals totals;
+                    pricing.price(0, sold.data(), sold.size(), totals);
+                    screen.clear();
+                    screen += "Tax: ";
+                    pricing.format(screen, 0, totals.tax);
+                    screen += "\nTo pay in ";
+                    screen += pricing.getName(0);
+                    screen += ": ";
+                    pricing.format(screen, 0, totals.total);
+                    cout << screen << endl;
+                }
                 cout << "Thank you for your coming!" << endl;
                 cout << "------------------------------" << endl << endl;
             }
@@ -1127,10 +848,19 @@ private:
              << "1. Add new commodity" << endl
              << "2. Delete commodity from the commodity list" << endl
              << "3. Show all existing commodity" << endl
+             << "4. Import commodities from a CSV or JSON Lines file" << endl
+             << "5. Export commodities to a CSV, JSON Lines or binary file" << endl
+             << "6. Show the store statistics" << endl
+             << "7. Restock a commodity" << endl
+             << "8. Delete the commodities listed in a file" << endl
+             << "9. Change the price of a commodity" << endl
+             << "10. Show the price history of a commodity" << endl
+             << "11. Show the sales of the last 30 days" << endl
+             << "12. Load the promotions from a JSON Lines file" << endl
              << "Or type 0 to exit manager mode" << endl
              << "Which action do you need?" << endl;
 
-        int choice = InputHandler::getInput(3);
+        int choice = InputHandler::getInput(12);
 
         if (choice == 1) {
             commodityInput();
@@ -1138,18 +868,41 @@ private:
             deleteCommodity();
         } else if (choice == 3) {
             showCommodity();
+        } else if (choice == 4) {
+            importCommodities();
+        } else if (choice == 5) {
+            exportCommodities();
+        } else if (choice == 6) {
+            showMetrics();
+        } else if (choice == 7) {
+            restockCommodity();
+        } else if (choice == 8) {
+            deleteFromFile();
+        } else if (choice == 9) {
+            changePrice();
+        } else if (choice == 10) {
+            showPriceHistory();
+        } else if (choice == 11) {
+            showSales();
+        } else if (choice == 12) {
+            reloadPromotions();
         } else if (choice == 0) {
             storeStatus = SMode::OPENING;
         }
     }
 
     void userInterface() {
+        STORE_TIMED_STATE(storeStatus);
+        finishImports(false);
+        checkpoint();
         if (storeStatus == SMode::OPENING) {
             askMode();
         } else if (storeStatus == SMode::DECIDING) {
             decideService();
         } else if (storeStatus == SMode::SHOPPING) {
             chooseCommodity();
+        } else if (storeStatus == SMode::BROWSING) {
+            browseCommodities();
         } else if (storeStatus == SMode::CART_CHECKING) {
             showCart();
         } else if (storeStatus == SMode::CHECK_OUT) {
@@ -1162,7 +915,8 @@ private:
     }
 
 public:
-    Store() {
+    Store() : checkpointer(CHECKPOINT_INTERVAL), cartStore(CartStore::DEFAULT_FILE),
+              salesLog(SalesLog::DEFAULT_FILE) {
         userStatus = UMode::USER;
         storeStatus = SMode::CLOSE;
     }
@@ -1170,10 +924,20 @@ public:
     void open() {
         storeStatus = SMode::OPENING;
         load();
+        resumeCart();
         while (storeStatus != SMode::CLOSE) {
             userInterface();
         }
-        commodityList.save();
+        // The imports left submit their last rounds, then every background task is finished before the final save
+        finishImports(true);
+        TaskPool::shared().drain();
+        saveCart();
+        save();
+        savePriceHistory();
+        if (StoreMetrics::enabled()) {
+            ofstream metricsFile("StoreMetrics.json");
+            StoreMetrics::instance().dump(metricsFile, true);
+        }
     }
 };
 
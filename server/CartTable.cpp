@@ -0,0 +1,59 @@
+#include "CartTable.h"
+
+using namespace std;
+
+CartTable::CartTable(CommodityList& list, CartStore* store, SalesLog* sales, Promotions* promotions)
+        : list(list), store(store), sales(sales), promotions(promotions), lastExpire(ShoppingCart::Clock::now()) {}
+
+ShoppingCart* CartTable::find(const string& name) {
+    auto found = carts.find(name);
+    if (found != carts.end()) return &found->second;
+    if (store == nullptr) return nullptr;
+    ShoppingCart cart;
+    if (!store->resume(name, list, cart)) return nullptr;
+    return &carts.emplace(name, move(cart)).first->second;
+}
+
+ShoppingCart& CartTable::open(const string& name) {
+    ShoppingCart* cart = find(name);
+    if (cart != nullptr) return *cart;
+    return carts[name];
+}
+
+void CartTable::save(const string& name, ShoppingCart& cart) {
+    if (store != nullptr) store->save(name, cart);
+}
+
+void CartTable::removeCommodity(uint64_t id) {
+    for (auto& cart : carts) {
+        if (cart.second.removeId(id)) save(cart.first, cart.second);
+    }
+}
+
+void CartTable::erase(const string& name) {
+    carts.erase(name);
+    if (store != nullptr) store->erase(name);
+}
+
+int CartTable::checkOut(const string& name, ShoppingCart& cart, vector<string>* unavailable, int* discount) {
+    sold.clear();
+    int total = cart.checkOut(unavailable, &sold);
+    int taken = 0;
+    if (promotions != nullptr) {
+        promotions->compile(list);
+        taken = promotions->apply(sold);
+    }
+    if (discount != nullptr) *discount = taken;
+    if (sales != nullptr && !sold.empty()) {
+        sales->append((long long) chrono::system_clock::to_time_t(chrono::system_clock::now()), sold);
+    }
+    erase(name);
+    return total - taken;
+}
+
+void CartTable::expire() {
+    ShoppingCart::Clock::time_point now = ShoppingCart::Clock::now();
+    if (now - lastExpire < chrono::seconds(1)) return;
+    lastExpire = now;
+    for (auto& cart : carts) cart.second.expire(now);
+}
@@ -0,0 +1,81 @@
+#ifndef STORE_SERVER_CART_TABLE_H
+#define STORE_SERVER_CART_TABLE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../core/StoreCore.h"
+
+/*
+ * CartTable keep the carts of the servers by name, StoreService and RpcService work on the same table when both
+ * servers run in one process. With a CartStore, a cart which is not in memory is resumed from the store when it is
+ * first used, and every change is saved back, so the carts survive a restart and are shared with the console store.
+ * With a SalesLog, every checkout is recorded in it, and with Promotions every checkout gets its discount.
+ * The table is not thread safe, the servers use it under their common lock.
+ */
+class CartTable {
+public:
+    explicit CartTable(CommodityList& list, CartStore* store = nullptr, SalesLog* sales = nullptr,
+                       Promotions* promotions = nullptr);
+
+    /*
+     * Return the cart of name, resumed from the store when it is not in memory.
+     * OUTPUT: ShoppingCart. nullptr if there is no such cart
+     */
+    ShoppingCart* find(const std::string& name);
+
+    /*
+     * Return the cart of name, an empty one is created when there is no such cart.
+     */
+    ShoppingCart& open(const std::string& name);
+
+    /*
+     * Save the cart after it changed, an empty cart is erased from the store.
+     */
+    void save(const std::string& name, ShoppingCart& cart);
+
+    /*
+     * Drop the lines of a commodity from the carts in memory before it is removed from the list. A saved cart which
+     * is not in memory skips the line when it is resumed, because the id is no longer in the list.
+     */
+    void removeCommodity(uint64_t id);
+
+    /*
+     * Forget a cart after its checkout.
+     */
+    void erase(const std::string& name);
+
+    /*
+     * Pay the cart of name, record the lines sold and forget the cart, see ShoppingCart::checkOut.
+     * INPUT: The cart name, the cart, the vector to receive the names which are not sold (option), and the integer to
+     * receive the discount (option)
+     * OUTPUT: Integer. The total price, after the discount
+     */
+    int checkOut(const std::string& name, ShoppingCart& cart, std::vector<std::string>* unavailable = nullptr,
+                 int* discount = nullptr);
+
+    /*
+     * Return the lines sold by the last checkOut(), with their discount.
+     */
+    const std::vector<ShoppingCart::SoldLine>& lastSold() const {
+        return sold;
+    }
+
+    /*
+     * Give back the expired reservations of every cart in memory, so an abandoned cart does not keep its items.
+     * It is cheap to call before every request, the carts are only walked once a second.
+     */
+    void expire();
+
+private:
+    CommodityList& list;
+    CartStore* store;
+    SalesLog* sales;
+    Promotions* promotions;
+    std::vector<ShoppingCart::SoldLine> sold;
+    std::unordered_map<std::string, ShoppingCart> carts;
+    ShoppingCart::Clock::time_point lastExpire;
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include "HttpServer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+
+using namespace std;
+
+namespace {
+
+    const size_t MAX_HEADER = 16 << 10;
+    const size_t MAX_BODY = 1 << 20;
+
+    const char* reason(int status) {
+        switch (status) {
+            case 200: return "OK";
+            case 201: return "Created";
+            case 400: return "Bad Request";
+            case 404: return "Not Found";
+            case 405: return "Method Not Allowed";
+            case 409: return "Conflict";
+            case 413: return "Payload Too Large";
+            case 431: return "Request Header Fields Too Large";
+            case 501: return "Not Implemented";
+            case 505: return "HTTP Version Not Supported";
+            default: return "Internal Server Error";
+        }
+    }
+
+    bool is(const char* begin, const char* end, const char* text) {
+        size_t length = strlen(text);
+        return (size_t) (end - begin) == length && strncasecmp(begin, text, length) == 0;
+    }
+
+    bool contains(const char* begin, const char* end, const char* text) {
+        size_t length = strlen(text);
+        for (const char* p = begin; p + length <= end; p++) {
+            if (strncasecmp(p, text, length) == 0) return true;
+        }
+        return false;
+    }
+
+    int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    /*
+     * Decode a query component, "%XX" is a byte and '+' is a space.
+     */
+    void decode(const char* p, const char* end, string& out) {
+        out.clear();
+        for (; p < end; p++) {
+            if (*p == '+') {
+                out += ' ';
+            } else if (*p == '%' && end - p >= 3 && hexValue(p[1]) >= 0 && hexValue(p[2]) >= 0) {
+                out += (char) (hexValue(p[1]) * 16 + hexValue(p[2]));
+                p += 2;
+            } else {
+                out += *p;
+            }
+        }
+    }
+}
+
+bool HttpRequest::parameter(const string& name, string& value) const {
+    size_t start = 0;
+    while (start < query.size()) {
+        size_t end = query.find('&', start);
+        if (end == string::npos) end = query.size();
+        size_t equal = query.find('=', start);
+        size_t keyEnd = (equal != string::npos && equal < end) ? equal : end;
+        if (keyEnd - start == name.size() && query.compare(start, name.size(), name) == 0) {
+            value.clear();
+            if (keyEnd < end) decode(query.data() + keyEnd + 1, query.data() + end, value);
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+HttpServer::HttpServer(Handler handler) : handler(move(handler)) {}
+
+bool HttpServer::parse(Connection& connection) {
+    string& input = connection.input;
+    size_t offset = 0;
+    bool valid = true;
+    while (!connection.closing) {
+        size_t headerEnd = input.find("\r\n\r\n", offset);
+        if (headerEnd == string::npos) {
+            if (input.size() - offset > MAX_HEADER) valid = fail(connection, 431);
+            break;
+        }
+        const char* p = input.data() + offset;
+        const char* end = input.data() + headerEnd;
+        const char* lineEnd = (const char*) memchr(p, '\r', end - p);
+        if (lineEnd == nullptr) lineEnd = end;
+        const char* methodEnd = (const char*) memchr(p, ' ', lineEnd - p);
+        const char* targetEnd = methodEnd == nullptr ? nullptr :
+                                (const char*) memchr(methodEnd + 1, ' ', lineEnd - methodEnd - 1);
+        if (targetEnd == nullptr || methodEnd == p || targetEnd == methodEnd + 1) {
+            valid = fail(connection, 400);
+            break;
+        }
+        bool http11 = is(targetEnd + 1, lineEnd, "HTTP/1.1");
+        if (!http11 && !is(targetEnd + 1, lineEnd, "HTTP/1.0")) {
+            valid = fail(connection, 505);
+            break;
+        }
+
+        bool keepAlive = http11;
+        size_t contentLength = 0;
+        int status = 0;
+        for (const char* line = lineEnd + 2; line < end && status == 0;) {
+            const char* next = (const char*) memchr(line, '\r', end - line);
+            if (next == nullptr) next = end;
+            const char* colon = (const char*) memchr(line, ':', next - line);
+            if (colon == nullptr) {
+                status = 400;
+                break;
+            }
+            const char* value = colon + 1;
+            while (value < next && (*value == ' ' || *value == '\t')) value++;
+            if (is(line, colon, "Content-Length")) {
+                contentLength = 0;
+                if (value == next) status = 400;
+                for (const char* digit = value; digit < next && status == 0; digit++) {
+                    if (!isdigit((unsigned char) *digit)) status = 400;
+                    else contentLength = contentLength * 10 + (*digit - '0');
+                    if (contentLength > MAX_BODY) status = 413;
+                }
+            } else if (is(line, colon, "Connection")) {
+                if (contains(value, next, "close")) keepAlive = false;
+                else if (contains(value, next, "keep-alive")) keepAlive = true;
+            } else if (is(line, colon, "Transfer-Encoding")) {
+                status = 501;
+            }
+            line = next + 2;
+        }
+        if (status != 0) {
+            valid = fail(connection, status);
+            break;
+        }
+
+        size_t bodyStart = headerEnd + 4;
+        if (input.size() - bodyStart < contentLength) break;
+        request.method.assign(p, methodEnd);
+        const char* question = (const char*) memchr(methodEnd + 1, '?', targetEnd - methodEnd - 1);
+        request.path.assign(methodEnd + 1, question == nullptr ? targetEnd : question);
+        if (question == nullptr) request.query.clear();
+        else request.query.assign(question + 1, targetEnd);
+        request.body.assign(input, bodyStart, contentLength);
+        offset = bodyStart + contentLength;
+
+        response.status = 200;
+        response.contentType = "application/json";
+        response.body.clear();
+        handler(request, response);
+        respond(connection, keepAlive, http11);
+        if (!keepAlive) connection.closing = true;
+    }
+    input.erase(0, offset);
+    return valid;
+}
+
+bool HttpServer::fail(Connection& connection, int status) {
+    response.status = status;
+    response.contentType = "application/json";
+    response.body = string("{\"error\":\"") + reason(status) + "\"}";
+    respond(connection, false, true);
+    return false;
+}
+
+void HttpServer::respond(Connection& connection, bool keepAlive, bool http11) {
+    const char* connectionHeader = "";
+    if (!keepAlive) connectionHeader = "Connection: close\r\n";
+    else if (!http11) connectionHeader = "Connection: keep-alive\r\n";
+    char head[256];
+    int length = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%s\r\n",
+                          response.status, reason(response.status), response.contentType, response.body.size(),
+                          connectionHeader);
+    connection.output.append(head, (size_t) length);
+    connection.output += response.body;
+}
+
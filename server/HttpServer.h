@@ -0,0 +1,68 @@
+#ifndef STORE_SERVER_HTTP_SERVER_H
+#define STORE_SERVER_HTTP_SERVER_H
+
+#include <functional>
+#include <string>
+
+#include "SocketServer.h"
+
+/*
+ * One parsed HTTP request. The object is reused for every request, so its strings keep the capacity they reached.
+ * ATTRIBUTE:
+ *  method: "GET", "POST", ...
+ *  path: The target before '?', still percent encoded.
+ *  query: The target after '?', or empty.
+ *  body: The request body, only Content-Length bodies are accepted.
+ */
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    std::string query;
+    std::string body;
+
+    /*
+     * Return the decoded value of a query parameter.
+     * INPUT: The parameter name, and the string to store the value
+     * OUTPUT: Bool. False if the parameter is not in the query
+     */
+    bool parameter(const std::string& name, std::string& value) const;
+};
+
+/*
+ * The response a handler fills, the server adds the status line and the headers.
+ */
+struct HttpResponse {
+    int status = 200;
+    const char* contentType = "application/json";
+    std::string body;
+};
+
+/*
+ * HttpServer speaks HTTP/1.1 on the SocketServer loop. Connections are kept alive and requests may be pipelined:
+ * every complete request inside the read buffer is handled in order, and the responses are written together.
+ * The handler runs on the loop thread, so it needs no locking against itself.
+ */
+class HttpServer : public SocketServer {
+public:
+    typedef std::function<void(const HttpRequest&, HttpResponse&)> Handler;
+
+    explicit HttpServer(Handler handler);
+
+protected:
+    bool parse(Connection& connection) override;
+
+private:
+    Handler handler;
+    // The request and the response are reused, only one request is handled at a time
+    HttpRequest request;
+    HttpResponse response;
+
+    /*
+     * Write an error response and mark the connection to be closed, it always return false.
+     */
+    bool fail(Connection& connection, int status);
+
+    void respond(Connection& connection, bool keepAlive, bool http11);
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "RpcClient.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+void RpcBatch::clear() {
+    frame.assign(8, '\0');
+    opcodes.clear();
+}
+
+void RpcBatch::get(int position) {
+    RpcWriter writer(frame);
+    writer.putByte(Rpc::GET);
+    writer.putInt((uint32_t) position);
+    opcodes.push_back(Rpc::GET);
+}
+
+void RpcBatch::isExist(const string& name) {
+    RpcWriter writer(frame);
+    writer.putByte(Rpc::EXISTS);
+    writer.putString(name);
+    opcodes.push_back(Rpc::EXISTS);
+}
+
+void RpcBatch::add(Commodity* commodity, int category) {
+    RpcWriter writer(frame);
+    writer.putByte(Rpc::ADD);
+    writer.putCommodity(commodity, category);
+    opcodes.push_back(Rpc::ADD);
+}
+
+void RpcBatch::remove(int position) {
+    RpcWriter writer(frame);
+    writer.putByte(Rpc::REMOVE);
+    writer.putInt((uint32_t) position);
+    opcodes.push_back(Rpc::REMOVE);
+}
+
+void RpcBatch::catalogSize() {
+    RpcWriter writer(frame);
+    writer.putByte(Rpc::SIZE);
+    opcodes.push_back(Rpc::SIZE);
+}
+
+void RpcBatch::push(const string& cart, int position, int quantity) {
+    RpcWriter writer(frame);
+    writer.putByte(Rpc::PUSH);
+    writer.putString(cart);
+    writer.putInt((uint32_t) position);
+    writer.putInt((uint32_t) quantity);
+    opcodes.push_back(Rpc::PUSH);
+}
+
+void RpcBatch::checkOut(const string& cart) {
+    RpcWriter writer(frame);
+    writer.putByte(Rpc::CHECKOUT);
+    writer.putString(cart);
+    opcodes.push_back(Rpc::CHECKOUT);
+}
+
+RpcClient::~RpcClient() {
+    close();
+}
+
+bool RpcClient::connect(const string& path, string& error) {
+    close();
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        error = path + " is too long for a socket path";
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+        error = "Can not connect to " + path + ", " + strerror(errno);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void RpcClient::close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+bool RpcClient::call(RpcBatch& batch, vector<RpcResult>& results) {
+    if (fd < 0) return false;
+    string& frame = batch.frame;
+    uint32_t length = (uint32_t) (frame.size() - 4);
+    uint32_t count = (uint32_t) batch.opcodes.size();
+    for (int i = 0; i < 4; i++) {
+        frame[i] = (char) ((length >> (8 * i)) & 0xFF);
+        frame[4 + i] = (char) ((count >> (8 * i)) & 0xFF);
+    }
+    for (size_t sent = 0; sent < frame.size();) {
+        ssize_t written = send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            close();
+            return false;
+        }
+        sent += (size_t) written;
+    }
+
+    if (!receive(4)) return false;
+    RpcReader header(response.data(), 4);
+    uint32_t responseLength = header.getInt();
+    if (responseLength > Rpc::MAX_FRAME || !receive(responseLength)) {
+        close();
+        return false;
+    }
+
+    RpcReader reader(response.data(), response.size());
+    if (reader.getInt() != count) {
+        close();
+        return false;
+    }
+    results.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        RpcResult& result = results[i];
+        result.status = (int) reader.getByte();
+        result.value = 0;
+        result.commodity.reset();
+        result.category = -1;
+        if (result.status != Rpc::OK) continue;
+        switch (batch.opcodes[i]) {
+            case Rpc::GET:
+                result.commodity.reset(reader.getCommodity(result.category));
+                break;
+            case Rpc::EXISTS:
+                result.value = (int) reader.getByte();
+                break;
+            case Rpc::REMOVE:
+                break;
+            default:
+                result.value = (int) reader.getInt();
+        }
+    }
+    if (!reader.ok() || !reader.atEnd()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool RpcClient::receive(size_t length) {
+    response.resize(length);
+    for (size_t received = 0; received < length;) {
+        ssize_t size = recv(fd, &response[received], length - received, 0);
+        if (size < 0 && errno == EINTR) continue;
+        if (size <= 0) {
+            close();
+            return false;
+        }
+        received += (size_t) size;
+    }
+    return true;
+}
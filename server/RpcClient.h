@@ -0,0 +1,105 @@
+#ifndef STORE_SERVER_RPC_CLIENT_H
+#define STORE_SERVER_RPC_CLIENT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "RpcProtocol.h"
+
+/*
+ * RpcBatch collect operations to send in one frame, the methods mirror CommodityList and ShoppingCart.
+ * Positions are 0-based like CommodityList::get. The batch can be cleared and refilled, it keeps its capacity.
+ */
+class RpcBatch {
+public:
+    RpcBatch() {
+        clear();
+    }
+
+    void clear();
+
+    /*
+     * The number of operations inside the batch
+     */
+    int size() {
+        return (int) opcodes.size();
+    }
+
+    void get(int position);
+
+    void isExist(const std::string& name);
+
+    /*
+     * The commodity is only encoded, the caller keeps it.
+     */
+    void add(Commodity* commodity, int category);
+
+    void remove(int position);
+
+    void catalogSize();
+
+    void push(const std::string& cart, int position, int quantity = 1);
+
+    void checkOut(const std::string& cart);
+
+private:
+    friend class RpcClient;
+    // The frame: u32 length, u32 count and the operations, the two numbers are filled by RpcClient::call
+    std::string frame;
+    std::vector<unsigned char> opcodes;
+};
+
+/*
+ * The result of one operation of a batch.
+ * ATTRIBUTE:
+ *  status: Rpc::Status, the other fields are only set when it is Rpc::OK.
+ *  value: 1 or 0 for isExist, the position for add, the size for catalogSize, the cart lines for push and the total
+ *         for checkOut.
+ *  commodity, category: The commodity returned by get.
+ */
+struct RpcResult {
+    int status = Rpc::OK;
+    int value = 0;
+    std::unique_ptr<Commodity> commodity;
+    int category = -1;
+};
+
+/*
+ * RpcClient is a blocking connection to RpcServer on a Unix socket. One client is used by one thread at a time,
+ * threads which run at the same time open their own clients.
+ */
+class RpcClient {
+public:
+    RpcClient() = default;
+
+    RpcClient(const RpcClient&) = delete;
+
+    RpcClient& operator=(const RpcClient&) = delete;
+
+    ~RpcClient();
+
+    /*
+     * INPUT: The socket path, and the string to store the reason of a failure
+     * OUTPUT: Bool. False if the server can not be reached
+     */
+    bool connect(const std::string& path, std::string& error);
+
+    /*
+     * Send the batch in one frame and wait for its results, one per operation in the same order.
+     * INPUT: The batch, and the vector to store the results
+     * OUTPUT: Bool. False if the connection is broken or the response is malformed, the client is closed then
+     */
+    bool call(RpcBatch& batch, std::vector<RpcResult>& results);
+
+    void close();
+
+private:
+    int fd = -1;
+    std::string response;
+
+    bool receive(size_t length);
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "RpcProtocol.h"
+
+using namespace std;
+
+namespace {
+
+    class RecordWriter : public FieldVisitor {
+    private:
+        RpcWriter& writer;
+
+    public:
+        explicit RecordWriter(RpcWriter& writer) : writer(writer) {}
+
+        void field(const char*, const string& value) override {
+            writer.putByte('s');
+            writer.putString(value);
+        }
+
+        void field(const char*, int value) override {
+            writer.putByte('i');
+            writer.putInt((uint32_t) value);
+        }
+    };
+
+    class FieldNames : public FieldVisitor {
+    public:
+        vector<string> names;
+
+        void field(const char* key, const string&) override {
+            names.push_back(key);
+        }
+
+        void field(const char* key, int) override {
+            names.push_back(key);
+        }
+    };
+
+    /*
+     * The attribute names of every category in visitFields() order, a record carries only the values.
+     */
+    const vector<vector<string>>& fieldNames() {
+        static const vector<vector<string>> names = []() {
+            vector<vector<string>> result;
+            for (int i = 0; i < CategoryRegistry::size(); i++) {
+                Commodity* commodity = CategoryRegistry::get(i).create();
+                FieldNames visitor;
+                commodity->visitFields(visitor);
+                result.push_back(visitor.names);
+                delete commodity;
+            }
+            return result;
+        }();
+        return names;
+    }
+}
+
+void RpcWriter::putCommodity(Commodity* commodity, int category) {
+    putInt((uint32_t) category, 2);
+    RecordWriter visitor(*this);
+    commodity->visitFields(visitor);
+}
+
+void RpcReader::getString(string& text) {
+    uint32_t length = getInt();
+    if ((uint32_t) (end - p) < length) {
+        valid = false;
+        p = end;
+        text.clear();
+        return;
+    }
+    text.assign((const char*) p, length);
+    p += length;
+}
+
+Commodity* RpcReader::getCommodity(int& category) {
+    category = (int) getInt(2);
+    if (!valid || category >= CategoryRegistry::size()) {
+        valid = false;
+        return nullptr;
+    }
+    Commodity* commodity = CategoryRegistry::get(category).create();
+    bool accepted = true;
+    string value;
+    // Every value is read even after one is refused, so the next operation starts at the right byte
+    for (const string& name : fieldNames()[category]) {
+        unsigned type = getByte();
+        if (type == 's') getString(value);
+        else if (type == 'i') value = to_string((int) getInt());
+        else valid = false;
+        if (!valid) break;
+        if (!commodity->setField(name, value)) accepted = false;
+    }
+    if (!valid || !accepted) {
+        delete commodity;
+        return nullptr;
+    }
+    return commodity;
+}
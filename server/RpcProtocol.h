@@ -0,0 +1,129 @@
+#ifndef STORE_SERVER_RPC_PROTOCOL_H
+#define STORE_SERVER_RPC_PROTOCOL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../core/Commodity.h"
+
+/*
+ * The binary protocol between RpcServer and RpcClient. Every integer is little endian.
+ * A frame is a u32 payload length and the payload. A request payload is a u32 operation count and the operations,
+ * each one is a u8 opcode and its arguments, so one frame can carry a whole batch. The response payload is a u32
+ * count and one result per operation, in the same order: a u8 status, and the value when the status is OK.
+ * A string is a u32 length and the bytes. A commodity is a u16 category and its attributes in visitFields() order,
+ * each one 's' and a string or 'i' and an i32, which is the record of the .bin export.
+ *  GET       i32 position                             -> commodity
+ *  EXISTS    string name                              -> u8 1 if a commodity has that name, otherwise 0
+ *  ADD       commodity                                -> i32 position, DUPLICATE if the name is taken
+ *  REMOVE    i32 position                             -> nothing
+ *  SIZE                                               -> i32 number of commodities
+ *  PUSH      string cart, i32 position, i32 quantity  -> i32 lines of the cart, OUT_OF_STOCK if the items can not
+ *                                                        be reserved
+ *  CHECKOUT  string cart                              -> i32 total price, the cart is emptied and the lines whose
+ *                                                        stock is gone are not paid
+ * Positions are 0-based like CommodityList::get. A malformed frame closes the connection.
+ */
+struct Rpc {
+    enum Opcode {GET = 1, EXISTS, ADD, REMOVE, SIZE, PUSH, CHECKOUT};
+    enum Status {OK = 0, NOT_FOUND, DUPLICATE, BAD_ARGUMENT, OUT_OF_STOCK};
+
+    static const uint32_t MAX_FRAME = 16 << 20;
+};
+
+/*
+ * RpcWriter append the protocol values to a string.
+ */
+class RpcWriter {
+private:
+    std::string& out;
+
+public:
+    explicit RpcWriter(std::string& out) : out(out) {}
+
+    void putByte(unsigned value) {
+        out.push_back((char) value);
+    }
+
+    void putInt(uint32_t value, int bytes = 4) {
+        for (int i = 0; i < bytes; i++) out.push_back((char) ((value >> (8 * i)) & 0xFF));
+    }
+
+    void putString(const std::string& text) {
+        putInt((uint32_t) text.size());
+        out += text;
+    }
+
+    void putCommodity(Commodity* commodity, int category);
+
+    /*
+     * Reserve the u32 length of a frame, and fill it once the payload is written.
+     * RETURN: The offset of the frame inside out
+     */
+    size_t beginFrame() {
+        size_t start = out.size();
+        putInt(0);
+        return start;
+    }
+
+    void endFrame(size_t start) {
+        uint32_t length = (uint32_t) (out.size() - start - 4);
+        for (int i = 0; i < 4; i++) out[start + i] = (char) ((length >> (8 * i)) & 0xFF);
+    }
+};
+
+/*
+ * RpcReader take the protocol values out of a payload. A read past the end returns zero values and marks the reader
+ * as failed, so a whole operation can be read before checking ok().
+ */
+class RpcReader {
+private:
+    const unsigned char* p;
+    const unsigned char* end;
+    bool valid = true;
+
+public:
+    RpcReader(const char* begin, size_t length)
+            : p((const unsigned char*) begin), end((const unsigned char*) begin + length) {}
+
+    bool ok() {
+        return valid;
+    }
+
+    bool atEnd() {
+        return p == end;
+    }
+
+    unsigned getByte() {
+        if (p >= end) {
+            valid = false;
+            return 0;
+        }
+        return *p++;
+    }
+
+    uint32_t getInt(int bytes = 4) {
+        if (end - p < bytes) {
+            valid = false;
+            p = end;
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < bytes; i++) value |= (uint32_t) p[i] << (8 * i);
+        p += bytes;
+        return value;
+    }
+
+    void getString(std::string& text);
+
+    /*
+     * Read a commodity record into a new object of its category.
+     * INPUT: The int to store the category index
+     * OUTPUT: The new commodity, owned by the caller. nullptr if a value is refused by setField, or if the record is
+     *         cut or has an unknown category, then ok() is false as well
+     */
+    Commodity* getCommodity(int& category);
+};
+
+#endif
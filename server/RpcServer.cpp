@@ -0,0 +1,33 @@
+#include "RpcServer.h"
+
+#include "RpcProtocol.h"
+
+using namespace std;
+
+RpcServer::RpcServer(Handler handler) : handler(move(handler)) {}
+
+bool RpcServer::parse(Connection& connection) {
+    string& input = connection.input;
+    size_t offset = 0;
+    bool valid = true;
+    while (input.size() - offset >= 4) {
+        RpcReader header(input.data() + offset, 4);
+        uint32_t length = header.getInt();
+        if (length > Rpc::MAX_FRAME) {
+            valid = false;
+            break;
+        }
+        if (input.size() - offset - 4 < length) break;
+        RpcWriter writer(connection.output);
+        size_t frame = writer.beginFrame();
+        if (!handler(input.data() + offset + 4, length, connection.output)) {
+            connection.output.resize(frame);
+            valid = false;
+            break;
+        }
+        writer.endFrame(frame);
+        offset += 4 + length;
+    }
+    input.erase(0, offset);
+    return valid;
+}
@@ -0,0 +1,31 @@
+#ifndef STORE_SERVER_RPC_SERVER_H
+#define STORE_SERVER_RPC_SERVER_H
+
+#include <functional>
+#include <string>
+
+#include "SocketServer.h"
+
+/*
+ * RpcServer cut the length prefixed frames of the binary protocol out of the SocketServer loop, see RpcProtocol.h.
+ * Every complete frame is passed to the handler, which append the response payload. Frames may be pipelined and the
+ * responses keep their order.
+ */
+class RpcServer : public SocketServer {
+public:
+    /*
+     * INPUT: The request payload and its length, and the string to append the response payload to
+     * OUTPUT: Bool. False if the payload is malformed, the connection is then closed
+     */
+    typedef std::function<bool(const char*, size_t, std::string&)> Handler;
+
+    explicit RpcServer(Handler handler);
+
+protected:
+    bool parse(Connection& connection) override;
+
+private:
+    Handler handler;
+};
+
+#endif
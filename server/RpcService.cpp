@@ -0,0 +1,111 @@
+#include "RpcService.h"
+
+using namespace std;
+
+namespace {
+
+    const size_t MAX_CART_NAME = 64;
+    const int MAX_QUANTITY = 1000;
+}
+
+RpcService::RpcService(CommodityList& list, CartTable& carts) : list(list), carts(carts) {}
+
+bool RpcService::handle(const char* payload, size_t length, string& out) {
+    RpcReader reader(payload, length);
+    RpcWriter writer(out);
+    uint32_t count = reader.getInt();
+    writer.putInt(count);
+    // A read past the end returns zeros, so the arguments are checked once per operation and the frame is dropped
+    for (uint32_t i = 0; i < count && reader.ok(); i++) {
+        switch (reader.getByte()) {
+            case Rpc::GET: {
+                int position = (int) reader.getInt();
+                if (!validPosition(position)) {
+                    writer.putByte(Rpc::NOT_FOUND);
+                    break;
+                }
+                writer.putByte(Rpc::OK);
+                writer.putCommodity(list.get(position), list.getIndex(position));
+                break;
+            }
+            case Rpc::EXISTS: {
+                reader.getString(text);
+                writer.putByte(Rpc::OK);
+                writer.putByte(list.isExist(text) ? 1 : 0);
+                break;
+            }
+            case Rpc::ADD: {
+                int category;
+                Commodity* commodity = reader.getCommodity(category);
+                if (commodity == nullptr) {
+                    writer.putByte(Rpc::BAD_ARGUMENT);
+                } else if (list.isExist(commodity)) {
+                    delete commodity;
+                    writer.putByte(Rpc::DUPLICATE);
+                } else {
+                    list.add(commodity, category);
+                    writer.putByte(Rpc::OK);
+                    writer.putInt((uint32_t) lastPosition(category));
+                }
+                break;
+            }
+            case Rpc::REMOVE: {
+                int position = (int) reader.getInt();
+                if (!validPosition(position)) {
+                    writer.putByte(Rpc::NOT_FOUND);
+                    break;
+                }
+                carts.removeCommodity(list.get(position)->getId());
+                list.remove(position);
+                writer.putByte(Rpc::OK);
+                break;
+            }
+            case Rpc::SIZE:
+                writer.putByte(Rpc::OK);
+                writer.putInt((uint32_t) list.size());
+                break;
+            case Rpc::PUSH: {
+                reader.getString(text);
+                int position = (int) reader.getInt();
+                int quantity = (int) reader.getInt();
+                if (text.empty() || text.size() > MAX_CART_NAME || quantity < 1 || quantity > MAX_QUANTITY) {
+                    writer.putByte(Rpc::BAD_ARGUMENT);
+                    break;
+                }
+                if (!validPosition(position)) {
+                    writer.putByte(Rpc::NOT_FOUND);
+                    break;
+                }
+                Commodity* commodity = list.get(position);
+                int category = list.getIndex(position);
+                ShoppingCart& cart = carts.open(text);
+                if (!cart.push(commodity, category, quantity)) {
+                    writer.putByte(Rpc::OUT_OF_STOCK);
+                    break;
+                }
+                carts.save(text, cart);
+                writer.putByte(Rpc::OK);
+                writer.putInt((uint32_t) cart.size());
+                break;
+            }
+            case Rpc::CHECKOUT: {
+                reader.getString(text);
+                ShoppingCart* found = carts.find(text);
+                int total = 0;
+                if (found != nullptr) total = carts.checkOut(text, *found);
+                writer.putByte(Rpc::OK);
+                writer.putInt((uint32_t) total);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return reader.ok() && reader.atEnd();
+}
+
+int RpcService::lastPosition(int category) {
+    int position = -1;
+    for (int i = 0; i <= category; i++) position += list.Size_index(i);
+    return position;
+}
@@ -0,0 +1,42 @@
+#ifndef STORE_SERVER_RPC_SERVICE_H
+#define STORE_SERVER_RPC_SERVICE_H
+
+#include <string>
+
+#include "../core/StoreCore.h"
+#include "CartTable.h"
+#include "RpcProtocol.h"
+
+/*
+ * RpcService run the operations of one binary request frame against CommodityList and the carts, see RpcProtocol.h.
+ * The operations of a frame are run in order and each one gets its own status, so a batch may partly fail.
+ * The service is not thread safe, RpcServer calls it from its loop thread only.
+ */
+class RpcService {
+public:
+    RpcService(CommodityList& list, CartTable& carts);
+
+    /*
+     * Run one request payload.
+     * INPUT: The payload and its length, and the string to append the response payload to
+     * OUTPUT: Bool. False if the payload is malformed
+     */
+    bool handle(const char* payload, size_t length, std::string& out);
+
+private:
+    CommodityList& list;
+    CartTable& carts;
+    // Scratch space reused by every operation
+    std::string text;
+
+    bool validPosition(int position) {
+        return position >= 0 && position < list.size();
+    }
+
+    /*
+     * The position of the last commodity of a category, where add() put a new one.
+     */
+    int lastPosition(int category);
+};
+
+#endif
@@ -0,0 +1,209 @@
+#include "SocketServer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+    const size_t READ_SIZE = 64 << 10;
+    // A connection with more pending output than this is not read until the client catches up
+    const size_t MAX_PENDING_OUTPUT = 4 << 20;
+
+    bool reuseAddress(int fd) {
+        int on = 1;
+        return setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == 0;
+    }
+}
+
+SocketServer::SocketServer() : running(true) {
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+SocketServer::~SocketServer() {
+    for (auto& connection : connections) ::close(connection.first);
+    if (listener >= 0) ::close(listener);
+    if (wakeup >= 0) ::close(wakeup);
+    if (epoll >= 0) ::close(epoll);
+    if (!unixPath.empty()) unlink(unixPath.c_str());
+}
+
+bool SocketServer::listenTcp(const string& host, int port, string& error) {
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t) port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+        error = host + " is not an IPv4 address";
+        return false;
+    }
+    listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener < 0 || !reuseAddress(listener) || bind(listener, (sockaddr*) &address, sizeof(address)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0) {
+        error = string("Can not listen on ") + host + ":" + to_string(port) + ", " + strerror(errno);
+        return false;
+    }
+    socklen_t length = sizeof(address);
+    getsockname(listener, (sockaddr*) &address, &length);
+    boundPort = ntohs(address.sin_port);
+    return true;
+}
+
+bool SocketServer::listenUnix(const string& path, string& error) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        error = path + " is too long for a socket path";
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    unlink(path.c_str());
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener < 0 || bind(listener, (sockaddr*) &address, sizeof(address)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0) {
+        error = "Can not listen on " + path + ", " + strerror(errno);
+        return false;
+    }
+    unixPath = path;
+    return true;
+}
+
+bool SocketServer::run() {
+    if (epoll < 0 || wakeup < 0 || listener < 0) return false;
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+    event.data.fd = wakeup;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, wakeup, &event);
+
+    epoll_event events[256];
+    while (running.load()) {
+        int ready = epoll_wait(epoll, events, 256, -1);
+        if (ready < 0 && errno != EINTR) return false;
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listener) {
+                accept();
+                continue;
+            }
+            if (fd == wakeup) {
+                uint64_t value;
+                while (::read(wakeup, &value, sizeof(value)) > 0) {}
+                continue;
+            }
+            auto found = connections.find(fd);
+            if (found == connections.end()) continue;
+            Connection& connection = found->second;
+            if (events[i].events & EPOLLERR) {
+                close(fd);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                flush(connection);
+                if (connections.find(fd) == connections.end()) continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP)) read(connection);
+        }
+    }
+    return true;
+}
+
+void SocketServer::stop() {
+    running.store(false);
+    uint64_t one = 1;
+    if (wakeup >= 0 && write(wakeup, &one, sizeof(one)) < 0) {
+        // The counter is only full when the loop is already woken up
+    }
+}
+
+void SocketServer::accept() {
+    while (true) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        int on = 1;
+        if (unixPath.empty()) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        Connection& connection = connections[fd];
+        connection.fd = fd;
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        connection.events = EPOLLIN;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+void SocketServer::read(Connection& connection) {
+    char buffer[READ_SIZE];
+    ssize_t length = ::read(connection.fd, buffer, sizeof(buffer));
+    if (length < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) close(connection.fd);
+        return;
+    }
+    connection.input.append(buffer, (size_t) length);
+    if (!parse(connection) || length == 0) connection.closing = true;
+    flush(connection);
+}
+
+void SocketServer::flush(Connection& connection) {
+    string& output = connection.output;
+    while (connection.written < output.size()) {
+        ssize_t length = send(connection.fd, output.data() + connection.written, output.size() - connection.written,
+                              MSG_NOSIGNAL);
+        if (length > 0) {
+            connection.written += (size_t) length;
+        } else if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else if (length < 0 && errno == EINTR) {
+            continue;
+        } else {
+            close(connection.fd);
+            return;
+        }
+    }
+    if (connection.written == output.size()) {
+        output.clear();
+        connection.written = 0;
+        if (connection.closing) {
+            close(connection.fd);
+            return;
+        }
+    } else if (connection.written > MAX_PENDING_OUTPUT) {
+        output.erase(0, connection.written);
+        connection.written = 0;
+    }
+    watch(connection);
+}
+
+void SocketServer::watch(Connection& connection) {
+    size_t pending = connection.output.size() - connection.written;
+    uint32_t events = 0;
+    if (pending <= MAX_PENDING_OUTPUT && !connection.closing) events |= EPOLLIN;
+    if (pending > 0) events |= EPOLLOUT;
+    if (events == connection.events) return;
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = connection.fd;
+    epoll_ctl(epoll, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.events = events;
+}
+
+void SocketServer::close(int fd) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections.erase(fd);
+}
@@ -0,0 +1,92 @@
+#ifndef STORE_SERVER_SOCKET_SERVER_H
+#define STORE_SERVER_SOCKET_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/*
+ * SocketServer is the single threaded epoll loop under the servers, every connection is non blocking.
+ * The derived server turns the bytes read into responses in parse(), the loop reads and writes them. Requests may be
+ * pipelined, and a connection whose output is not drained stops being read until the client catches up.
+ * It listens on one TCP address or one Unix socket. Linux only.
+ */
+class SocketServer {
+public:
+    virtual ~SocketServer();
+
+    /*
+     * Listen on a TCP address, port 0 picks a free port, see port().
+     * INPUT: The host address, e.g. "127.0.0.1", the port, and the string to store the reason of a failure
+     * OUTPUT: Bool. False if the socket can not be opened
+     */
+    bool listenTcp(const std::string& host, int port, std::string& error);
+
+    /*
+     * Listen on a Unix domain socket, an old socket file at that path is removed first.
+     */
+    bool listenUnix(const std::string& path, std::string& error);
+
+    /*
+     * The port the server listen on, useful after listenTcp(host, 0)
+     */
+    int port() {
+        return boundPort;
+    }
+
+    /*
+     * Serve until stop() is called. Return false if the loop can not start.
+     */
+    bool run();
+
+    /*
+     * Make run() return, it can be called from any thread or a signal handler.
+     */
+    void stop();
+
+protected:
+    struct Connection {
+        int fd;
+        std::string input;
+        std::string output;
+        size_t written = 0;
+        // The request stream ended or broke, the connection is closed once the output is written
+        bool closing = false;
+        uint32_t events = 0;
+    };
+
+    SocketServer();
+
+    /*
+     * Handle every complete request inside connection.input, append the responses to connection.output and erase
+     * the consumed input. A request which asks to close the connection sets connection.closing.
+     * OUTPUT: Bool. False if the request stream is broken, the connection is closed after the output is written
+     */
+    virtual bool parse(Connection& connection) = 0;
+
+private:
+    int listener = -1;
+    int epoll = -1;
+    int wakeup = -1;
+    int boundPort = 0;
+    std::string unixPath;
+    std::atomic<bool> running;
+    std::unordered_map<int, Connection> connections;
+
+    void accept();
+
+    void read(Connection& connection);
+
+    void flush(Connection& connection);
+
+    /*
+     * Ask epoll for the events the connection needs now: input while its output is not backed up, and output while
+     * some is pending.
+     */
+    void watch(Connection& connection);
+
+    void close(int fd);
+};
+
+#endif
@@ -0,0 +1,447 @@
+#include "StoreService.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+using namespace std;
+
+namespace {
+
+    const long long DEFAULT_LIMIT = 100;
+    const long long MAX_LIMIT = 1000;
+    const size_t MAX_CART_NAME = 64;
+    // A listed version stays pinned this long after its last listing, and only the newest few are kept
+    const chrono::minutes LISTING_LEASE(15);
+    const size_t MAX_LISTED = 16;
+
+    /*
+     * Append the attributes of a commodity as JSON members, each one starts with ','.
+     */
+    class JSONFields : public FieldVisitor {
+    private:
+        string& out;
+
+        void key(const char* name) {
+            out += ",\"";
+            out += name;
+            out += "\":";
+        }
+
+    public:
+        explicit JSONFields(string& out) : out(out) {}
+
+        void field(const char* name, const string& value) override {
+            key(name);
+            Json::appendString(out, value);
+        }
+
+        void field(const char* name, int value) override {
+            key(name);
+            out += to_string(value);
+        }
+    };
+
+    bool validCartName(const string& name) {
+        if (name.empty() || name.size() > MAX_CART_NAME) return false;
+        for (char c : name) {
+            if (!isalnum((unsigned char) c) && c != '-' && c != '_') return false;
+        }
+        return true;
+    }
+
+    bool containsIgnoreCase(const string& text, const string& pattern) {
+        return search(text.begin(), text.end(), pattern.begin(), pattern.end(), [](char a, char b) {
+            return tolower((unsigned char) a) == tolower((unsigned char) b);
+        }) != text.end();
+    }
+
+    bool toCount(const string& text, long long& value) {
+        if (text.empty() || text.size() > 18) return false;
+        long long result = 0;
+        for (char c : text) {
+            if (!isdigit((unsigned char) c)) return false;
+            result = result * 10 + (c - '0');
+        }
+        value = result;
+        return true;
+    }
+
+    void split(const string& path, vector<string>& segments) {
+        segments.clear();
+        size_t start = 1;
+        while (start <= path.size()) {
+            size_t end = path.find('/', start);
+            if (end == string::npos) end = path.size();
+            if (end > start) segments.emplace_back(path, start, end - start);
+            start = end + 1;
+        }
+    }
+}
+
+StoreService::StoreService(CommodityList& list, CartStore* store, SalesLog* sales, Promotions* promotions,
+                           CheckoutPricing* pricing)
+        : list(list), carts(list, store, sales, promotions), pricing(pricing) {}
+
+void StoreService::handle(const HttpRequest& request, HttpResponse& response) {
+    split(request.path, segments);
+    bool get = request.method == "GET";
+    bool post = request.method == "POST";
+    if (segments.size() == 1 && segments[0] == "commodities") {
+        if (get) listCommodities(request, response);
+        else error(response, 405, "use GET");
+        return;
+    }
+    if (segments.size() == 1 && segments[0] == "search") {
+        if (get) search(request, response);
+        else error(response, 405, "use GET");
+        return;
+    }
+    if (segments.size() == 1 && segments[0] == "facets") {
+        if (get) facets(request, response);
+        else error(response, 405, "use GET");
+        return;
+    }
+    if (segments.size() >= 2 && segments[0] == "carts") {
+        const string& name = segments[1];
+        if (!validCartName(name)) {
+            error(response, 400, "a cart name is made of letters, digits, '-' and '_'");
+        } else if (segments.size() == 2) {
+            if (get) showCart(name, response);
+            else error(response, 405, "use GET");
+        } else if (segments.size() == 3 && segments[2] == "items") {
+            if (post) addToCart(name, request, response);
+            else error(response, 405, "use POST");
+        } else if (segments.size() == 4 && segments[2] == "items") {
+            if (request.method == "DELETE") removeFromCart(name, segments[3], response);
+            else error(response, 405, "use DELETE");
+        } else if (segments.size() == 3 && segments[2] == "checkout") {
+            if (post) checkOut(name, request, response);
+            else error(response, 405, "use POST");
+        } else {
+            error(response, 404, "no such resource");
+        }
+        return;
+    }
+    error(response, 404, "no such resource");
+}
+
+void StoreService::listCommodities(const HttpRequest& request, HttpResponse& response) {
+    long long offset;
+    long long limit;
+    if (!count(request, "offset", 0, offset) || !count(request, "limit", DEFAULT_LIMIT, limit)) {
+        error(response, 400, "offset and limit must be non negative integers");
+        return;
+    }
+    limit = min(limit, MAX_LIMIT);
+    int only = -1;
+    if (request.parameter("category", parameter)) {
+        only = CategoryRegistry::find(parameter);
+        if (only == -1 || only >= list.categoryCount()) {
+            error(response, 404, "no such category");
+            return;
+        }
+    }
+
+    // The positions are the ones of the pinned version, a later add can name it, see addToCart
+    CommodityList::Pin version = list.pin();
+    lease(version);
+    string& out = response.body;
+    long long total = 0;
+    long long position = 0;
+    long long written = 0;
+    out += "{\"items\":[";
+    for (int i = 0; i < list.categoryCount(); i++) {
+        const vector<Commodity*>& commodities = version->getCategory(i);
+        if (only != -1 && i != only) {
+            position += (long long) commodities.size();
+            continue;
+        }
+        for (size_t j = 0; j < commodities.size(); j++) {
+            if (total >= offset && written < limit) {
+                if (written != 0) out += ',';
+                appendCommodity(out, commodities[j], i, position + (long long) j + 1);
+                written++;
+            }
+            total++;
+        }
+        position += (long long) commodities.size();
+    }
+    out += "],\"total\":";
+    out += to_string(total);
+    out += ",\"version\":";
+    out += to_string(version->getNumber());
+    out += '}';
+}
+
+void StoreService::facets(const HttpRequest& request, HttpResponse& response) {
+    int category = request.parameter("category", parameter) ? CategoryRegistry::find(parameter) : -1;
+    if (category == -1) {
+        error(response, 404, "no such category");
+        return;
+    }
+    if (facetIndexes.empty()) {
+        for (int i = 0; i < CategoryRegistry::size(); i++) facetIndexes.emplace_back(i);
+    }
+    FacetIndex& index = facetIndexes[category];
+    index.update(list);
+
+    // A value which the category does not have matches nothing
+    picks.assign(index.facetCount(), vector<int>());
+    for (int f = 0; f < index.facetCount(); f++) {
+        const FacetIndex::Facet& facet = index.getFacet(f);
+        if (!request.parameter(facet.key, parameter)) continue;
+        for (size_t begin = 0; begin <= parameter.size();) {
+            size_t end = min(parameter.find('|', begin), parameter.size());
+            auto found = find(facet.values.begin(), facet.values.end(), parameter.substr(begin, end - begin));
+            picks[f].push_back(found != facet.values.end() ? (int) (found - facet.values.begin()) : -1);
+            begin = end + 1;
+        }
+    }
+    index.count(picks, facetCounts, &matches);
+    // Only the bitmaps are read from here on
+    index.release();
+
+    string& out = response.body;
+    out += "{\"category\":";
+    Json::appendString(out, CategoryRegistry::get(category).label);
+    out += ",\"matches\":";
+    out += to_string(matches.cardinality());
+    out += ",\"facets\":{";
+    for (int f = 0; f < index.facetCount(); f++) {
+        const FacetIndex::Facet& facet = index.getFacet(f);
+        if (f != 0) out += ',';
+        Json::appendString(out, facet.key);
+        out += ":{";
+        for (size_t v = 0; v < facet.values.size(); v++) {
+            if (v != 0) out += ',';
+            Json::appendString(out, facet.values[v]);
+            out += ':';
+            out += to_string(facetCounts[f][v]);
+        }
+        out += '}';
+    }
+    out += "}}";
+}
+
+void StoreService::lease(const CommodityList::Pin& version) {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    listed[version->getNumber()] = make_pair(version, now + LISTING_LEASE);
+    for (auto i = listed.begin(); i != listed.end();) {
+        if (i->second.second <= now || listed.size() > MAX_LISTED) i = listed.erase(i);
+        else ++i;
+    }
+}
+
+void StoreService::search(const HttpRequest& request, HttpResponse& response) {
+    long long limit;
+    if (!request.parameter("q", parameter) || parameter.empty()) {
+        error(response, 400, "the q parameter is required");
+        return;
+    }
+    if (!count(request, "limit", DEFAULT_LIMIT, limit)) {
+        error(response, 400, "limit must be a non negative integer");
+        return;
+    }
+    limit = min(limit, MAX_LIMIT);
+
+    string& out = response.body;
+    long long position = 0;
+    long long found = 0;
+    out += "{\"items\":[";
+    for (int i = 0; i < list.categoryCount(); i++) {
+        for (Commodity* commodity : list.getCategory(i)) {
+            position++;
+            if (found >= limit || !containsIgnoreCase(commodity->getName(), parameter)) continue;
+            if (found != 0) out += ',';
+            appendCommodity(out, commodity, i, position);
+            found++;
+        }
+    }
+    out += "]}";
+}
+
+void StoreService::showCart(const string& name, HttpResponse& response) {
+    string& out = response.body;
+    out += "{\"cart\":";
+    Json::appendString(out, name);
+    out += ",\"lines\":[";
+    long long total = 0;
+    ShoppingCart* found = carts.find(name);
+    if (found != nullptr) {
+        ShoppingCart& cart = *found;
+        int line = 0;
+        for (int i = 0; i < cart.categoryCount(); i++) {
+            for (const ShoppingCart::CartEntry& entry : cart.getCategory(i)) {
+                if (line != 0) out += ',';
+                out += "{\"line\":";
+                out += to_string(++line);
+                out += ",\"id\":";
+                out += to_string(entry.id);
+                out += ",\"category\":";
+                Json::appendString(out, CategoryRegistry::get(i).label);
+                out += ",\"name\":";
+                Json::appendString(out, entry.commodity->getName());
+                out += ",\"price\":";
+                out += to_string(entry.commodity->getPrice());
+                out += ",\"quantity\":";
+                out += to_string(entry.quantity);
+                out += '}';
+                total += (long long) entry.commodity->getPrice() * entry.quantity;
+            }
+        }
+    }
+    out += "],\"total\":";
+    out += to_string(total);
+    out += '}';
+}
+
+void StoreService::addToCart(const string& name, const HttpRequest& request, HttpResponse& response) {
+    if (!Json::parseObject(request.body.data(), request.body.data() + request.body.size(), fields)) {
+        error(response, 400, "the body must be a JSON object");
+        return;
+    }
+    long long position = -1;
+    long long id = -1;
+    long long version = -1;
+    long long quantity = 1;
+    for (const pair<string, string>& field : fields) {
+        bool valid = true;
+        if (field.first == "position") valid = toCount(field.second, position);
+        else if (field.first == "id") valid = toCount(field.second, id);
+        else if (field.first == "version") valid = toCount(field.second, version);
+        else if (field.first == "quantity") valid = toCount(field.second, quantity);
+        if (!valid) {
+            error(response, 400, field.first + " must be a non negative integer");
+            return;
+        }
+    }
+    Commodity* commodity = nullptr;
+    int category = 0;
+    if (id >= 0) {
+        commodity = list.find((uint64_t) id, category);
+    } else if (version >= 0 && position >= 1) {
+        CommodityList::Pin listedVersion = list.pinned(version);
+        if (listedVersion == nullptr) {
+            error(response, 409, "the listing is too old, list the commodities again");
+            return;
+        }
+        if (position <= listedVersion->size()) commodity = listedVersion->get((int) position - 1);
+        // A commodity removed since the listing can not be bought
+        if (commodity != nullptr && list.find(commodity->getId(), category) != commodity) {
+            error(response, 404, "the commodity at that position is removed");
+            return;
+        }
+    } else if (position >= 1 && position <= list.size()) {
+        commodity = list.get((int) position - 1);
+        category = list.getIndex((int) position - 1);
+    }
+    if (commodity == nullptr) {
+        error(response, 404, id >= 0 ? "no commodity with that id" : "no commodity at that position");
+        return;
+    }
+    if (quantity < 1 || quantity > 1000) {
+        error(response, 400, "quantity must be between 1 and 1000");
+        return;
+    }
+    ShoppingCart& cart = carts.open(name);
+    if (!cart.push(commodity, category, (int) quantity)) {
+        error(response, 409, "not enough stock");
+        return;
+    }
+    carts.save(name, cart);
+    showCart(name, response);
+}
+
+void StoreService::removeFromCart(const string& name, const string& line, HttpResponse& response) {
+    long long index;
+    ShoppingCart* found = carts.find(name);
+    if (!toCount(line, index) || found == nullptr || index < 1 || index > found->size()) {
+        error(response, 404, "no such cart line");
+        return;
+    }
+    found->remove((int) index - 1);
+    carts.save(name, *found);
+    showCart(name, response);
+}
+
+void StoreService::checkOut(const string& name, const HttpRequest& request, HttpResponse& response) {
+    int region = 0;
+    if (pricing != nullptr && request.parameter("region", parameter)) {
+        region = pricing->find(parameter);
+        if (region < 0) {
+            error(response, 400, "no such region");
+            return;
+        }
+    }
+    ShoppingCart* found = carts.find(name);
+    if (found == nullptr || found->empty()) {
+        error(response, 409, "the cart is empty");
+        return;
+    }
+    vector<string> unavailable;
+    int lines = found->size();
+    int discount;
+    int total = carts.checkOut(name, *found, &unavailable, &discount);
+    string& out = response.body;
+    out += "{\"cart\":";
+    Json::appendString(out, name);
+    out += ",\"lines\":";
+    out += to_string(lines - (int) unavailable.size());
+    out += ",\"discount\":";
+    out += to_string(discount);
+    out += ",\"total\":";
+    out += to_string(total);
+    out += ",\"unavailable\":[";
+    for (size_t i = 0; i < unavailable.size(); i++) {
+        if (i != 0) out += ',';
+        Json::appendString(out, unavailable[i]);
+    }
+    out += ']';
+    if (pricing != nullptr) {
+        const vector<ShoppingCart::SoldLine>& sold = carts.lastSold();
+        CheckoutPricing::Totals totals;
+        pricing->price(region, sold.data(), sold.size(), totals);
+        out += ",\"payable\":{\"region\":";
+        Json::appendString(out, pricing->getName(region));
+        out += ",\"currency\":";
+        Json::appendString(out, pricing->getCurrency(region));
+        out += ",\"decimals\":";
+        out += to_string(pricing->getDecimals(region));
+        out += ",\"net\":";
+        out += to_string(totals.net);
+        out += ",\"tax\":";
+        out += to_string(totals.tax);
+        out += ",\"total\":";
+        out += to_string(totals.total);
+        out += '}';
+    }
+    out += '}';
+}
+
+void StoreService::appendCommodity(string& out, Commodity* commodity, int category, long long position) {
+    out += "{\"position\":";
+    out += to_string(position);
+    out += ",\"id\":";
+    out += to_string(commodity->getId());
+    out += ",\"category\":";
+    Json::appendString(out, CategoryRegistry::get(category).label);
+    JSONFields visitor(out);
+    commodity->visitFields(visitor);
+    out += '}';
+}
+
+bool StoreService::count(const HttpRequest& request, const char* name, long long fallback, long long& value) {
+    if (!request.parameter(name, parameter)) {
+        value = fallback;
+        return true;
+    }
+    return toCount(parameter, value);
+}
+
+void StoreService::error(HttpResponse& response, int status, const string& message) {
+    response.status = status;
+    response.body = "{\"error\":";
+    Json::appendString(response.body, message);
+    response.body += '}';
+}
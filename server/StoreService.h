@@ -0,0 +1,103 @@
+#ifndef STORE_SERVER_STORE_SERVICE_H
+#define STORE_SERVER_STORE_SERVICE_H
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../core/StoreCore.h"
+#include "CartTable.h"
+#include "HttpServer.h"
+
+/*
+ * StoreService answer the HTTP requests of the store with JSON, on top of CommodityList and ShoppingCart.
+ *  GET    /commodities?category=<label>&offset=<n>&limit=<n>  The commodities in the order of the store listing,
+ *                                                              with the "version" the positions belong to.
+ *  GET    /search?q=<text>&limit=<n>                           The commodities whose name contains the text.
+ *  GET    /facets?category=<label>&<key>=<value>|<value>       The number of commodities of every attribute value
+ *                                                              under the filter, see FacetIndex.
+ *  GET    /carts/<cart>                                        The lines of a cart and its total.
+ *  POST   /carts/<cart>/items {"position": <n>, "quantity": <n>}  Put a commodity into the cart, 409 without stock.
+ *                              {"id": <n>, "quantity": <n>}    The same, the commodity is chosen by its id.
+ *                              {"position": <n>, "version": <n>}  The position of that listing, see below.
+ *  DELETE /carts/<cart>/items/<line>                           Remove a line of the cart.
+ *  POST   /carts/<cart>/checkout?region=<name>                 Pay the cart and empty it, the lines whose stock
+ *                                                              is gone are listed in "unavailable".
+ * The position of a commodity is the 1-based number the console store shows and it shifts when a commodity is
+ * removed, while the "id" of every commodity and cart line never changes. A listing pins its version of the list for
+ * 15 minutes, so a position sent with that version still means the commodity which was listed there, or a 404 when
+ * it is removed since. A 409 asks to list again once the version is dropped. A cart is created when it is first
+ * used and its name is made of letters, digits, '-' and '_'. An error is {"error": <message>} with a 4xx status.
+ * With a CartStore the carts are saved after every change and resumed after a restart, with a SalesLog every
+ * checkout is recorded, and with Promotions the "total" of a checkout is after its "discount", see CartTable. With
+ * CheckoutPricing a checkout also tells what it pays in the region, the first one by default: "payable" holds its
+ * "currency", the "net", "tax" and "total" in minor units, and the "decimals" of a unit.
+ * The service is not thread safe, HttpServer calls it from its loop thread only.
+ */
+class StoreService {
+public:
+    explicit StoreService(CommodityList& list, CartStore* store = nullptr, SalesLog* sales = nullptr,
+                          Promotions* promotions = nullptr, CheckoutPricing* pricing = nullptr);
+
+    void handle(const HttpRequest& request, HttpResponse& response);
+
+    /*
+     * The carts by name, RpcService works on the same table when both servers run in one process.
+     */
+    CartTable& cartTable() {
+        return carts;
+    }
+
+private:
+    CommodityList& list;
+    CartTable carts;
+    CheckoutPricing* pricing;
+    // Scratch space reused by every request
+    std::string parameter;
+    std::vector<std::string> segments;
+    std::vector<std::pair<std::string, std::string>> fields;
+    // One for every category, built by the first facet request
+    std::vector<FacetIndex> facetIndexes;
+    std::vector<std::vector<int>> picks;
+    std::vector<std::vector<long long>> facetCounts;
+    RoaringBitmap matches;
+    // The versions pinned by the recent listings, with the time their lease ends
+    std::map<long long, std::pair<CommodityList::Pin, std::chrono::steady_clock::time_point>> listed;
+
+    void listCommodities(const HttpRequest& request, HttpResponse& response);
+
+    /*
+     * Keep a listed version pinned, and drop the leases which ended.
+     */
+    void lease(const CommodityList::Pin& version);
+
+    void search(const HttpRequest& request, HttpResponse& response);
+
+    void facets(const HttpRequest& request, HttpResponse& response);
+
+    void showCart(const std::string& name, HttpResponse& response);
+
+    void addToCart(const std::string& name, const HttpRequest& request, HttpResponse& response);
+
+    void removeFromCart(const std::string& name, const std::string& line, HttpResponse& response);
+
+    void checkOut(const std::string& name, const HttpRequest& request, HttpResponse& response);
+
+    /*
+     * Append {"position":..,"category":..,<attributes>} of one commodity.
+     */
+    void appendCommodity(std::string& out, Commodity* commodity, int category, long long position);
+
+    /*
+     * Read a non negative integer query parameter, the default is used when it is missing.
+     * OUTPUT: Bool. False if the parameter is not a valid number
+     */
+    bool count(const HttpRequest& request, const char* name, long long fallback, long long& value);
+
+    static void error(HttpResponse& response, int status, const std::string& message);
+};
+
+#endif
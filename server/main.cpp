@@ -0,0 +1,176 @@
+/*
+ * store-server serve the catalog of the working directory and the carts over HTTP/JSON, see StoreService, and with
+ * --rpc over the binary protocol on a Unix socket as well, see RpcService. Both servers share the catalog and the
+ * carts, each one runs its own loop thread and a request is handled under one lock. The catalog, with the stock sold
+ * through the carts, is checkpointed in the background and saved once more when the server stops. The carts are kept
+ * in the CartStore file of the catalog directory, the same one the console store uses.
+ * Usage: store-server [--listen=127.0.0.1:8080 | --listen=unix:<path>] [--rpc=<socket path>] [--catalog=<directory>]
+ * SIGINT or SIGTERM stops it.
+ */
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "HttpServer.h"
+#include "RpcServer.h"
+#include "RpcService.h"
+#include "StoreService.h"
+
+using namespace std;
+
+namespace {
+
+    const chrono::seconds CHECKPOINT_INTERVAL(30);
+
+    SocketServer* activeServers[2] = {nullptr, nullptr};
+
+    void stopServer(int) {
+        for (SocketServer* server : activeServers) {
+            if (server != nullptr) server->stop();
+        }
+    }
+
+    void usage(const char* program) {
+        cerr << "usage: " << program << " [--listen=<host>:<port> | --listen=unix:<path>] [--rpc=<socket path>]"
+             << " [--catalog=<directory>]" << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    string listen = "127.0.0.1:8080";
+    string rpc;
+    string catalog = ".";
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument.compare(0, 9, "--listen=") == 0) listen = argument.substr(9);
+        else if (argument.compare(0, 6, "--rpc=") == 0) rpc = argument.substr(6);
+        else if (argument.compare(0, 10, "--catalog=") == 0) catalog = argument.substr(10);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (chdir(catalog.c_str()) != 0) {
+        cerr << "Can not enter " << catalog << endl;
+        return 1;
+    }
+
+    CommodityList list;
+    for (int i = 0; i < CategoryRegistry::size(); i++) {
+        const string& fileName = CategoryRegistry::get(i).fileName;
+        RecordLoader::Report report;
+        if (!RecordLoader::load(fileName, i, list, report)) continue;
+        if (report.checksum == RecordLoader::MISMATCH) {
+            cerr << "[WARNING] " << fileName << " fails its checksum, it is moved to " << fileName
+                 << ".corrupt and not loaded" << endl;
+            continue;
+        }
+        cerr << "Load " << fileName << ": " << report.loaded << " loaded, " << report.skipped << " skipped" << endl;
+    }
+
+    CartStore cartStore(CartStore::DEFAULT_FILE);
+    bool cartsOpened = cartStore.open();
+    if (!cartsOpened) {
+        cerr << "[WARNING] Can not open " << CartStore::DEFAULT_FILE << ", the carts are only kept in memory" << endl;
+    }
+
+    SalesLog salesLog(SalesLog::DEFAULT_FILE);
+    bool salesOpened = salesLog.open();
+    if (!salesOpened) {
+        cerr << "[WARNING] Can not open " << SalesLog::DEFAULT_FILE << ", the sales are not recorded" << endl;
+    }
+
+    Promotions promotions;
+    vector<string> promotionErrors;
+    if (promotions.load(Promotions::DEFAULT_FILE, &promotionErrors)) {
+        for (const string& error : promotionErrors) {
+            cerr << "[WARNING] " << Promotions::DEFAULT_FILE << " " << error << endl;
+        }
+        cerr << "Load " << Promotions::DEFAULT_FILE << ": " << promotions.size() << " promotions" << endl;
+    }
+
+    CheckoutPricing pricing;
+    vector<string> regionErrors;
+    if (pricing.load(CheckoutPricing::DEFAULT_FILE, &regionErrors)) {
+        for (const string& error : regionErrors) {
+            cerr << "[WARNING] " << CheckoutPricing::DEFAULT_FILE << " " << error << endl;
+        }
+    }
+
+    mutex storeLock;
+    Checkpointer checkpointer(CHECKPOINT_INTERVAL);
+    StoreService service(list, cartsOpened ? &cartStore : nullptr, salesOpened ? &salesLog : nullptr, &promotions,
+                         &pricing);
+    // Run with the lock held before every request, like Store::checkpoint in the console store
+    auto housekeeping = [&]() {
+        service.cartTable().expire();
+        Checkpointer::Result result;
+        if (checkpointer.collect(result)) {
+            for (const string& fileName : result.failedFiles) {
+                cerr << "[WARNING] Fail to checkpoint " << fileName << ", the previous file is kept" << endl;
+            }
+        }
+        checkpointer.tick(list);
+        list.maintain();
+    };
+    HttpServer server([&](const HttpRequest& request, HttpResponse& response) {
+        lock_guard<mutex> guard(storeLock);
+        housekeeping();
+        service.handle(request, response);
+    });
+    RpcService rpcService(list, service.cartTable());
+    RpcServer rpcServer([&](const char* payload, size_t length, string& out) {
+        lock_guard<mutex> guard(storeLock);
+        housekeeping();
+        return rpcService.handle(payload, length, out);
+    });
+    string error;
+    bool listening;
+    if (listen.compare(0, 5, "unix:") == 0) {
+        listening = server.listenUnix(listen.substr(5), error);
+    } else {
+        size_t colon = listen.rfind(':');
+        int port = 0;
+        listening = colon != string::npos && sscanf(listen.c_str() + colon + 1, "%d", &port) == 1 &&
+                    server.listenTcp(listen.substr(0, colon), port, error);
+        if (!listening && error.empty()) error = listen + " is not <host>:<port>";
+    }
+    if (listening && !rpc.empty()) listening = rpcServer.listenUnix(rpc, error);
+    if (!listening) {
+        cerr << error << endl;
+        return 1;
+    }
+
+    activeServers[0] = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    thread rpcThread;
+    if (!rpc.empty()) {
+        activeServers[1] = &rpcServer;
+        rpcThread = thread([&rpcServer]() { rpcServer.run(); });
+        cerr << "Serving the binary protocol on " << rpc << endl;
+    }
+    cerr << "Serving " << list.size() << " commodities on " << listen << endl;
+    bool served = server.run();
+    if (rpcThread.joinable()) {
+        rpcServer.stop();
+        rpcThread.join();
+    }
+    activeServers[0] = activeServers[1] = nullptr;
+
+    Checkpointer::Result result;
+    checkpointer.wait(result);
+    if (checkpointer.dirty(list)) {
+        checkpointer.start(list);
+        checkpointer.wait(result);
+    }
+    for (const string& fileName : result.failedFiles) {
+        cerr << "[WARNING] Fail to save " << fileName << ", the previous file is kept" << endl;
+    }
+    return served ? 0 : 1;
+}
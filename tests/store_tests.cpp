@@ -0,0 +1,151 @@
+/*
+ * The checks of the on-disk formats of store-core, run by ctest. Every test writes its files into the working
+ * directory and removes them at the end. A failed check prints its line, and the exit code is the number of failures.
+ */
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../core/StoreCore.h"
+
+using namespace std;
+
+namespace {
+
+    int failures = 0;
+
+#define CHECK(condition)                                                                        \
+    do {                                                                                        \
+        if (!(condition)) {                                                                     \
+            cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << endl;       \
+            failures++;                                                                         \
+        }                                                                                       \
+    } while (false)
+
+    string readFile(const string& fileName) {
+        ifstream file(fileName, ios::binary);
+        return string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    }
+
+    /*
+     * Cut the last bytes of a file, the way a crash in the middle of an append leaves it.
+     */
+    void cutFile(const string& fileName, size_t bytes) {
+        string data = readFile(fileName);
+        data.resize(data.size() - bytes);
+        ofstream(fileName, ios::binary | ios::trunc).write(data.data(), (streamsize) data.size());
+    }
+
+    void crc32c() {
+        const string check = "123456789";
+        CHECK(Crc32c::update(0, check.data(), check.size()) == 0xE3069283u);
+        CHECK(Crc32c::updateTable(0, check.data(), check.size()) == 0xE3069283u);
+        CHECK(Crc32c::update(0, nullptr, 0) == 0);
+
+        // The hardware path takes 8 bytes at a time, so every length and every split around it is compared
+        string data;
+        for (int i = 0; i < 300; i++) data.push_back((char) (i * 131 + 7));
+        for (size_t length = 0; length <= data.size(); length++) {
+            uint32_t whole = Crc32c::update(0, data.data(), length);
+            CHECK(whole == Crc32c::updateTable(0, data.data(), length));
+            size_t split = length / 3;
+            CHECK(whole == Crc32c::update(Crc32c::update(0, data.data(), split), data.data() + split, length - split));
+        }
+    }
+
+    void cartStoreTornTail() {
+        const string fileName = "store_tests_carts.db";
+        remove(fileName.c_str());
+        CommodityList list;
+        for (int i = 0; i < 3; i++) {
+            Commodity* commodity = CategoryRegistry::get(0).create();
+            commodity->setField("name", "cart test " + to_string(i));
+            commodity->setField("price", "100");
+            list.add(commodity, 0);
+        }
+        {
+            CartStore store(fileName);
+            CHECK(store.open());
+            ShoppingCart first;
+            first.push(list.get(0), 0, 2);
+            first.push(list.get(1), 0);
+            CHECK(store.save("first", first));
+            ShoppingCart second;
+            second.push(list.get(2), 0);
+            CHECK(store.save("second", second));
+        }
+        cutFile(fileName, 3);
+        {
+            CartStore store(fileName);
+            CHECK(store.open());
+            CHECK(store.size() == 1);
+            ShoppingCart cart;
+            CHECK(store.resume("first", list, cart));
+            CHECK(cart.size() == 2);
+            ShoppingCart missing;
+            CHECK(!store.resume("second", list, missing));
+            // The torn record is gone from the file, so a new one is read back after it
+            CHECK(store.save("second", cart));
+        }
+        {
+            CartStore store(fileName, 0);
+            CHECK(store.open());
+            CHECK(store.size() == 2);
+            ShoppingCart cart;
+            CHECK(store.resume("second", list, cart));
+            CHECK(cart.size() == 2);
+        }
+        remove(fileName.c_str());
+        for (int i = 0; i < list.size(); i++) delete list.get(i);
+    }
+
+    void salesLogTornTail() {
+        const string fileName = "store_tests_sales.db";
+        remove(fileName.c_str());
+        {
+            SalesLog log(fileName);
+            CHECK(log.open());
+            for (int i = 0; i < 3; i++) {
+                CHECK(log.append(1000 + i, {{(uint64_t) i + 1, 0, 2, 150, 0}, {7, 1, 1, 90, 10}}));
+            }
+        }
+        cutFile(fileName, 2);
+        {
+            SalesLog log(fileName);
+            CHECK(log.open());
+            CHECK(log.size() == 2);
+            SalesLog::Report report;
+            log.summarize(0, 2000, report);
+            CHECK(report.checkouts == 2);
+            CHECK(report.items == 6);
+            CHECK(report.revenue == 2 * (300 + 80));
+            CHECK(log.append(1005, {{9, 2, 1, 500, 0}}));
+        }
+        {
+            SalesLog log(fileName);
+            CHECK(log.open());
+            CHECK(log.size() == 3);
+            vector<uint64_t> basket;
+            log.basket(2, basket);
+            CHECK(basket.size() == 1 && basket[0] == 9);
+        }
+        remove(fileName.c_str());
+    }
+}
+
+int main() {
+    const pair<const char*, void (*)()> tests[] = {
+            {"crc32c", crc32c},
+            {"cartStoreTornTail", cartStoreTornTail},
+            {"salesLogTornTail", salesLogTornTail}};
+    for (const pair<const char*, void (*)()>& test : tests) {
+        int before = failures;
+        test.second();
+        cout << (failures == before ? "[  OK  ] " : "[FAILED] ") << test.first << endl;
+    }
+    return failures;
+}
@@ -0,0 +1,373 @@
+/*
+ * store-gen create synthetic catalogs and shopper workloads for load testing.
+ *
+ * The catalog is written by CommodityList::save, so the files are exactly what Store::load reads. Names, descriptions
+ * and attributes are picked from small vocabularies, so their lengths and the repetition of attribute values look
+ * like a real catalog.
+ * The workload is a list of shopper sessions. Each session browses, adds and removes cart entries and checks out.
+ * The commodities are chosen with a Zipf distribution, so a few of them are very popular. Two formats are written:
+ *  ops: one operation per line, "session <n>", "browse", "add <position>", "remove <cart line>", "checkout"
+ *       and "end". The position is the number shown in the store listing.
+ *  stdin: the keys a user would type into final-exam2, so "final-exam2 < Workload.txt" replays it.
+ * Everything is decided by --seed, the same arguments always give the same files.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../core/StoreCore.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#define chdir _chdir
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+    /*
+     * SplitMix64, the sequence does not depend on the standard library like the std distributions do.
+     */
+    class Random {
+    private:
+        uint64_t state;
+
+    public:
+        explicit Random(uint64_t seed) : state(seed) {}
+
+        uint64_t next() {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        long long uniform(long long bound) {
+            return (long long) (next() % (uint64_t) bound);
+        }
+
+        double real() {
+            return (next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        template<class T>
+        const T& pick(const vector<T>& values) {
+            return values[uniform((long long) values.size())];
+        }
+    };
+
+    /*
+     * Zipf distribution over [0, size), rank 0 is the most popular.
+     */
+    class Zipf {
+    private:
+        vector<double> cumulative;
+
+    public:
+        Zipf(long long size, double exponent) : cumulative(size) {
+            double sum = 0;
+            for (long long i = 0; i < size; i++) {
+                sum += 1.0 / pow((double) (i + 1), exponent);
+                cumulative[i] = sum;
+            }
+            for (double& value : cumulative) value /= sum;
+        }
+
+        long long sample(Random& random) {
+            double target = random.real();
+            long long rank = lower_bound(cumulative.begin(), cumulative.end(), target) - cumulative.begin();
+            return min(rank, (long long) cumulative.size() - 1);
+        }
+    };
+
+    struct Options {
+        long long items = 1000;
+        uint64_t seed = 1;
+        string out = ".";
+        long long sessions = 0;
+        long long ops = 20;
+        double zipf = 0.99;
+        int mix[4] = {40, 35, 10, 15};
+        bool stdinFormat = false;
+        string workload = "Workload.txt";
+    };
+
+    const vector<string> adjectives = {"Pro", "Max", "Ultra", "Lite", "Air", "Plus", "Mini", "Neo", "Prime", "Edge"};
+    const vector<string> words = {
+            "portable", "wireless", "premium", "aluminium", "design", "battery", "fast", "charging", "light",
+            "sound", "display", "warranty", "official", "imported", "limited", "edition", "color", "black",
+            "silver", "gaming", "office", "student", "travel", "waterproof", "compact", "powerful", "quiet",
+            "new", "model", "year", "bundle", "with", "case", "and", "cable", "from", "Taiwan", "Japan", "Korea"};
+
+    string description(Random& random) {
+        string text;
+        long long count = 6 + random.uniform(18);
+        for (long long i = 0; i < count; i++) {
+            if (i != 0) text += ' ';
+            text += random.pick(words);
+        }
+        return text;
+    }
+
+    string name(Random& random, const vector<string>& brands, const string& series, long long number) {
+        return random.pick(brands) + " " + series + " " + to_string(100 + number) + " " + random.pick(adjectives);
+    }
+
+    void fillSound(Commodity* commodity, Random& random, long long number) {
+        static const vector<string> brands = {"Sony", "Bose", "JBL", "Sennheiser", "Audio-Technica", "Marshall"};
+        static const vector<string> impedances = {"4", "8", "16", "32", "64", "250"};
+        static const vector<string> sensitivities = {"85", "88", "90", "95", "98", "102", "105"};
+        commodity->setField("name", name(random, brands, "Sound", number));
+        commodity->setField("price", to_string(990 + random.uniform(400) * 100));
+        commodity->setField("lowest_frequency_response", to_string(5 + random.uniform(4) * 5));
+        commodity->setField("highest_frequency_response", to_string(20 + random.uniform(3) * 10));
+        commodity->setField("sensitivity", random.pick(sensitivities));
+        commodity->setField("impedance", random.pick(impedances));
+        commodity->setField("description", description(random));
+    }
+
+    void fillSmartphone(Commodity* commodity, Random& random, long long number) {
+        static const vector<string> brands = {"Apple", "Samsung", "ASUS", "Google", "Xiaomi", "OPPO", "Sony"};
+        static const vector<string> chips = {"A15 Bionic chip", "A16 Bionic chip", "Snapdragon 888",
+                                             "Snapdragon 8 Gen 1", "Dimensity 9000", "Tensor", "Exynos 2200"};
+        static const vector<string> networks = {"5G WiFi6", "5G WiFi6E", "LTE Advanced(4G)", "5G"};
+        static const vector<string> cameras = {"12000000", "48000000", "50000000", "64000000", "108000000"};
+        commodity->setField("name", name(random, brands, "Phone", number));
+        commodity->setField("price", to_string(4990 + random.uniform(300) * 100));
+        commodity->setField("screen_size", to_string(5 + random.uniform(3)));
+        commodity->setField("cellular_and_wireless", random.pick(networks));
+        commodity->setField("camera", random.pick(cameras));
+        commodity->setField("chip", random.pick(chips));
+        commodity->setField("weight", to_string(140 + random.uniform(100)));
+        commodity->setField("video_playback", to_string(10 + random.uniform(20)));
+        commodity->setField("description", description(random));
+    }
+
+    void fillLaptop(Commodity* commodity, Random& random, long long number) {
+        static const vector<string> brands = {"MSI", "ASUS", "Acer", "Lenovo", "Dell", "HP", "Apple"};
+        static const vector<string> systems = {"Windows 10", "Windows 11", "macOS", "Ubuntu 22.04", "Chrome OS"};
+        static const vector<string> cpus = {"Intel Core i5-1240P", "Intel Core i7-12700H", "Intel Core i9-12900HK",
+                                            "AMD Ryzen 7 6800H", "AMD Ryzen 9 6900HX", "Apple M2"};
+        static const vector<string> gpus = {"Intel Iris Xe", "GeForce RTX 3050 4GB", "GeForce RTX 3060 6GB GDDR 6",
+                                            "GeForce RTX 3080 Ti 16GB", "Radeon 680M", "Apple 10-core GPU"};
+        static const vector<string> memories = {"8", "16", "16", "32", "32", "64"};
+        static const vector<string> disks = {"256", "512", "512", "1024", "2048"};
+        static const vector<string> screens = {"13", "14", "15", "16", "17"};
+        commodity->setField("name", name(random, brands, "Book", number));
+        commodity->setField("price", to_string(19900 + random.uniform(800) * 100));
+        commodity->setField("screen_size", random.pick(screens));
+        commodity->setField("os", random.pick(systems));
+        commodity->setField("memory_size", random.pick(memories));
+        commodity->setField("cpu", random.pick(cpus));
+        commodity->setField("rgb", random.uniform(3) == 0 ? "1" : "2");
+        commodity->setField("gpu", random.pick(gpus));
+        commodity->setField("disk_size", random.pick(disks));
+        commodity->setField("description", description(random));
+    }
+
+    /*
+     * Generate options.items commodities for every category and save them.
+     * RETURN: Bool. False if the files can not be written
+     */
+    bool generateCatalog(const Options& options) {
+        Random random(options.seed);
+        CommodityList list;
+        for (int category = 0; category < CategoryRegistry::size(); category++) {
+            const string& label = CategoryRegistry::get(category).label;
+            for (long long i = 0; i < options.items; i++) {
+                Commodity* commodity = CategoryRegistry::get(category).create();
+                if (label == "Sound") fillSound(commodity, random, i);
+                else if (label == "Smartphone") fillSmartphone(commodity, random, i);
+                else if (label == "Laptop") fillLaptop(commodity, random, i);
+                else {
+                    commodity->setField("name", label + " " + to_string(i));
+                    commodity->setField("price", to_string(100 + random.uniform(10000)));
+                    commodity->setField("description", description(random));
+                }
+                // The number inside the name keeps it unique, the brand and suffix only add realistic variety
+                list.add(commodity, category);
+            }
+        }
+        vector<string> failedFiles;
+        bool saved = list.save(&failedFiles);
+        for (const string& fileName : failedFiles) cerr << "Can not write " << fileName << endl;
+        for (int category = 0; category < list.categoryCount(); category++) {
+            for (Commodity* commodity : list.getCategory(category)) delete commodity;
+        }
+        return saved;
+    }
+
+    /*
+     * Keep the cart lines in the order the store shows them, grouped by category, so a removed line number
+     * matches the real cart.
+     */
+    class CartModel {
+    private:
+        vector<vector<long long>> lines;
+
+    public:
+        explicit CartModel(int categories) : lines(categories) {}
+
+        void push(long long position, int category) {
+            vector<long long>& entries = lines[category];
+            if (find(entries.begin(), entries.end(), position) == entries.end()) entries.push_back(position);
+        }
+
+        void remove(long long line) {
+            for (vector<long long>& entries : lines) {
+                if (line < (long long) entries.size()) {
+                    entries.erase(entries.begin() + line);
+                    return;
+                }
+                line -= (long long) entries.size();
+            }
+        }
+
+        long long size() {
+            long long total = 0;
+            for (vector<long long>& entries : lines) total += (long long) entries.size();
+            return total;
+        }
+
+        void clear() {
+            for (vector<long long>& entries : lines) entries.clear();
+        }
+    };
+
+    /*
+     * Write the shopper sessions. The keys of the stdin format follow the menus of Store, see Store::userInterface.
+     */
+    bool generateWorkload(const Options& options) {
+        ofstream out(options.workload);
+        if (!out.is_open()) return false;
+
+        Random random(options.seed ^ 0x5DEECE66DULL);
+        int categories = CategoryRegistry::size();
+        long long total = options.items * categories;
+        Zipf zipf(total, options.zipf);
+        // Popular commodities are spread over the whole catalog instead of the first positions
+        vector<long long> positions(total);
+        for (long long i = 0; i < total; i++) positions[i] = i + 1;
+        for (long long i = total - 1; i > 0; i--) swap(positions[i], positions[random.uniform(i + 1)]);
+
+        int mixTotal = options.mix[0] + options.mix[1] + options.mix[2] + options.mix[3];
+        CartModel cart(categories);
+        bool stdinFormat = options.stdinFormat;
+        if (!stdinFormat) {
+            out << "# store-gen workload seed=" << options.seed << " items=" << options.items << " sessions="
+                << options.sessions << " zipf=" << options.zipf << '\n';
+        }
+
+        for (long long session = 1; session <= options.sessions; session++) {
+            if (stdinFormat) out << "1\n";
+            else out << "session " << session << '\n';
+            long long ops = 1 + random.uniform(2 * options.ops);
+            bool shopping = false;
+            for (long long op = 0; op < ops; op++) {
+                long long roll = random.uniform(mixTotal);
+                int kind = roll < options.mix[0] ? 0 : roll < options.mix[0] + options.mix[1] ? 1 :
+                           roll < options.mix[0] + options.mix[1] + options.mix[2] ? 2 : 3;
+                if (kind == 2 && cart.size() == 0) kind = 1;
+
+                if (kind == 1) {
+                    long long position = positions[zipf.sample(random)];
+                    cart.push(position, (int) ((position - 1) / options.items));
+                    if (stdinFormat) {
+                        if (!shopping) out << "1\n";
+                        out << position << '\n';
+                        shopping = true;
+                    } else {
+                        out << "add " << position << '\n';
+                    }
+                    continue;
+                }
+
+                if (stdinFormat && shopping) {
+                    out << "0\n";
+                    shopping = false;
+                }
+                if (kind == 0) {
+                    out << (stdinFormat ? "1\n0\n" : "browse\n");
+                } else if (kind == 2) {
+                    long long line = random.uniform(cart.size());
+                    cart.remove(line);
+                    // Show the cart, delete one line, then say no to more deletes and to the checkout
+                    if (stdinFormat) out << "2\n1\n" << line + 1 << "\n2\n2\n";
+                    else out << "remove " << line + 1 << '\n';
+                } else {
+                    if (stdinFormat) out << (cart.size() == 0 ? "3\n" : "3\n1\n");
+                    else out << "checkout\n";
+                    cart.clear();
+                }
+            }
+            if (stdinFormat) out << (shopping ? "0\n0\n" : "0\n");
+            else out << "end\n";
+        }
+        if (stdinFormat) out << "0\n";
+        return (bool) out;
+    }
+
+    void usage(const char* program) {
+        cerr << "usage: " << program << " [--items=N] [--seed=S] [--out=<directory>]" << endl
+             << "       [--sessions=N] [--ops=N] [--zipf=S] [--mix=browse,add,remove,checkout]" << endl
+             << "       [--workload=<file>] [--workload-format=ops|stdin]" << endl
+             << "--items is the number of commodities in every category, the default is 1000." << endl
+             << "A workload is only written when --sessions is given, --ops is the average operations per session."
+             << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        string key = argument.substr(0, argument.find('='));
+        string value = argument.substr(argument.find('=') + 1);
+        if (key == "--items") options.items = stoll(value);
+        else if (key == "--seed") options.seed = stoull(value);
+        else if (key == "--out") options.out = value;
+        else if (key == "--sessions") options.sessions = stoll(value);
+        else if (key == "--ops") options.ops = stoll(value);
+        else if (key == "--zipf") options.zipf = stod(value);
+        else if (key == "--workload") options.workload = value;
+        else if (key == "--workload-format" && (value == "ops" || value == "stdin")) {
+            options.stdinFormat = (value == "stdin");
+        } else if (key == "--mix" && sscanf(value.c_str(), "%d,%d,%d,%d", &options.mix[0], &options.mix[1],
+                                            &options.mix[2], &options.mix[3]) == 4) {
+            continue;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    int mixTotal = options.mix[0] + options.mix[1] + options.mix[2] + options.mix[3];
+    if (options.items <= 0 || options.ops <= 0 || mixTotal <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+#ifdef _WIN32
+    _mkdir(options.out.c_str());
+#else
+    mkdir(options.out.c_str(), 0755);
+#endif
+    if (chdir(options.out.c_str()) != 0) {
+        cerr << "Can not enter " << options.out << endl;
+        return 1;
+    }
+    if (!generateCatalog(options)) return 1;
+    if (options.sessions > 0 && !generateWorkload(options)) {
+        cerr << "Can not write " << options.workload << endl;
+        return 1;
+    }
+    return 0;
+}